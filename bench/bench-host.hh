@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <dlfcn.h>
+
+#include <clap/helpers/host.hh>
+#include <clap/helpers/plugin-proxy.hh>
+
+// The benchmarks run on a single thread, which plays the main and the audio thread in turn.
+inline thread_local bool g_benchIsAudioThread = false;
+
+// Minimal host around a PluginProxy, at a given checking level, to measure the plugin call path
+// without the Qt host and an audio device.
+template <clap::helpers::MisbehaviourHandler h, clap::helpers::CheckingLevel l>
+class BenchHost final : public clap::helpers::Host<h, l> {
+public:
+   using BaseHost = clap::helpers::Host<h, l>;
+   using PluginProxy = clap::helpers::PluginProxy<h, l>;
+
+   BenchHost()
+      : BaseHost("Clap Test Host (bench)",             // name
+                 "clap",                               // vendor
+                 "0.1.0",                              // version
+                 "https://github.com/free-audio/clap" // url
+        ) {}
+
+   ~BenchHost() { unload(); }
+
+   bool load(const std::string &path, const char *pluginId) {
+      _library = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+      if (!_library) {
+         std::fprintf(stderr, "failed to load '%s': %s\n", path.c_str(), ::dlerror());
+         return false;
+      }
+
+      _pluginEntry = reinterpret_cast<const clap_plugin_entry *>(::dlsym(_library, "clap_entry"));
+      if (!_pluginEntry || !_pluginEntry->init(path.c_str())) {
+         std::fprintf(stderr, "no usable clap_entry in '%s'\n", path.c_str());
+         _pluginEntry = nullptr;
+         return false;
+      }
+
+      auto factory = static_cast<const clap_plugin_factory *>(
+         _pluginEntry->get_factory(CLAP_PLUGIN_FACTORY_ID));
+      auto plugin = factory ? factory->create_plugin(factory, this->clapHost(), pluginId) : nullptr;
+      if (!plugin) {
+         std::fprintf(stderr, "could not create the plugin '%s'\n", pluginId);
+         return false;
+      }
+
+      _plugin = std::make_unique<PluginProxy>(*plugin, *this);
+      return _plugin->init();
+   }
+
+   void unload() {
+      if (_plugin) {
+         stop();
+         _plugin->destroy();
+         _plugin.reset();
+      }
+
+      if (_pluginEntry) {
+         _pluginEntry->deinit();
+         _pluginEntry = nullptr;
+      }
+
+      if (_library) {
+         ::dlclose(_library);
+         _library = nullptr;
+      }
+   }
+
+   bool start(double sampleRate, uint32_t maxFrames) {
+      if (!_plugin->activate(sampleRate, 1, maxFrames))
+         return false;
+      _isActive = true;
+
+      g_benchIsAudioThread = true;
+      _isProcessing = _plugin->startProcessing();
+      g_benchIsAudioThread = false;
+      return _isProcessing;
+   }
+
+   void stop() {
+      if (_isProcessing) {
+         g_benchIsAudioThread = true;
+         _plugin->stopProcessing();
+         g_benchIsAudioThread = false;
+         _isProcessing = false;
+      }
+
+      if (_isActive) {
+         _plugin->deactivate();
+         _isActive = false;
+      }
+   }
+
+   clap_process_status process(const clap_process *process) noexcept {
+      g_benchIsAudioThread = true;
+      const auto status = _plugin->process(process);
+      g_benchIsAudioThread = false;
+      return status;
+   }
+
+protected:
+   // clap_host
+   void requestRestart() noexcept override {}
+   void requestProcess() noexcept override {}
+   void requestCallback() noexcept override {}
+
+   // clap_host_thread_check
+   bool threadCheckIsMainThread() const noexcept override { return !g_benchIsAudioThread; }
+   bool threadCheckIsAudioThread() const noexcept override { return g_benchIsAudioThread; }
+
+private:
+   void *_library = nullptr;
+   const clap_plugin_entry *_pluginEntry = nullptr;
+   std::unique_ptr<PluginProxy> _plugin;
+
+   bool _isActive = false;
+   bool _isProcessing = false;
+};
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "benchmark.hh"
+
+void BenchmarkRunner::addResult(const std::string &name,
+                                Params params,
+                                uint64_t operations,
+                                std::vector<double> nsPerOperation) {
+   std::sort(nsPerOperation.begin(), nsPerOperation.end());
+   _results.push_back({name,
+                       std::move(params),
+                       operations,
+                       nsPerOperation[nsPerOperation.size() / 2],
+                       nsPerOperation.front()});
+
+   // the progress goes to stderr, so that the JSON output can be redirected
+   std::fprintf(stderr, ".");
+}
+
+static std::string paramsText(const BenchmarkRunner::Params &params) {
+   std::string text;
+   for (auto &[key, value] : params) {
+      if (!text.empty())
+         text += ' ';
+      text += key + '=' + std::to_string(value);
+   }
+   return text;
+}
+
+void BenchmarkRunner::printTable(std::ostream &os) const {
+   char line[256];
+   std::snprintf(
+      line, sizeof(line), "%-40s %-24s %14s %14s\n", "benchmark", "params", "ns/op", "min ns/op");
+   os << '\n' << line;
+
+   for (auto &result : _results) {
+      std::snprintf(line,
+                    sizeof(line),
+                    "%-40s %-24s %14.2f %14.2f\n",
+                    result.name.c_str(),
+                    paramsText(result.params).c_str(),
+                    result.nsPerOperation,
+                    result.nsPerOperationMin);
+      os << line;
+   }
+}
+
+void BenchmarkRunner::printJson(std::ostream &os) const {
+   // the names and keys are plain identifiers, nothing needs escaping
+   os << "{\n  \"version\": 1,\n  \"benchmarks\": [";
+   for (size_t i = 0; i < _results.size(); ++i) {
+      auto &result = _results[i];
+      os << (i > 0 ? ",\n" : "\n") << "    {\"name\": \"" << result.name << "\", \"params\": {";
+      for (size_t p = 0; p < result.params.size(); ++p)
+         os << (p > 0 ? ", " : "") << '"' << result.params[p].first
+            << "\": " << result.params[p].second;
+      os << "}, \"operations_per_batch\": " << result.operationsPerBatch
+         << ", \"ns_per_op\": " << result.nsPerOperation
+         << ", \"ns_per_op_min\": " << result.nsPerOperationMin << "}";
+   }
+   os << "\n  ]\n}\n";
+}
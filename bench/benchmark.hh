@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Keeps the compiler from optimizing a benchmarked computation away.
+template <typename T>
+inline void doNotOptimize(const T &value) noexcept {
+   asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Runs the benchmarks and collects their results, printed as a table or as JSON.
+//
+// Each benchmark is warmed up, then run in BATCH_COUNT batches of about BATCH_DURATION: the
+// median and the fastest batch are reported, in nanoseconds per operation.
+class BenchmarkRunner {
+public:
+   using Params = std::vector<std::pair<std::string, int64_t>>;
+
+   static constexpr int BATCH_COUNT = 7;
+   static constexpr std::chrono::milliseconds BATCH_DURATION{20};
+
+   struct Result {
+      std::string name;
+      Params params;
+      uint64_t operationsPerBatch;
+      double nsPerOperation;
+      double nsPerOperationMin;
+   };
+
+   // only the benchmarks whose name contains filter are run
+   explicit BenchmarkRunner(std::string filter) : _filter(std::move(filter)) {}
+
+   bool isSelected(const std::string &name) const {
+      return name.find(_filter) != std::string::npos;
+   }
+
+   // fn() runs one operation
+   template <typename Fn>
+   void run(const std::string &name, Params params, Fn &&fn) {
+      if (!isSelected(name))
+         return;
+
+      using Clock = std::chrono::steady_clock;
+
+      // warm up, and find how many operations fit in a batch
+      uint64_t operations = 1;
+      for (;;) {
+         const auto start = Clock::now();
+         for (uint64_t i = 0; i < operations; ++i)
+            fn();
+         if (Clock::now() - start >= BATCH_DURATION / 4)
+            break;
+         operations *= 2;
+      }
+      operations *= 4;
+
+      std::vector<double> nsPerOperation;
+      for (int batch = 0; batch < BATCH_COUNT; ++batch) {
+         const auto start = Clock::now();
+         for (uint64_t i = 0; i < operations; ++i)
+            fn();
+         const std::chrono::duration<double, std::nano> duration = Clock::now() - start;
+         nsPerOperation.push_back(duration.count() / operations);
+      }
+
+      addResult(name, std::move(params), operations, std::move(nsPerOperation));
+   }
+
+   void printTable(std::ostream &os) const;
+   void printJson(std::ostream &os) const;
+
+private:
+   void addResult(const std::string &name,
+                  Params params,
+                  uint64_t operations,
+                  std::vector<double> nsPerOperation);
+
+   const std::string _filter;
+   std::vector<Result> _results;
+};
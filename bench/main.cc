@@ -0,0 +1,341 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <clap/helpers/event-list.hh>
+#include <clap/helpers/reducing-param-queue.hh>
+
+#include <clap/helpers/host.hxx>
+#include <clap/helpers/plugin-proxy.hxx>
+#include <clap/helpers/reducing-param-queue.hxx>
+
+#include "audio-block.hh"
+#include "audio-interleave.hh"
+#include "bench-host.hh"
+#include "benchmark.hh"
+#include "event-merger.hh"
+#include "midi-translator.hh"
+#include "param-store.hh"
+#include "param-value-mirror.hh"
+
+// Micro-benchmarks of the host's audio path, and the host's overhead per block around the
+// passthrough test plugin.
+//
+// usage: clap-host-bench [--json] [--filter <text>] [--plugins <path to the test plugins>]
+
+using clap::helpers::CheckingLevel;
+using clap::helpers::MisbehaviourHandler;
+
+template class clap::helpers::Host<MisbehaviourHandler::Terminate, CheckingLevel::Maximal>;
+template class clap::helpers::PluginProxy<MisbehaviourHandler::Terminate, CheckingLevel::Maximal>;
+template class clap::helpers::Host<MisbehaviourHandler::Ignore, CheckingLevel::Minimal>;
+template class clap::helpers::PluginProxy<MisbehaviourHandler::Ignore, CheckingLevel::Minimal>;
+
+static const char PASSTHROUGH_PLUGIN_ID[] = "org.free-audio.clap-host.test.passthrough";
+
+static constexpr double SAMPLE_RATE = 48000;
+static constexpr uint32_t MAX_FRAMES = 1024;
+static const std::vector<uint32_t> BLOCK_SIZES = {32, 64, 128, 256, 512, 1024};
+
+static clap_event_param_value makeParamValue(uint32_t time, clap_id paramId, double value) {
+   clap_event_param_value ev;
+   ev.header.size = sizeof(ev);
+   ev.header.time = time;
+   ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+   ev.header.type = CLAP_EVENT_PARAM_VALUE;
+   ev.header.flags = 0;
+   ev.param_id = paramId;
+   ev.cookie = nullptr;
+   ev.note_id = -1;
+   ev.port_index = -1;
+   ev.channel = -1;
+   ev.key = -1;
+   ev.value = value;
+   return ev;
+}
+
+////////////////
+// Event list //
+////////////////
+
+static void benchEventList(BenchmarkRunner &runner) {
+   for (uint32_t count : {16, 256}) {
+      clap::helpers::EventList list;
+      runner.run("event-list/push-clear", {{"events", count}}, [&] {
+         for (uint32_t i = 0; i < count; ++i) {
+            auto ev = makeParamValue(i, i, 0.5);
+            list.push(&ev.header);
+         }
+         doNotOptimize(list.size());
+         list.clear();
+      });
+   }
+
+   clap::helpers::EventList a;
+   clap::helpers::EventList b;
+   for (uint32_t i = 0; i < 128; ++i) {
+      auto ev = makeParamValue(2 * i, i, 0.5);
+      a.push(&ev.header);
+      ev.header.time = 2 * i + 1;
+      b.push(&ev.header);
+   }
+   EventMerger merger;
+   merger.addSource(a);
+   merger.addSource(b);
+   runner.run("event-merger/merge", {{"events", 256}}, [&] {
+      merger.merge();
+      doNotOptimize(merger.size());
+   });
+}
+
+//////////////////
+// Param queues //
+//////////////////
+
+static void benchParamQueues(BenchmarkRunner &runner) {
+   // main thread to audio thread: the host's parameter changes
+   for (uint32_t count : {1, 64}) {
+      clap::helpers::ReducingParamQueue<clap_id, double> queue;
+      double sum = 0;
+      runner.run("param-queue/app-to-engine", {{"params", count}}, [&] {
+         for (uint32_t i = 0; i < count; ++i)
+            queue.set(i, 0.5);
+         queue.producerDone();
+         queue.consume([&](clap_id paramId, const double &value) { sum += value; });
+         doNotOptimize(sum);
+      });
+   }
+
+   // audio thread to main thread: the plugin's output values
+   for (uint32_t count : {1, 64}) {
+      ParamValueMirror mirror;
+      mirror.rebuild(1024);
+      double sum = 0;
+      runner.run("param-queue/engine-to-app", {{"params", count}, {"size", 1024}}, [&] {
+         for (uint32_t i = 0; i < count; ++i)
+            mirror.setValue(i * 7 % 1024, 0.5);
+         mirror.publish();
+         mirror.consumeChanges(
+            [&](uint32_t index, const ParamValueMirror::Change &change) { sum += change.value; });
+         doNotOptimize(sum);
+      });
+   }
+}
+
+//////////////////////
+// MIDI translation //
+//////////////////////
+
+static void benchMidiTranslation(BenchmarkRunner &runner) {
+   // notes on and off, a CC and a pitch bend: 16 messages
+   std::vector<uint8_t> midi;
+   for (uint8_t key = 60; key < 64; ++key) {
+      midi.insert(midi.end(), {0x90, key, 100, 0x80, key, 0});
+      midi.insert(midi.end(), {0xB0, 74, key, 0xE0, 0, key});
+   }
+
+   const std::pair<const char *, uint32_t> dialects[] = {
+      {"midi-translator/clap", CLAP_NOTE_DIALECT_CLAP},
+      {"midi-translator/midi", CLAP_NOTE_DIALECT_MIDI},
+      {"midi-translator/midi2", CLAP_NOTE_DIALECT_MIDI2},
+   };
+   for (auto &[name, dialect] : dialects) {
+      MidiTranslator translator;
+      translator.setDialects(dialect, dialect);
+      clap::helpers::EventList out;
+      runner.run(name, {{"messages", 16}}, [&] {
+         translator.translate(0, midi.data(), midi.size(), out);
+         doNotOptimize(out.size());
+         out.clear();
+      });
+   }
+}
+
+////////////////
+// Interleave //
+////////////////
+
+static void benchInterleave(BenchmarkRunner &runner) {
+   std::vector<float> interleaved(2 * MAX_FRAMES, 0.25f);
+   std::vector<float> left(MAX_FRAMES);
+   std::vector<float> right(MAX_FRAMES);
+   float *channels[2] = {left.data(), right.data()};
+
+   for (uint32_t frames : BLOCK_SIZES) {
+      runner.run("interleave/deinterleave", {{"frames", frames}}, [&] {
+         deinterleaveStereo(interleaved.data(), channels, frames);
+         doNotOptimize(left[0]);
+      });
+      runner.run("interleave/interleave", {{"frames", frames}}, [&] {
+         interleaveStereo(channels, interleaved.data(), frames);
+         doNotOptimize(interleaved[0]);
+      });
+   }
+}
+
+/////////////////////////
+// Plugin process path //
+/////////////////////////
+
+// The buffers of one audio block, laid out like Engine and PluginHost do.
+struct BlockBuffers {
+   BlockBuffers() {
+      interleavedIn.assign(2 * MAX_FRAMES, 0.25f);
+      interleavedOut.assign(2 * MAX_FRAMES, 0.f);
+      for (auto &channel : channels)
+         channel.assign(MAX_FRAMES, 0.f);
+
+      inputs[0] = channels[0].data();
+      inputs[1] = channels[1].data();
+      outputs[0] = channels[2].data();
+      outputs[1] = channels[3].data();
+
+      audioIn = {inputs, nullptr, 2, 0, 0};
+      audioOut = {outputs, nullptr, 2, 0, 0};
+   }
+
+   std::vector<float> interleavedIn;
+   std::vector<float> interleavedOut;
+   std::vector<float> channels[4];
+   float *inputs[2];
+   float *outputs[2];
+   clap_audio_buffer audioIn;
+   clap_audio_buffer audioOut;
+};
+
+static void buildParams(ParamStore &params, uint32_t count) {
+   for (clap_id paramId = 0; paramId < count; ++paramId) {
+      clap_param_info info = {};
+      info.id = paramId;
+      info.flags = CLAP_PARAM_IS_AUTOMATABLE;
+      std::snprintf(info.name, sizeof(info.name), "param %u", paramId);
+      info.max_value = 1;
+      params.add(info, 0);
+   }
+
+   std::pair<uint32_t, uint32_t> duplicate;
+   params.buildIndex(duplicate);
+}
+
+static int64_t steadyTimeNs() {
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+template <MisbehaviourHandler h, CheckingLevel l>
+static void benchProcessPath(BenchmarkRunner &runner,
+                             const std::string &pluginsPath,
+                             const std::string &level) {
+   const std::string proxyName = "proxy-process/" + level;
+   const std::string blockName = "host-block/" + level;
+   if (!runner.isSelected(proxyName) && !runner.isSelected(blockName))
+      return;
+
+   BenchHost<h, l> host;
+   if (!host.load(pluginsPath, PASSTHROUGH_PLUGIN_ID) || !host.start(SAMPLE_RATE, MAX_FRAMES))
+      return;
+
+   BlockBuffers buffers;
+   ParamStore params;
+   buildParams(params, 64);
+   AudioBlock audioBlock;
+   audioBlock.setNoteDialects(CLAP_NOTE_DIALECT_CLAP | CLAP_NOTE_DIALECT_MIDI,
+                              CLAP_NOTE_DIALECT_CLAP);
+   audioBlock.rebuildParams(params.size());
+
+   clap_process process;
+   process.steady_time = 0;
+   process.transport = nullptr;
+   process.audio_inputs = &buffers.audioIn;
+   process.audio_inputs_count = 1;
+   process.audio_outputs = &buffers.audioOut;
+   process.audio_outputs_count = 1;
+   process.in_events = audioBlock.inputEvents();
+   process.out_events = audioBlock.outputEvents();
+
+   // the plugin call alone, with no events
+   for (uint32_t frames : BLOCK_SIZES) {
+      process.frames_count = frames;
+      audioBlock.beginBlock(frames, steadyTimeNs());
+      audioBlock.prepareInputEvents(true);
+      runner.run(proxyName, {{"frames", frames}}, [&] {
+         doNotOptimize(host.process(&process));
+         process.steady_time += frames;
+      });
+      audioBlock.endBlock();
+   }
+
+   // Everything the host does around the plugin for one block, with the same AudioBlock as
+   // PluginHost::process(): a few parameter changes made by the main thread and a few notes come
+   // in each block. Both threads are played in turn here.
+   static const uint8_t noteOn[] = {0x90, 60, 100};
+   static const uint8_t noteOff[] = {0x80, 60, 0};
+   for (uint32_t frames : BLOCK_SIZES) {
+      process.frames_count = frames;
+      runner.run(blockName, {{"frames", frames}}, [&] {
+         const int64_t now = steadyTimeNs();
+         for (uint32_t index = 0; index < 4; ++index)
+            audioBlock.sendParamValue(params, index, 0.5, now);
+         audioBlock.producerDone();
+
+         audioBlock.beginBlock(frames, now);
+         deinterleaveStereo(buffers.interleavedIn.data(), buffers.inputs, frames);
+         audioBlock.pushMidi(0, noteOn, sizeof(noteOn));
+         audioBlock.pushMidi(frames / 2, noteOff, sizeof(noteOff));
+         audioBlock.prepareInputEvents(true);
+
+         doNotOptimize(audioBlock.process(process, false, [&] { return host.process(&process); }));
+         process.steady_time += frames;
+
+         doNotOptimize(audioBlock.handleOutputEvents(params));
+         audioBlock.endBlock();
+         interleaveStereo(buffers.outputs, buffers.interleavedOut.data(), frames);
+      });
+
+      // what the main thread would read, out of the measure
+      audioBlock.consumeParamChanges([](uint32_t, const ParamValueMirror::Change &) {});
+   }
+}
+
+int main(int argc, char **argv) {
+   bool isJson = false;
+   std::string filter;
+   std::string pluginsPath = CLAP_HOST_TEST_PLUGINS_PATH;
+
+   for (int i = 1; i < argc; ++i) {
+      if (!std::strcmp(argv[i], "--json"))
+         isJson = true;
+      else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc)
+         filter = argv[++i];
+      else if (!std::strcmp(argv[i], "--plugins") && i + 1 < argc)
+         pluginsPath = argv[++i];
+      else {
+         std::cerr << "usage: " << argv[0]
+                   << " [--json] [--filter <text>] [--plugins <path to the test plugins>]"
+                   << std::endl;
+         return 1;
+      }
+   }
+
+   BenchmarkRunner runner(filter);
+   benchEventList(runner);
+   benchParamQueues(runner);
+   benchMidiTranslation(runner);
+   benchInterleave(runner);
+   benchProcessPath<MisbehaviourHandler::Terminate, CheckingLevel::Maximal>(
+      runner, pluginsPath, "maximal");
+   // the proxy of a host built with CLAP_HOST_MINIMAL_CHECKS, --minimal-checks doesn't change it
+   benchProcessPath<MisbehaviourHandler::Ignore, CheckingLevel::Minimal>(
+      runner, pluginsPath, "minimal-build-option");
+   std::cerr << std::endl;
+
+   if (isJson)
+      runner.printJson(std::cout);
+   else
+      runner.printTable(std::cout);
+   return 0;
+}
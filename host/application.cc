@@ -6,11 +6,15 @@
 
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QDebug>
 #include <QSettings>
+#include <QThread>
 
 #include "application.hh"
 #include "main-window.hh"
+#include "plugin-host.hh"
 #include "settings.hh"
+#include "tracer.hh"
 
 Application *Application::_instance = nullptr;
 
@@ -48,6 +52,14 @@ Application::~Application() {
    delete _engine;
    _engine = nullptr;
 
+   // the audio and thread pool threads are stopped
+   if (!_tracePath.isEmpty()) {
+      if (Tracer::writeChromeTrace(_tracePath.toStdString()))
+         qInfo() << "wrote the trace to" << _tracePath;
+      else
+         qWarning() << "failed to write the trace to" << _tracePath;
+   }
+
    delete _mainWindow;
    _mainWindow = nullptr;
 
@@ -69,17 +81,51 @@ void Application::parseCommandLine() {
                                      tr("index of the plugin to create"),
                                      tr("plugin-index"),
                                      "0");
+   QCommandLineOption minimalChecksOpt(
+      "minimal-checks",
+      tr("skip the host's thread checks on the audio thread, and only warn about the plugin "
+         "misbehaviours detected by the host instead of terminating; the checks of the plugin "
+         "proxy keep the level chosen at build time"));
+   QCommandLineOption perfCountersOpt(
+      "perf-counters",
+      tr("log the hardware performance counters of the plugin's process() and thread pool tasks, "
+         "Linux only"));
+   QCommandLineOption perfCountersCsvOpt(
+      "perf-counters-csv",
+      tr("also write the performance counters of each block to a CSV file, implies "
+         "--perf-counters"),
+      tr("path"));
+   QCommandLineOption traceOpt(
+      "trace",
+      tr("record the engine and plugin activity, and write it on exit as a Chrome Trace JSON file "
+         "which chrome://tracing and the Perfetto UI can open"),
+      tr("path"));
 
    parser.setApplicationDescription("clap standalone host");
    parser.addHelpOption();
    parser.addVersionOption();
    parser.addOption(pluginOpt);
    parser.addOption(pluginIndexOpt);
+   parser.addOption(minimalChecksOpt);
+   parser.addOption(perfCountersOpt);
+   parser.addOption(perfCountersCsvOpt);
+   parser.addOption(traceOpt);
 
    parser.process(*this);
 
    _pluginPath = parser.value(pluginOpt);
    _pluginIndex = parser.value(pluginIndexOpt).toInt();
+
+   if (parser.isSet(minimalChecksOpt))
+      PluginHost::setMinimalChecks(true);
+
+   const QString perfCountersCsv = parser.value(perfCountersCsvOpt);
+   if (parser.isSet(perfCountersOpt) || !perfCountersCsv.isEmpty())
+      PluginHost::setPerfCounters(true, perfCountersCsv);
+
+   _tracePath = parser.value(traceOpt);
+   if (!_tracePath.isEmpty())
+      Tracer::start(QThread::idealThreadCount()); // the size of PluginHost's thread pool
 }
 
 void Application::loadSettings() {
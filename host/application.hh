@@ -43,4 +43,7 @@ private:
 
    QString _pluginPath;
    int _pluginIndex = 0;
+
+   // written on exit, if set
+   QString _tracePath;
 };
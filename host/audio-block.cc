@@ -0,0 +1,239 @@
+#include <algorithm>
+
+#include "audio-block.hh"
+
+#include <clap/helpers/reducing-param-queue.hxx>
+
+AudioBlock::AudioBlock() {
+   // at equal times, parameter changes come before the notes
+   _evIn.addSource(_evParamValues);
+   _evIn.addSource(_evParamMods);
+   _evIn.addSource(_evKeyboard);
+   _evIn.addSource(_evMidi);
+
+   _evFlushIn.addSource(_evParamValues);
+   _evFlushIn.addSource(_evParamMods);
+}
+
+void AudioBlock::setNoteDialects(uint32_t supportedDialects, uint32_t preferredDialect) noexcept {
+   _pendingNoteDialects.store(uint64_t(supportedDialects) << 32 | preferredDialect,
+                              std::memory_order_release);
+}
+
+void AudioBlock::rebuildParams(uint32_t count) {
+   _paramValueMirror.rebuild(count);
+   _paramGestures.assign((count + 63) / 64, 0);
+}
+
+void AudioBlock::sendParamValue(const ParamStore &params,
+                                uint32_t index,
+                                double value,
+                                int64_t timeNs) {
+   const clap_id paramId = params.id(index);
+   void *cookie = params.cookie(index);
+   if (params.shouldReduceChanges(index)) {
+      _appToEngineValueQueue.set(paramId, {cookie, value});
+      _appToEngineValueQueue.producerDone();
+      return;
+   }
+
+   // If the timed queue is full, fall back to the reduced changes rather than dropping this one.
+   // The block in progress may have consumed the spilled changes before this one: the spill lasts
+   // until the next block is done.
+   const uint32_t blockCount = _appToEngineValueBlockCount.load(std::memory_order_acquire);
+   const bool isSpilling = int32_t(_spillEndBlockCount - blockCount) > 0;
+   if (isSpilling || !_appToEngineTimedValueQueue.tryPush({paramId, cookie, value, timeNs})) {
+      _appToEngineSpilledValueQueue.set(paramId, {cookie, value});
+      _appToEngineSpilledValueQueue.producerDone();
+      _spillEndBlockCount = blockCount + 2;
+   }
+}
+
+void AudioBlock::sendParamModulation(clap_id paramId, void *cookie, double value) {
+   _appToEngineModQueue.set(paramId, {cookie, value});
+   _appToEngineModQueue.producerDone();
+}
+
+void AudioBlock::producerDone() {
+   _appToEngineValueQueue.producerDone();
+   _appToEngineSpilledValueQueue.producerDone();
+   _appToEngineModQueue.producerDone();
+}
+
+const clap_input_events *AudioBlock::prepareFlushEvents(bool shouldProvideCookie) {
+   endBlock();
+
+   // no block to spread the timestamped changes on
+   generateInputEvents(0, shouldProvideCookie);
+   _evFlushIn.merge();
+   return _evFlushIn.clapInputEvents();
+}
+
+void AudioBlock::beginBlock(uint32_t framesCount, int64_t nowNs) noexcept {
+   _framesCount = framesCount;
+   _previousBlockStartNs = _blockStartNs ? _blockStartNs : nowNs;
+   _blockStartNs = nowNs;
+
+   const uint64_t dialects =
+      _pendingNoteDialects.exchange(NO_PENDING_DIALECTS, std::memory_order_acquire);
+   if (dialects != NO_PENDING_DIALECTS) {
+      _midiTranslator.setDialects(uint32_t(dialects >> 32), uint32_t(dialects));
+      _midiTranslator.reset();
+   }
+
+   _evKeyboard.clear();
+   _evMidi.clear();
+   _lastMidiTime = 0;
+}
+
+void AudioBlock::pushKeyboardMidi(const uint8_t *data, uint32_t size) noexcept {
+   _midiTranslator.translate(0, data, size, _evKeyboard);
+}
+
+void AudioBlock::pushMidi(int32_t sampleOffset, const uint8_t *data, uint32_t size) noexcept {
+   // keep the MIDI source sorted and within the block, whatever the input timestamps are
+   const int32_t lastFrame = std::max<int32_t>(0, int32_t(_framesCount) - 1);
+   _lastMidiTime = std::clamp<int32_t>(sampleOffset, _lastMidiTime, lastFrame);
+   _midiTranslator.translate(_lastMidiTime, data, size, _evMidi);
+}
+
+void AudioBlock::prepareInputEvents(bool shouldProvideCookie) noexcept {
+   TraceScope scope("event generation");
+   _evOut.clear();
+   generateInputEvents(_framesCount, shouldProvideCookie);
+   _evIn.merge();
+}
+
+void AudioBlock::generateInputEvents(uint32_t framesCount, bool shouldProvideCookie) noexcept {
+   auto pushParamValue = [&](uint32_t time, clap_id param_id, void *cookie, double value) {
+      clap_event_param_value ev;
+      ev.header.time = time;
+      ev.header.type = CLAP_EVENT_PARAM_VALUE;
+      ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+      ev.header.flags = 0;
+      ev.header.size = sizeof(ev);
+      ev.param_id = param_id;
+      ev.cookie = shouldProvideCookie ? cookie : nullptr;
+      ev.port_index = 0;
+      ev.key = -1;
+      ev.channel = -1;
+      ev.note_id = -1;
+      ev.value = value;
+      _evParamValues.push(&ev.header);
+   };
+
+   _appToEngineValueQueue.consume(
+      [&](clap_id param_id, const AppToEngineParamQueueValue &value) {
+         pushParamValue(0, param_id, value.cookie, value.value);
+      });
+
+   // The changes done during the previous block are mapped onto this block, keeping their
+   // relative timing whatever the block size is.
+   const int64_t spanNs = _blockStartNs - _previousBlockStartNs;
+   uint32_t lastTime = 0;
+   AppToEngineTimedParamValue change;
+   while (_appToEngineTimedValueQueue.tryPop(change)) {
+      uint32_t time = 0;
+      if (framesCount > 0 && spanNs > 0 && change.timeNs > _previousBlockStartNs) {
+         const int64_t offset = (change.timeNs - _previousBlockStartNs) * framesCount / spanNs;
+         time = std::clamp<int64_t>(offset, lastTime, framesCount - 1);
+      }
+      lastTime = time;
+      pushParamValue(time, change.paramId, change.cookie, change.value);
+   }
+
+   // newer than the timed changes still in the queue when they were spilled
+   _appToEngineSpilledValueQueue.consume(
+      [&](clap_id param_id, const AppToEngineParamQueueValue &value) {
+         pushParamValue(framesCount > 0 ? framesCount - 1 : 0, param_id, value.cookie, value.value);
+      });
+   _appToEngineValueBlockCount.fetch_add(1, std::memory_order_release);
+
+   _appToEngineModQueue.consume([&](clap_id param_id, const AppToEngineParamQueueValue &value) {
+      clap_event_param_mod ev;
+      ev.header.time = 0;
+      ev.header.type = CLAP_EVENT_PARAM_MOD;
+      ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+      ev.header.flags = 0;
+      ev.header.size = sizeof(ev);
+      ev.param_id = param_id;
+      ev.cookie = shouldProvideCookie ? value.cookie : nullptr;
+      ev.port_index = 0;
+      ev.key = -1;
+      ev.channel = -1;
+      ev.note_id = -1;
+      ev.amount = value.value;
+      _evParamMods.push(&ev.header);
+   });
+}
+
+void AudioBlock::pushPerfBlock(const clap_process &process) noexcept {
+   PerfBlock block;
+   if (!PerfCounters::end(block.values))
+      return;
+
+   block.steadyTime = process.steady_time;
+   block.frames = process.frames_count;
+   if (!_perfBlocks.tryPush(block))
+      _perfBlocksDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool AudioBlock::handleOutputEvents(const ParamStore &params) noexcept {
+   TraceScope scope("output handling");
+
+   bool hasMisbehaved = false;
+   const auto misbehave = [&](Misbehaviour type, clap_id paramId) {
+      // if the queue is full, the plugin is already flooding the log
+      hasMisbehaved |= _misbehaviours.tryPush({type, paramId});
+   };
+
+   for (uint32_t i = 0; i < _evOut.size(); ++i) {
+      auto h = _evOut.get(i);
+      switch (h->type) {
+      case CLAP_EVENT_PARAM_GESTURE_BEGIN:
+      case CLAP_EVENT_PARAM_GESTURE_END: {
+         auto ev = reinterpret_cast<const clap_event_param_gesture *>(h);
+         const int32_t index = params.indexOf(ev->param_id);
+         if (index < 0) {
+            misbehave(Misbehaviour::UnknownParamId, ev->param_id);
+            break;
+         }
+
+         const bool isBegin = h->type == CLAP_EVENT_PARAM_GESTURE_BEGIN;
+         const uint64_t mask = uint64_t(1) << (index % 64);
+         uint64_t &gestures = _paramGestures[index / 64];
+         if (bool(gestures & mask) == isBegin) {
+            misbehave(isBegin ? Misbehaviour::GestureBeginTwice
+                              : Misbehaviour::GestureEndWithoutBegin,
+                      ev->param_id);
+            break;
+         }
+         gestures ^= mask;
+
+         _paramValueMirror.setGesture(index, isBegin);
+         break;
+      }
+
+      case CLAP_EVENT_PARAM_VALUE: {
+         auto ev = reinterpret_cast<const clap_event_param_value *>(h);
+         const int32_t index = params.indexOf(ev->param_id);
+         if (index < 0) {
+            misbehave(Misbehaviour::UnknownParamId, ev->param_id);
+            break;
+         }
+
+         _paramValueMirror.setValue(index, ev->value);
+         break;
+      }
+      }
+   }
+
+   const bool hasPublished = _paramValueMirror.publish();
+   return hasPublished || hasMisbehaved;
+}
+
+void AudioBlock::endBlock() noexcept {
+   _evOut.clear();
+   _evParamValues.clear();
+   _evParamMods.clear();
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <clap/clap.h>
+#include <clap/helpers/event-list.hh>
+#include <clap/helpers/reducing-param-queue.hh>
+
+#include "event-merger.hh"
+#include "midi-translator.hh"
+#include "param-store.hh"
+#include "param-value-mirror.hh"
+#include "perf-counters.hh"
+#include "spsc-queue.hh"
+#include "tracer.hh"
+
+// What the host does around the plugin's process() for one block, without Qt: PluginHost drives
+// it from the audio thread, and clap-host-bench measures it as it is.
+//
+// Before process(), the input events are generated from the host's parameter changes and the
+// MIDI input, and merged in time order. After, the plugin's parameter values and gestures go to
+// the mirror read by the main thread, and its misbehaviours are queued for the main thread to
+// report.
+//
+// The methods are called from the audio thread, unless noted otherwise.
+class AudioBlock {
+public:
+   enum class Misbehaviour {
+      GestureBeginTwice,
+      GestureEndWithoutBegin,
+      UnknownParamId,
+   };
+
+   struct MisbehaviourReport {
+      Misbehaviour type;
+      clap_id paramId;
+   };
+
+   struct PerfBlock {
+      int64_t steadyTime;
+      uint32_t frames;
+      PerfCounters::Values values;
+   };
+
+   AudioBlock();
+
+   // main thread: the translator is owned by the audio thread, which applies the dialects at the
+   // start of the next block
+   void setNoteDialects(uint32_t supportedDialects, uint32_t preferredDialect) noexcept;
+
+   // main thread, while the plugin is not processing
+   void rebuildParams(uint32_t count);
+
+   /* main thread: the host's changes */
+   void sendParamValue(const ParamStore &params, uint32_t index, double value, int64_t timeNs);
+   void sendParamModulation(clap_id paramId, void *cookie, double value);
+   void producerDone();
+
+   /* main thread: the plugin's outputs */
+   template <typename Fn>
+   void consumeParamChanges(Fn &&fn) {
+      _paramValueMirror.consumeChanges(std::forward<Fn>(fn));
+   }
+   bool takeMisbehaviour(MisbehaviourReport &report) noexcept {
+      return _misbehaviours.tryPop(report);
+   }
+   bool takePerfBlock(PerfBlock &block) noexcept { return _perfBlocks.tryPop(block); }
+   uint64_t takePerfBlocksDropped() noexcept {
+      return _perfBlocksDropped.exchange(0, std::memory_order_relaxed);
+   }
+   uint64_t takeDroppedEventCount() noexcept {
+      return _evIn.takeDroppedCount() + _evFlushIn.takeDroppedCount();
+   }
+
+   // main thread, while the plugin is inactive: the parameter changes for params_flush()
+   const clap_input_events *prepareFlushEvents(bool shouldProvideCookie);
+
+   /* audio thread */
+   void beginBlock(uint32_t framesCount, int64_t nowNs) noexcept;
+   void pushKeyboardMidi(const uint8_t *data, uint32_t size) noexcept;
+   void pushMidi(int32_t sampleOffset, const uint8_t *data, uint32_t size) noexcept;
+   void prepareInputEvents(bool shouldProvideCookie) noexcept;
+   bool hasInputEvents() const noexcept { return !_evIn.empty(); }
+
+   const clap_input_events *inputEvents() const noexcept { return _evIn.clapInputEvents(); }
+   const clap_output_events *outputEvents() const noexcept { return _evOut.clapOutputEvents(); }
+
+   // Calls the plugin, counting its hardware performance counters if shouldCount.
+   template <typename Fn>
+   int32_t process(const clap_process &process, bool shouldCount, Fn &&callPlugin) {
+      TraceScope scope("plugin->process");
+      const bool isCounting = shouldCount && PerfCounters::begin();
+      const int32_t status = callPlugin();
+      if (isCounting)
+         pushPerfBlock(process);
+      return status;
+   }
+
+   // returns true if the main thread has something to read
+   bool handleOutputEvents(const ParamStore &params) noexcept;
+   void endBlock() noexcept;
+
+private:
+   struct AppToEngineParamQueueValue {
+      void *cookie;
+      double value;
+   };
+
+   struct AppToEngineTimedParamValue {
+      clap_id paramId;
+      void *cookie;
+      double value;
+      int64_t timeNs;
+   };
+
+   void generateInputEvents(uint32_t framesCount, bool shouldProvideCookie) noexcept;
+   void pushPerfBlock(const clap_process &process) noexcept;
+
+   uint32_t _framesCount = 0;
+
+   /* input event sources, each one sorted by time */
+   clap::helpers::EventList _evParamValues;
+   clap::helpers::EventList _evParamMods;
+   clap::helpers::EventList _evKeyboard;
+   clap::helpers::EventList _evMidi;
+   int32_t _lastMidiTime = 0;
+
+   // all the sources, for process()
+   EventMerger _evIn;
+
+   // only the parameter sources, for params_flush()
+   EventMerger _evFlushIn;
+
+   clap::helpers::EventList _evOut;
+
+   MidiTranslator _midiTranslator;
+
+   // the supported dialects in the high half, the preferred one in the low half
+   static constexpr uint64_t NO_PENDING_DIALECTS = UINT64_MAX;
+   std::atomic<uint64_t> _pendingNoteDialects = {NO_PENDING_DIALECTS};
+
+   /* param update queues */
+   clap::helpers::ReducingParamQueue<clap_id, AppToEngineParamQueueValue> _appToEngineValueQueue;
+
+   // Every value change, with its time, for the params which don't reduce their changes.
+   // The changes done during the previous block are spread over the current block.
+   SpscQueue<AppToEngineTimedParamValue, 4096> _appToEngineTimedValueQueue;
+   int64_t _blockStartNs = 0;
+   int64_t _previousBlockStartNs = 0;
+
+   // The changes which didn't fit in the timed queue, reduced and sent at the end of the block,
+   // after the older timed ones. Once the timed queue overflowed, the changes go there until the
+   // audio thread has consumed them, so that a newer timed change can't be overwritten either.
+   clap::helpers::ReducingParamQueue<clap_id, AppToEngineParamQueueValue>
+      _appToEngineSpilledValueQueue;
+   std::atomic<uint32_t> _appToEngineValueBlockCount = {0}; // blocks which consumed the changes
+   uint32_t _spillEndBlockCount = 0;                        // main thread
+   clap::helpers::ReducingParamQueue<clap_id, AppToEngineParamQueueValue> _appToEngineModQueue;
+
+   // values and gestures output by the plugin, read by the main thread
+   ParamValueMirror _paramValueMirror;
+
+   // gestures in progress, one bit per param, indexed like the ParamStore
+   std::vector<uint64_t> _paramGestures;
+
+   SpscQueue<MisbehaviourReport, 256> _misbehaviours;
+
+   SpscQueue<PerfBlock, 1024> _perfBlocks;
+   std::atomic<uint64_t> _perfBlocksDropped = {0};
+};
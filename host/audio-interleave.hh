@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// Conversions between the interleaved stereo buffers of the audio device and the plugin's
+// per-channel buffers, on the audio thread.
+
+inline void deinterleaveStereo(const float *in, float *const *outs, uint32_t frames) noexcept {
+   float *const left = outs[0];
+   float *const right = outs[1];
+   for (uint32_t i = 0; i < frames; ++i) {
+      left[i] = in[2 * i];
+      right[i] = in[2 * i + 1];
+   }
+}
+
+inline void interleaveStereo(const float *const *ins, float *out, uint32_t frames) noexcept {
+   const float *const left = ins[0];
+   const float *const right = ins[1];
+   for (uint32_t i = 0; i < frames; ++i) {
+      out[2 * i] = left[i];
+      out[2 * i + 1] = right[i];
+   }
+}
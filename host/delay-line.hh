@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Fixed delay on a single channel, used to keep a signal aligned with the output of a plugin
+// which reports some latency.
+//
+// The buffer is sized on the main thread by setDelay(), process() and write() don't allocate.
+class DelayLine {
+public:
+   void setDelay(uint32_t delay) {
+      uint32_t size = 1;
+      while (size <= delay)
+         size <<= 1;
+
+      _buffer.assign(size, 0.f);
+      _mask = size - 1;
+      _delay = delay;
+      _writePos = 0;
+   }
+
+   uint32_t delay() const noexcept { return _delay; }
+
+   void clear() noexcept { std::fill(_buffer.begin(), _buffer.end(), 0.f); }
+
+   // in and out may point to the same buffer
+   void process(const float *in, float *out, uint32_t frames) noexcept {
+      for (uint32_t i = 0; i < frames; ++i) {
+         _buffer[_writePos] = in[i];
+         out[i] = _buffer[(_writePos - _delay) & _mask];
+         _writePos = (_writePos + 1) & _mask;
+      }
+   }
+
+   // Feeds the delay line without reading from it, so that it stays ready for process().
+   void write(const float *in, uint32_t frames) noexcept {
+      for (uint32_t i = 0; i < frames; ++i) {
+         _buffer[_writePos] = in[i];
+         _writePos = (_writePos + 1) & _mask;
+      }
+   }
+
+private:
+   std::vector<float> _buffer = {0.f};
+   uint32_t _mask = 0;
+   uint32_t _delay = 0;
+   uint32_t _writePos = 0;
+};
@@ -11,20 +11,12 @@
 #include <QtLogging>
 
 #include "application.hh"
+#include "audio-interleave.hh"
 #include "engine.hh"
 #include "main-window.hh"
 #include "plugin-host.hh"
 #include "settings.hh"
-
-enum MidiStatus {
-   MIDI_STATUS_NOTE_OFF = 0x8,
-   MIDI_STATUS_NOTE_ON = 0x9,
-   MIDI_STATUS_NOTE_AT = 0xA, // after touch
-   MIDI_STATUS_CC = 0xB,      // control change
-   MIDI_STATUS_PGM_CHANGE = 0xC,
-   MIDI_STATUS_CHANNEL_AT = 0xD, // after touch
-   MIDI_STATUS_PITCH_BEND = 0xE,
-};
+#include "tracer.hh"
 
 Engine::Engine(Application &application)
    : QObject(&application), _application(application), _settings(application.settings()),
@@ -32,7 +24,8 @@ Engine::Engine(Application &application)
    _pluginHost.reset(new PluginHost(*this));
 
    connect(&_idleTimer, &QTimer::timeout, this, QOverload<>::of(&Engine::callPluginIdle));
-   _idleTimer.start(1000 / 30);
+   // The plugin host is woken up when there is work for the main thread, this is a safety net.
+   _idleTimer.start(500);
 
    _midiInBuffer.reserve(512);
 }
@@ -138,10 +131,12 @@ void Engine::start() {
                             &Engine::audioCallback,
                             this);
          _nframes = bufferSize;
+         _sampleRate = as.sampleRate();
 
          _state = kStateRunning;
 
-         _pluginHost->setPorts(2, _inputs, 2, _outputs);
+         // only an output stream is opened
+         _pluginHost->setPorts(2, _inputs, 2, _outputs, 0, _audio->getStreamLatency());
          _pluginHost->activate(as.sampleRate(), _nframes);
          _audio->startStream();
       }
@@ -191,104 +186,75 @@ int Engine::audioCallback(void *outputBuffer,
    assert(thiz->_outputs[1] != nullptr);
    assert(frameCount == thiz->_nframes);
 
+   Tracer::setAudioThread();
+   TraceScope callbackScope("audio callback");
+
    // copy input
    if (in) {
-      for (int i = 0; i < frameCount; ++i) {
-         thiz->_inputs[0][i] = in[2 * i];
-         thiz->_inputs[1][i] = in[2 * i + 1];
-      }
+      TraceScope scope("input copy");
+      deinterleaveStereo(in, thiz->_inputs, frameCount);
    }
 
    thiz->_pluginHost->processBegin(frameCount);
 
-   for (int i = 0; i < 8; i++) {
-      uint32_t data;
-      do data = thiz->keyboardNoteData[i];
+   {
+      TraceScope scope("keyboard");
+      for (int i = 0; i < 8; i++) {
+         uint32_t data;
+         do data = thiz->keyboardNoteData[i];
 #ifdef _WIN32
-      while (data != InterlockedCompareExchange((LONG volatile *) &thiz->keyboardNoteData[i], 0, data));
+         while (data != InterlockedCompareExchange((LONG volatile *) &thiz->keyboardNoteData[i], 0, data));
 #else
-      while (data != __sync_val_compare_and_swap(&thiz->keyboardNoteData[i], data, 0));
+         while (data != __sync_val_compare_and_swap(&thiz->keyboardNoteData[i], data, 0));
 #endif
-      bool release = data & 0x8000;
-      data &= ~0x8000;
-      uint32_t note = 0;
-
-      if (data == 'Z') note = 48; if (data == 'S') note = 49; if (data == 'X') note = 50; if (data == 'D') note = 51;
-      if (data == 'C') note = 52; if (data == 'V') note = 53; if (data == 'G') note = 54; if (data == 'B') note = 55;
-      if (data == 'H') note = 56; if (data == 'N') note = 57; if (data == 'J') note = 58; if (data == 'M') note = 59;
-      if (data == ',') note = 60; if (data == 'l') note = 61; if (data == '.') note = 62; if (data == ';') note = 63;
-      if (data == '/') note = 64; if (data == 'Q') note = 60; if (data == '2') note = 61; if (data == 'W') note = 62;
-      if (data == '3') note = 63; if (data == 'E') note = 64; if (data == 'R') note = 65; if (data == '5') note = 66;
-      if (data == 'T') note = 67; if (data == '6') note = 68; if (data == 'Y') note = 69; if (data == '7') note = 70;
-      if (data == 'U') note = 71; if (data == 'I') note = 72; if (data == '9') note = 73; if (data == 'O') note = 74;
-      if (data == '0') note = 75; if (data == 'P') note = 76; if (data == '[') note = 77; if (data == '=') note = 78;
-      if (data == ']') note = 79;
-
-      if (!note) {
-      } else if (release) {
-         thiz->_pluginHost->processNoteOff(0, 0, note, 100);
-      } else {
-         thiz->_pluginHost->processNoteOn(0, 0, note, 100);
+         bool release = data & 0x8000;
+         data &= ~0x8000;
+         uint32_t note = 0;
+
+         if (data == 'Z') note = 48; if (data == 'S') note = 49; if (data == 'X') note = 50; if (data == 'D') note = 51;
+         if (data == 'C') note = 52; if (data == 'V') note = 53; if (data == 'G') note = 54; if (data == 'B') note = 55;
+         if (data == 'H') note = 56; if (data == 'N') note = 57; if (data == 'J') note = 58; if (data == 'M') note = 59;
+         if (data == ',') note = 60; if (data == 'l') note = 61; if (data == '.') note = 62; if (data == ';') note = 63;
+         if (data == '/') note = 64; if (data == 'Q') note = 60; if (data == '2') note = 61; if (data == 'W') note = 62;
+         if (data == '3') note = 63; if (data == 'E') note = 64; if (data == 'R') note = 65; if (data == '5') note = 66;
+         if (data == 'T') note = 67; if (data == '6') note = 68; if (data == 'Y') note = 69; if (data == '7') note = 70;
+         if (data == 'U') note = 71; if (data == 'I') note = 72; if (data == '9') note = 73; if (data == 'O') note = 74;
+         if (data == '0') note = 75; if (data == 'P') note = 76; if (data == '[') note = 77; if (data == '=') note = 78;
+         if (data == ']') note = 79;
+
+         if (note) {
+            const uint8_t msg[3] = {uint8_t(release ? 0x80 : 0x90), uint8_t(note), 100};
+            thiz->_pluginHost->processKeyboardMidi(msg, sizeof(msg));
+         }
       }
    }
 
-   auto &midiBuf = thiz->_midiInBuffer;
-   while (thiz->_midiIn && thiz->_midiIn->isPortOpen()) {
-      auto msgTime = thiz->_midiIn->getMessage(&midiBuf);
-      if (midiBuf.empty())
-         break;
-
-      uint8_t eventType = midiBuf[0] >> 4;
-      uint8_t channel = midiBuf[0] & 0xf;
-      uint8_t data1 = midiBuf[1];
-      uint8_t data2 = midiBuf[2];
-
-      double deltaMs = currentTime - msgTime;
-      double deltaSample = (deltaMs * thiz->_sampleRate) / 1000;
-
-      if (deltaSample >= frameCount)
-         deltaSample = frameCount - 1;
-
-      int32_t sampleOffset = frameCount - deltaSample;
-
-      switch (eventType) {
-      case MIDI_STATUS_NOTE_ON:
-         thiz->_pluginHost->processNoteOn(sampleOffset, channel, data1, data2);
-         break;
-
-      case MIDI_STATUS_NOTE_OFF:
-         thiz->_pluginHost->processNoteOff(sampleOffset, channel, data1, data2);
-         break;
-
-      case MIDI_STATUS_CC:
-         thiz->_pluginHost->processCC(sampleOffset, channel, data1, data2);
-         break;
+   {
+      TraceScope scope("MIDI drain");
+      auto &midiBuf = thiz->_midiInBuffer;
+      while (thiz->_midiIn && thiz->_midiIn->isPortOpen()) {
+         auto msgTime = thiz->_midiIn->getMessage(&midiBuf);
+         if (midiBuf.empty())
+            break;
 
-      case MIDI_STATUS_NOTE_AT:
-         std::cerr << "Note AT key: " << (int)data1 << ", pres: " << (int)data2 << std::endl;
-         thiz->_pluginHost->processNoteAt(sampleOffset, channel, data1, data2);
-         break;
+         double deltaMs = currentTime - msgTime;
+         double deltaSample = (deltaMs * thiz->_sampleRate) / 1000;
 
-      case MIDI_STATUS_CHANNEL_AT:
-         std::cerr << "Channel after touch" << std::endl;
-         break;
+         if (deltaSample >= frameCount)
+            deltaSample = frameCount - 1;
 
-      case MIDI_STATUS_PITCH_BEND:
-         thiz->_pluginHost->processPitchBend(sampleOffset, channel, (data2 << 7) | data1);
-         break;
+         int32_t sampleOffset = frameCount - deltaSample;
 
-      default:
-         std::cerr << "unknown event type: " << (int)eventType << std::endl;
-         break;
+         thiz->_pluginHost->processMidi(sampleOffset, midiBuf.data(), midiBuf.size());
       }
    }
 
    thiz->_pluginHost->process();
 
    // copy output
-   for (int i = 0; i < frameCount; ++i) {
-      out[2 * i] = thiz->_outputs[0][i];
-      out[2 * i + 1] = thiz->_outputs[1][i];
+   {
+      TraceScope scope("output copy");
+      interleaveStereo(thiz->_outputs, out, frameCount);
    }
 
    thiz->_steadyTime += frameCount;
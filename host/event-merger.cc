@@ -0,0 +1,68 @@
+#include <cassert>
+
+#include "event-merger.hh"
+
+EventMerger::EventMerger() {
+   _events.resize(MAX_EVENTS);
+
+   _inputEvents.ctx = this;
+   _inputEvents.size = &EventMerger::clapSize;
+   _inputEvents.get = &EventMerger::clapGet;
+}
+
+void EventMerger::addSource(const clap::helpers::EventList &source) {
+   assert(_sourceCount < MAX_SOURCES);
+   _sources[_sourceCount++] = &source;
+}
+
+void EventMerger::merge() noexcept {
+   _size = 0;
+
+   std::array<uint32_t, MAX_SOURCES> positions;
+   std::array<uint32_t, MAX_SOURCES> sizes;
+   for (uint32_t s = 0; s < _sourceCount; ++s) {
+      positions[s] = 0;
+      sizes[s] = _sources[s]->size();
+   }
+
+   // There are only a handful of sources: a linear scan of their heads is cheaper than a heap.
+   while (true) {
+      uint32_t best = MAX_SOURCES;
+      uint32_t bestTime = UINT32_MAX;
+      for (uint32_t s = 0; s < _sourceCount; ++s) {
+         if (positions[s] == sizes[s])
+            continue;
+
+         const uint32_t time = _sources[s]->get(positions[s])->time;
+         if (best == MAX_SOURCES || time < bestTime) {
+            best = s;
+            bestTime = time;
+         }
+      }
+
+      if (best == MAX_SOURCES)
+         break;
+
+      if (_size == MAX_EVENTS) {
+         uint64_t dropped = 0;
+         for (uint32_t s = 0; s < _sourceCount; ++s)
+            dropped += sizes[s] - positions[s];
+         _droppedCount.fetch_add(dropped, std::memory_order_relaxed);
+         break;
+      }
+
+      auto event = _sources[best]->get(positions[best]++);
+      assert(positions[best] == sizes[best] ||
+             _sources[best]->get(positions[best])->time >= event->time);
+      _events[_size++] = event;
+   }
+}
+
+uint32_t EventMerger::clapSize(const clap_input_events *list) noexcept {
+   return static_cast<const EventMerger *>(list->ctx)->size();
+}
+
+const clap_event_header *EventMerger::clapGet(const clap_input_events *list,
+                                              uint32_t index) noexcept {
+   return static_cast<const EventMerger *>(list->ctx)->get(index);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <clap/clap.h>
+#include <clap/helpers/event-list.hh>
+
+// clap_input_events view over several event lists, each one sorted by time.
+//
+// merge() does a k-way merge of the sources into an index of pointers to their events, so the
+// events are not copied again and the plugin sees a single time-ordered list. Events with the
+// same time keep the order of the sources as they were added.
+//
+// The index is allocated once: past MAX_EVENTS, the latest events are dropped and counted
+// rather than growing it on the audio thread.
+class EventMerger {
+public:
+   static constexpr uint32_t MAX_SOURCES = 8;
+   static constexpr uint32_t MAX_EVENTS = 4096;
+
+   EventMerger();
+
+   // main thread, before processing starts
+   void addSource(const clap::helpers::EventList &source);
+
+   void merge() noexcept;
+
+   uint32_t size() const noexcept { return _size; }
+   bool empty() const noexcept { return _size == 0; }
+   const clap_event_header *get(uint32_t index) const noexcept {
+      return index < _size ? _events[index] : nullptr;
+   }
+
+   // the events which didn't fit in the index since the last call, any thread
+   uint64_t takeDroppedCount() noexcept { return _droppedCount.exchange(0); }
+
+   const clap_input_events *clapInputEvents() const noexcept { return &_inputEvents; }
+
+private:
+   static uint32_t clapSize(const clap_input_events *list) noexcept;
+   static const clap_event_header *clapGet(const clap_input_events *list,
+                                           uint32_t index) noexcept;
+
+   std::array<const clap::helpers::EventList *, MAX_SOURCES> _sources = {};
+   uint32_t _sourceCount = 0;
+
+   std::vector<const clap_event_header *> _events; // MAX_EVENTS
+   uint32_t _size = 0;
+   std::atomic<uint64_t> _droppedCount = {0};
+   clap_input_events _inputEvents;
+};
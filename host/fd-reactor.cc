@@ -0,0 +1,169 @@
+#include <cerrno>
+
+#include <QDebug>
+
+#if defined(Q_OS_LINUX)
+#   include <unistd.h>
+#endif
+
+#include "fd-reactor.hh"
+
+FdReactor::FdReactor(Callback callback, Trigger trigger, QObject *parent)
+   : QObject(parent), _callback(std::move(callback)), _trigger(trigger) {
+#if defined(Q_OS_LINUX)
+   _epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+   if (_epollFd < 0) {
+      qWarning() << "epoll_create1() failed, the plugin's fds won't be watched:" << errno;
+      return;
+   }
+
+   _events.resize(MAX_EVENTS);
+   _epollNotifier.reset(new QSocketNotifier((qintptr)_epollFd, QSocketNotifier::Read));
+   connect(_epollNotifier.get(), &QSocketNotifier::activated, this, &FdReactor::dispatch);
+#endif
+}
+
+FdReactor::~FdReactor() {
+#if defined(Q_OS_LINUX)
+   _epollNotifier.reset();
+   if (_epollFd >= 0)
+      ::close(_epollFd);
+#endif
+}
+
+#if defined(Q_OS_LINUX)
+
+uint32_t FdReactor::epollEvents(clap_posix_fd_flags_t flags) const noexcept {
+   uint32_t events = 0;
+   if (flags & CLAP_POSIX_FD_READ)
+      events |= EPOLLIN;
+   if (flags & CLAP_POSIX_FD_WRITE)
+      events |= EPOLLOUT;
+   if (_trigger == Trigger::Edge)
+      events |= EPOLLET;
+
+   // EPOLLERR and EPOLLHUP are always reported
+   return events;
+}
+
+bool FdReactor::add(int fd, clap_posix_fd_flags_t flags) {
+   if (!_fds.emplace(fd, flags).second)
+      return false;
+
+   epoll_event event = {};
+   event.events = epollEvents(flags);
+   event.data.fd = fd;
+   if (_epollFd >= 0 && ::epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+      qWarning() << "epoll_ctl(EPOLL_CTL_ADD) failed for the plugin's fd" << fd << ":" << errno;
+   return true;
+}
+
+bool FdReactor::modify(int fd, clap_posix_fd_flags_t flags) {
+   auto it = _fds.find(fd);
+   if (it == _fds.end())
+      return false;
+
+   it->second = flags;
+
+   epoll_event event = {};
+   event.events = epollEvents(flags);
+   event.data.fd = fd;
+   if (_epollFd >= 0 && ::epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &event) != 0)
+      qWarning() << "epoll_ctl(EPOLL_CTL_MOD) failed for the plugin's fd" << fd << ":" << errno;
+   return true;
+}
+
+bool FdReactor::remove(int fd) {
+   auto it = _fds.find(fd);
+   if (it == _fds.end())
+      return false;
+
+   // fails if the plugin already closed the fd, which removed it from the epoll set
+   if (_epollFd >= 0)
+      ::epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+   _fds.erase(it);
+   return true;
+}
+
+void FdReactor::clear() {
+   while (!_fds.empty())
+      remove(_fds.begin()->first);
+}
+
+void FdReactor::dispatch() {
+   // The epoll fd stays readable while more fds are ready: the notifier fires again for the next
+   // batch, leaving room for the other events of the loop.
+   const int count = ::epoll_wait(_epollFd, _events.data(), _events.size(), 0);
+   for (int i = 0; i < count; ++i) {
+      const int fd = _events[i].data.fd;
+      const uint32_t events = _events[i].events;
+
+      // an earlier callback of the batch may have unregistered it
+      auto it = _fds.find(fd);
+      if (it == _fds.end())
+         continue;
+
+      clap_posix_fd_flags_t flags = 0;
+      if (events & (EPOLLIN | EPOLLHUP))
+         flags |= CLAP_POSIX_FD_READ;
+      if (events & EPOLLOUT)
+         flags |= CLAP_POSIX_FD_WRITE;
+      if (events & EPOLLERR)
+         flags |= CLAP_POSIX_FD_ERROR;
+
+      flags &= it->second | CLAP_POSIX_FD_ERROR;
+      if (flags)
+         _callback(fd, flags);
+   }
+}
+
+#else
+
+bool FdReactor::add(int fd, clap_posix_fd_flags_t flags) {
+   auto [it, isInserted] = _fds.try_emplace(fd);
+   if (!isInserted)
+      return false;
+
+   setNotifierFlags(fd, it->second, flags);
+   return true;
+}
+
+bool FdReactor::modify(int fd, clap_posix_fd_flags_t flags) {
+   auto it = _fds.find(fd);
+   if (it == _fds.end())
+      return false;
+
+   setNotifierFlags(fd, it->second, flags);
+   return true;
+}
+
+bool FdReactor::remove(int fd) { return _fds.erase(fd) > 0; }
+
+void FdReactor::clear() { _fds.clear(); }
+
+void FdReactor::setNotifierFlags(int fd, Notifiers &notifiers, clap_posix_fd_flags_t flags) {
+   // the notifiers are kept when disabled, to be enabled again by the next modify()
+   if (flags & CLAP_POSIX_FD_READ) {
+      if (!notifiers.rd) {
+         notifiers.rd.reset(new QSocketNotifier((qintptr)fd, QSocketNotifier::Read));
+         connect(notifiers.rd.get(), &QSocketNotifier::activated, this, [this, fd] {
+            _callback(fd, CLAP_POSIX_FD_READ);
+         });
+      }
+      notifiers.rd->setEnabled(true);
+   } else if (notifiers.rd)
+      notifiers.rd->setEnabled(false);
+
+   if (flags & CLAP_POSIX_FD_WRITE) {
+      if (!notifiers.wr) {
+         notifiers.wr.reset(new QSocketNotifier((qintptr)fd, QSocketNotifier::Write));
+         connect(notifiers.wr.get(), &QSocketNotifier::activated, this, [this, fd] {
+            _callback(fd, CLAP_POSIX_FD_WRITE);
+         });
+      }
+      notifiers.wr->setEnabled(true);
+   } else if (notifiers.wr)
+      notifiers.wr->setEnabled(false);
+}
+
+#endif
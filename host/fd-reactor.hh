@@ -0,0 +1,74 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <QtGlobal>
+
+#include <clap/clap.h>
+
+#if defined(Q_OS_LINUX)
+#   include <sys/epoll.h>
+#endif
+
+// The file descriptors registered by the plugin, from clap_host_posix_fd_support.
+//
+// On Linux, they are all watched by one epoll instance, itself watched by a single
+// QSocketNotifier: modifying the flags of a fd is an epoll_ctl() call, and the ready fds are
+// dispatched in batches of up to MAX_EVENTS. Elsewhere, each fd gets a QSocketNotifier per
+// direction, created once and enabled or disabled by modify().
+class FdReactor : public QObject {
+   Q_OBJECT
+
+public:
+   enum class Trigger {
+      // the callback is called for as long as the fd is ready
+      Level,
+
+      // the callback is called once each time the fd becomes ready, epoll only
+      Edge,
+   };
+
+   static constexpr int MAX_EVENTS = 64;
+
+   using Callback = std::function<void(int fd, clap_posix_fd_flags_t flags)>;
+
+   explicit FdReactor(Callback callback,
+                      Trigger trigger = Trigger::Level,
+                      QObject *parent = nullptr);
+   ~FdReactor() override;
+
+   // return false if the fd is already registered, or not registered for modify() and remove()
+   bool add(int fd, clap_posix_fd_flags_t flags);
+   bool modify(int fd, clap_posix_fd_flags_t flags);
+   bool remove(int fd);
+   void clear();
+
+private:
+   Callback _callback;
+   const Trigger _trigger;
+
+#if defined(Q_OS_LINUX)
+   uint32_t epollEvents(clap_posix_fd_flags_t flags) const noexcept;
+   void dispatch();
+
+   int _epollFd = -1;
+   std::unique_ptr<QSocketNotifier> _epollNotifier;
+   std::vector<epoll_event> _events;
+
+   std::unordered_map<int, clap_posix_fd_flags_t> _fds;
+#else
+   struct Notifiers {
+      std::unique_ptr<QSocketNotifier> rd;
+      std::unique_ptr<QSocketNotifier> wr;
+   };
+
+   void setNotifierFlags(int fd, Notifiers &notifiers, clap_posix_fd_flags_t flags);
+
+   std::unordered_map<int, Notifiers> _fds;
+#endif
+};
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cmath>
+
+#include "latency-probe.hh"
+
+void LatencyProbe::prepare(uint32_t maxLatency) {
+   _stage.store(Idle, std::memory_order_release);
+
+   if (_burst.empty()) {
+      // xorshift32 white noise, the same burst on every run
+      _burst.resize(BURST_LENGTH);
+      uint32_t x = 0x9e3779b9;
+      for (auto &s : _burst) {
+         x ^= x << 13;
+         x ^= x >> 17;
+         x ^= x << 5;
+         s = 0.5f * (float(x) / float(UINT32_MAX) * 2.f - 1.f);
+      }
+   }
+
+   _recording.assign(maxLatency + 2 * BURST_LENGTH, 0.f);
+}
+
+bool LatencyProbe::start() {
+   if (_recording.empty() || isRunning())
+      return false;
+
+   _generated = 0;
+   _recorded = 0;
+   _stage.store(Running, std::memory_order_release);
+   return true;
+}
+
+void LatencyProbe::generate(float *const *inputs, uint32_t channelCount, uint32_t frames) noexcept {
+   for (uint32_t i = 0; i < frames; ++i) {
+      const float s = _generated < BURST_LENGTH ? _burst[_generated] : 0.f;
+      ++_generated;
+      for (uint32_t c = 0; c < channelCount; ++c)
+         inputs[c][i] = s;
+   }
+}
+
+void LatencyProbe::record(float *const *outputs, uint32_t channelCount, uint32_t frames) noexcept {
+   if (channelCount == 0)
+      return;
+
+   const uint32_t n = std::min<uint32_t>(frames, _recording.size() - _recorded);
+   std::copy_n(outputs[0], n, _recording.data() + _recorded);
+   _recorded += n;
+
+   for (uint32_t c = 0; c < channelCount; ++c)
+      std::fill_n(outputs[c], frames, 0.f);
+
+   if (_recorded == _recording.size())
+      _stage.store(Done, std::memory_order_release);
+}
+
+std::optional<uint32_t> LatencyProbe::measure() {
+   if (!isDone())
+      return std::nullopt;
+   _stage.store(Idle, std::memory_order_release);
+
+   double burstEnergy = 0;
+   for (auto s : _burst)
+      burstEnergy += double(s) * s;
+
+   // energy of the recording window under the burst, updated as the window slides
+   double windowEnergy = 0;
+   for (uint32_t k = 0; k < BURST_LENGTH; ++k)
+      windowEnergy += double(_recording[k]) * _recording[k];
+
+   const uint32_t lagCount = _recording.size() - BURST_LENGTH + 1;
+   double bestScore = 0;
+   uint32_t bestLag = 0;
+   for (uint32_t lag = 0; lag < lagCount; ++lag) {
+      if (lag > 0) {
+         const double out = _recording[lag - 1];
+         const double in = _recording[lag + BURST_LENGTH - 1];
+         windowEnergy = std::max(0.0, windowEnergy - out * out + in * in);
+      }
+
+      if (windowEnergy <= 0)
+         continue;
+
+      double corr = 0;
+      for (uint32_t k = 0; k < BURST_LENGTH; ++k)
+         corr += double(_recording[lag + k]) * _burst[k];
+
+      // normalized correlation coefficient, insensitive to the plugin's gain and polarity
+      const double score = std::abs(corr) / std::sqrt(burstEnergy * windowEnergy);
+      if (score > bestScore) {
+         bestScore = score;
+         bestLag = lag;
+      }
+   }
+
+   if (bestScore < 0.5)
+      return std::nullopt;
+   return bestLag;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Measures the actual latency of a plugin by sending a noise burst through its first input and
+// cross-correlating it with what comes out of its first output.
+//
+// prepare(), start() and measure() are called on the main thread, generate() and record() on the
+// audio thread around the plugin's process() call. While the probe runs, the plugin's inputs are
+// replaced by the burst and its outputs are muted.
+class LatencyProbe {
+public:
+   static constexpr uint32_t BURST_LENGTH = 512;
+
+   void prepare(uint32_t maxLatency);
+   bool start();
+
+   bool isRunning() const noexcept { return _stage.load(std::memory_order_acquire) == Running; }
+   bool isDone() const noexcept { return _stage.load(std::memory_order_acquire) == Done; }
+
+   // audio thread
+   void generate(float *const *inputs, uint32_t channelCount, uint32_t frames) noexcept;
+   void record(float *const *outputs, uint32_t channelCount, uint32_t frames) noexcept;
+
+   // Returns the lag of the correlation peak, or nothing if the burst could not be found in the
+   // recording, which is expected for instruments.
+   std::optional<uint32_t> measure();
+
+private:
+   enum Stage { Idle, Running, Done };
+
+   std::atomic<int> _stage = {Idle};
+   std::vector<float> _burst;
+   std::vector<float> _recording;
+   uint32_t _generated = 0;
+   uint32_t _recorded = 0;
+};
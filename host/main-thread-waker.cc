@@ -0,0 +1,81 @@
+#include <cstdint>
+
+#include <QtGlobal>
+
+#if defined(Q_OS_LINUX)
+#   include <sys/eventfd.h>
+#   include <unistd.h>
+#elif defined(Q_OS_UNIX)
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+#include "main-thread-waker.hh"
+
+MainThreadWaker::MainThreadWaker(QObject *parent) : QObject(parent), _pollTimer(this) {
+#if defined(Q_OS_LINUX)
+   _readFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+   _writeFd = _readFd;
+#elif defined(Q_OS_UNIX)
+   int fds[2];
+   if (::pipe(fds) == 0) {
+      for (int fd : fds) {
+         ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+         ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+      }
+      _readFd = fds[0];
+      _writeFd = fds[1];
+   }
+#endif
+
+   if (_readFd >= 0) {
+      _notifier.reset(new QSocketNotifier(_readFd, QSocketNotifier::Read));
+      connect(_notifier.get(), &QSocketNotifier::activated, this, &MainThreadWaker::handleWakeup);
+      return;
+   }
+
+   // no descriptor to wake the event loop with, poll as often as the host used to
+   connect(&_pollTimer, &QTimer::timeout, this, [this] {
+      if (_isPending.load(std::memory_order_acquire))
+         handleWakeup();
+   });
+   _pollTimer.start(1000 / 30);
+}
+
+MainThreadWaker::~MainThreadWaker() {
+   _notifier.reset();
+
+#if defined(Q_OS_UNIX)
+   if (_writeFd >= 0 && _writeFd != _readFd)
+      ::close(_writeFd);
+   if (_readFd >= 0)
+      ::close(_readFd);
+#endif
+}
+
+void MainThreadWaker::wake() noexcept {
+   if (_isPending.exchange(true, std::memory_order_acq_rel))
+      return;
+
+#if defined(Q_OS_UNIX)
+   if (_writeFd >= 0) {
+      // the descriptor is non-blocking: if it is full, the main thread is already woken
+      const uint64_t one = 1;
+      [[maybe_unused]] auto written = ::write(_writeFd, &one, sizeof(one));
+   }
+#endif
+}
+
+void MainThreadWaker::handleWakeup() {
+#if defined(Q_OS_UNIX)
+   if (_readFd >= 0) {
+      uint64_t buffer[16];
+      while (::read(_readFd, buffer, sizeof(buffer)) > 0)
+         continue;
+   }
+#endif
+
+   // Cleared before the work is done, so a request made meanwhile wakes us again.
+   _isPending.store(false, std::memory_order_release);
+   emit woken();
+}
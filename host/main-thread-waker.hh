@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <QTimer>
+
+// Wakes the main thread's event loop from any thread.
+//
+// wake() doesn't lock nor allocate, so the audio thread and the plugin's threads can call it: the
+// first call writes to an eventfd (a pipe outside of Linux) watched by a QSocketNotifier, the
+// following ones are folded into it until the main thread has handled the wakeup. Where there is
+// no such descriptor, the main thread polls for the pending wakeup instead.
+class MainThreadWaker : public QObject {
+   Q_OBJECT
+
+public:
+   explicit MainThreadWaker(QObject *parent = nullptr);
+   ~MainThreadWaker() override;
+
+   // any thread
+   void wake() noexcept;
+
+signals:
+   // main thread
+   void woken();
+
+private:
+   void handleWakeup();
+
+   std::atomic<bool> _isPending = {false};
+
+   int _readFd = -1;
+   int _writeFd = -1;
+   std::unique_ptr<QSocketNotifier> _notifier;
+
+   QTimer _pollTimer;
+};
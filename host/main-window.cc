@@ -6,6 +6,7 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QMenuBar>
+#include <QStatusBar>
 #include <QToolBar>
 #include <QWindow>
 #include <QUrl>
@@ -36,6 +37,15 @@ MainWindow::MainWindow(Application &app)
 
    _pluginParametersWidget = new PluginParametersWidget(nullptr, pluginHost);
    _pluginRemoteControlsWidget = new PluginQuickControlsWidget(nullptr, pluginHost);
+
+   _pluginLatencyLabel = new QLabel(this);
+   statusBar()->addPermanentWidget(_pluginLatencyLabel);
+   updatePluginLatency(pluginHost.pluginLatency());
+   connect(&pluginHost, &PluginHost::pluginLatencyChanged, this, &MainWindow::updatePluginLatency);
+   connect(&pluginHost,
+           &PluginHost::pluginLatencyMeasured,
+           this,
+           &MainWindow::showMeasuredPluginLatency);
 }
 
 MainWindow::~MainWindow() {}
@@ -52,6 +62,21 @@ void MainWindow::createMenu() {
            &QAction::triggered,
            this,
            &MainWindow::loadNativePluginPreset);
+   _loadPluginStateAction = fileMenu->addAction(tr("Load Plugin State..."));
+   connect(_loadPluginStateAction, &QAction::triggered, this, &MainWindow::loadPluginState);
+   _savePluginStateAction = fileMenu->addAction(tr("Save Plugin State..."));
+   connect(_savePluginStateAction, &QAction::triggered, this, &MainWindow::savePluginState);
+   fileMenu->addSeparator();
+   _bypassPluginAction = fileMenu->addAction(tr("Bypass Plugin"));
+   _bypassPluginAction->setCheckable(true);
+   connect(_bypassPluginAction, &QAction::toggled, [this](bool checked) {
+      _application.engine()->pluginHost().setBypassed(checked);
+   });
+   _measurePluginLatencyAction = fileMenu->addAction(tr("Measure Plugin Latency"));
+   connect(_measurePluginLatencyAction, &QAction::triggered, [this] {
+      if (!_application.engine()->pluginHost().measureLatency())
+         statusBar()->showMessage(tr("The plugin must be active to measure its latency"), 5000);
+   });
    fileMenu->addSeparator();
    connect(fileMenu->addAction(tr("Settings")),
            &QAction::triggered,
@@ -63,6 +88,23 @@ void MainWindow::createMenu() {
            QApplication::instance(),
            &Application::quit);
 
+   _snapshotsMenu = menuBar->addMenu(tr("Snapshots"));
+   for (int i = 0; i < PluginHost::STATE_SNAPSHOT_COUNT; ++i) {
+      auto action = _snapshotsMenu->addAction(tr("Recall Snapshot %1").arg(i + 1));
+      action->setShortcut(QKeySequence(Qt::CTRL | Qt::Key(Qt::Key_1 + i)));
+      connect(action, &QAction::triggered, [this, i] {
+         _application.engine()->pluginHost().recallStateSnapshot(i);
+      });
+   }
+   _snapshotsMenu->addSeparator();
+   for (int i = 0; i < PluginHost::STATE_SNAPSHOT_COUNT; ++i) {
+      auto action = _snapshotsMenu->addAction(tr("Store Snapshot %1").arg(i + 1));
+      action->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key(Qt::Key_1 + i)));
+      connect(action, &QAction::triggered, [this, i] {
+         _application.engine()->pluginHost().storeStateSnapshot(i);
+      });
+   }
+
    auto windowsMenu = menuBar->addMenu("Windows");
 
    _showPluginParametersAction = windowsMenu->addAction(tr("Show Parameters"));
@@ -107,12 +149,29 @@ void MainWindow::createMenu() {
 
 void MainWindow::updatePluginMenuItems(bool const pluginLoaded /* = false */ ) {
    _loadPluginPresetAction->setEnabled(pluginLoaded);
+   _loadPluginStateAction->setEnabled(pluginLoaded);
+   _savePluginStateAction->setEnabled(pluginLoaded);
+   _bypassPluginAction->setEnabled(pluginLoaded);
+   _measurePluginLatencyAction->setEnabled(pluginLoaded);
+   _snapshotsMenu->setEnabled(pluginLoaded);
    _showPluginParametersAction->setEnabled(pluginLoaded);
    _showPluginQuickControlsAction->setEnabled(pluginLoaded);
    _togglePluginWindowVisibilityAction->setEnabled(pluginLoaded);
    _recreatePluginWindowAction->setEnabled(pluginLoaded);
 }
 
+void MainWindow::updatePluginLatency(uint32_t latency) {
+   const double ms = 1000.0 * latency / _application.engine()->sampleRate();
+   _pluginLatencyLabel->setText(tr("Latency: %1 samples (%2 ms)").arg(latency).arg(ms, 0, 'f', 1));
+}
+
+void MainWindow::showMeasuredPluginLatency(int measured) {
+   if (measured < 0)
+      statusBar()->showMessage(tr("Could not measure the plugin latency"), 5000);
+   else
+      statusBar()->showMessage(tr("Measured latency: %1 samples").arg(measured), 5000);
+}
+
 void MainWindow::showSettingsDialog() {
    SettingsDialog dialog(Application::instance().settings(), this);
    dialog.exec();
@@ -148,6 +207,22 @@ void MainWindow::loadNativePluginPreset() {
    _application.engine()->pluginHost().loadNativePluginPreset(file.toStdString());
 }
 
+void MainWindow::loadPluginState() {
+   auto file = QFileDialog::getOpenFileName(this, tr("Load Plugin State"));
+   if (file.isEmpty())
+      return;
+
+   _application.engine()->pluginHost().loadStateFromFile(file.toStdString());
+}
+
+void MainWindow::savePluginState() {
+   auto file = QFileDialog::getSaveFileName(this, tr("Save Plugin State"));
+   if (file.isEmpty())
+      return;
+
+   _application.engine()->pluginHost().saveStateToFile(file.toStdString());
+}
+
 void MainWindow::togglePluginWindowVisibility() {
    bool isVisible = !_pluginViewWidget->isVisible();
    _pluginViewWidget->setVisible(isVisible);
@@ -3,6 +3,7 @@
 #include <QMainWindow>
 #include <QKeyEvent>
 
+class QLabel;
 class Application;
 class SettingsDialog;
 class PluginParametersWidget;
@@ -21,6 +22,8 @@ public:
 
 public:
    void loadNativePluginPreset();
+   void loadPluginState();
+   void savePluginState();
    void showSettingsDialog();
    void showPluginParametersWindow();
    void showPluginQuickControlsWindow();
@@ -42,12 +45,19 @@ private:
    void recreatePluginWindow();
    void showAboutDialog();
    void updatePluginMenuItems(bool pluginLoaded = false);
+   void updatePluginLatency(uint32_t latency);
+   void showMeasuredPluginLatency(int measured);
 
    Application &_application;
    QWindow *_pluginViewWindow = nullptr;
    QWidget *_pluginViewWidget = nullptr;
 
    QAction *_loadPluginPresetAction = nullptr;
+   QAction *_loadPluginStateAction = nullptr;
+   QAction *_savePluginStateAction = nullptr;
+   QAction *_bypassPluginAction = nullptr;
+   QAction *_measurePluginLatencyAction = nullptr;
+   QMenu *_snapshotsMenu = nullptr;
    QAction *_showPluginParametersAction = nullptr;
    QAction *_showPluginQuickControlsAction = nullptr;
    QAction *_togglePluginWindowVisibilityAction = nullptr;
@@ -55,4 +65,6 @@ private:
 
    PluginParametersWidget *_pluginParametersWidget = nullptr;
    PluginQuickControlsWidget *_pluginRemoteControlsWidget = nullptr;
+
+   QLabel *_pluginLatencyLabel = nullptr;
 };
@@ -0,0 +1,397 @@
+#include "midi-translator.hh"
+
+const std::array<MidiTranslator::MessageType, 7> MidiTranslator::_messageTypes = {{
+   {2, &MidiTranslator::noteOff},         // 0x8
+   {2, &MidiTranslator::noteOn},          // 0x9
+   {2, &MidiTranslator::polyPressure},    // 0xA
+   {2, &MidiTranslator::controlChange},   // 0xB
+   {1, &MidiTranslator::programChange},   // 0xC
+   {1, &MidiTranslator::channelPressure}, // 0xD
+   {2, &MidiTranslator::pitchBend},       // 0xE
+}};
+
+// Number of data bytes following a system common status byte
+static uint32_t systemCommonDataSize(uint8_t status) noexcept {
+   switch (status) {
+   case 0xF1:
+   case 0xF3:
+      return 1;
+   case 0xF2:
+      return 2;
+   default:
+      return 0;
+   }
+}
+
+// MIDI 2.0 value upscaling (min-center-max), as specified by the MIDI 1.0 to MIDI 2.0 translation
+static uint32_t scaleUp(uint32_t value, uint32_t srcBits, uint32_t dstBits) noexcept {
+   const uint32_t scaleBits = dstBits - srcBits;
+   uint32_t result = value << scaleBits;
+   if (value <= (1u << (srcBits - 1)))
+      return result;
+
+   const uint32_t repeatBits = srcBits - 1;
+   uint32_t repeat = value & ((1u << repeatBits) - 1);
+   if (scaleBits > repeatBits)
+      repeat <<= scaleBits - repeatBits;
+   else
+      repeat >>= repeatBits - scaleBits;
+
+   while (repeat != 0) {
+      result |= repeat;
+      repeat >>= repeatBits;
+   }
+   return result;
+}
+
+MidiTranslator::MidiTranslator() {
+   _rpn.fill(RPN_NULL);
+   _pitchBendRange.fill(2);
+   reset();
+}
+
+void MidiTranslator::setDialects(uint32_t supportedDialects, uint32_t preferredDialect) {
+   _canSendMidi = supportedDialects & (CLAP_NOTE_DIALECT_MIDI | CLAP_NOTE_DIALECT_MIDI_MPE);
+
+   if (preferredDialect & (CLAP_NOTE_DIALECT_MIDI | CLAP_NOTE_DIALECT_MIDI_MPE))
+      _dialect = CLAP_NOTE_DIALECT_MIDI;
+   else if (preferredDialect & CLAP_NOTE_DIALECT_MIDI2)
+      _dialect = CLAP_NOTE_DIALECT_MIDI2;
+   else
+      _dialect = CLAP_NOTE_DIALECT_CLAP;
+}
+
+void MidiTranslator::reset() {
+   _runningStatus = 0;
+   for (auto &channel : _noteIds)
+      channel.fill(-1);
+}
+
+bool MidiTranslator::isMpeMemberChannel(int channel) const noexcept {
+   if (1 <= channel && channel <= _lowerZoneMemberCount)
+      return true;
+   if (14 - _upperZoneMemberCount < channel && channel <= 14)
+      return true;
+   return false;
+}
+
+void MidiTranslator::translate(uint32_t time,
+                               const uint8_t *data,
+                               uint32_t size,
+                               EventList &out) noexcept {
+   uint32_t i = 0;
+   while (i < size) {
+      const uint8_t byte = data[i];
+
+      // real-time messages may be interleaved anywhere, and don't affect the running status
+      if (byte >= 0xF8) {
+         ++i;
+         continue;
+      }
+
+      if (byte >= 0xF0) {
+         _runningStatus = 0;
+         ++i;
+         if (byte == 0xF0) {
+            while (i < size && data[i] != 0xF7)
+               ++i;
+            ++i;
+         } else
+            i += systemCommonDataSize(byte);
+         continue;
+      }
+
+      uint8_t status = _runningStatus;
+      if (byte & 0x80) {
+         status = byte;
+         _runningStatus = byte;
+         ++i;
+      } else if (!status) {
+         // stray data byte
+         ++i;
+         continue;
+      }
+
+      const auto &type = _messageTypes[(status >> 4) - 8];
+      if (i + type.dataSize > size)
+         return;
+
+      const uint8_t channel = status & 0x0F;
+      const uint8_t data1 = data[i] & 0x7F;
+      const uint8_t data2 = type.dataSize > 1 ? data[i + 1] & 0x7F : 0;
+      i += type.dataSize;
+
+      if ((status & 0xF0) == 0xB0)
+         trackControlChange(channel, data1, data2);
+
+      switch (_dialect) {
+      case CLAP_NOTE_DIALECT_MIDI:
+         pushMidi(time, status, data1, data2, out);
+         break;
+
+      case CLAP_NOTE_DIALECT_MIDI2:
+         pushMidi2(time, status, data1, data2, out);
+         break;
+
+      default:
+         (this->*type.toClap)(time, channel, data1, data2, out);
+         break;
+      }
+   }
+}
+
+//////////////////
+// CLAP dialect //
+//////////////////
+
+void MidiTranslator::noteOff(
+   uint32_t time, uint8_t channel, uint8_t key, uint8_t velocity, EventList &out) {
+   int32_t &noteId = _noteIds[channel][key];
+   pushNote(CLAP_EVENT_NOTE_OFF, time, channel, key, noteId, velocity / 127.0, out);
+   noteId = -1;
+}
+
+void MidiTranslator::noteOn(
+   uint32_t time, uint8_t channel, uint8_t key, uint8_t velocity, EventList &out) {
+   if (velocity == 0) {
+      noteOff(time, channel, key, 64, out);
+      return;
+   }
+
+   const int32_t noteId = _nextNoteId;
+   _nextNoteId = _nextNoteId == INT32_MAX ? 0 : _nextNoteId + 1;
+   _noteIds[channel][key] = noteId;
+   pushNote(CLAP_EVENT_NOTE_ON, time, channel, key, noteId, velocity / 127.0, out);
+}
+
+void MidiTranslator::polyPressure(
+   uint32_t time, uint8_t channel, uint8_t key, uint8_t pressure, EventList &out) {
+   pushNoteExpression(CLAP_NOTE_EXPRESSION_PRESSURE,
+                      time,
+                      channel,
+                      key,
+                      _noteIds[channel][key],
+                      pressure / 127.0,
+                      out);
+}
+
+void MidiTranslator::controlChange(
+   uint32_t time, uint8_t channel, uint8_t cc, uint8_t value, EventList &out) {
+   // MPE timbre
+   if (cc == 74 && isMpeMemberChannel(channel)) {
+      pushNoteExpression(
+         CLAP_NOTE_EXPRESSION_BRIGHTNESS, time, channel, -1, -1, value / 127.0, out);
+      return;
+   }
+
+   pushMidi(time, 0xB0 | channel, cc, value, out);
+}
+
+void MidiTranslator::programChange(
+   uint32_t time, uint8_t channel, uint8_t program, uint8_t, EventList &out) {
+   pushMidi(time, 0xC0 | channel, program, 0, out);
+}
+
+void MidiTranslator::channelPressure(
+   uint32_t time, uint8_t channel, uint8_t pressure, uint8_t, EventList &out) {
+   if (isMpeMemberChannel(channel)) {
+      pushNoteExpression(
+         CLAP_NOTE_EXPRESSION_PRESSURE, time, channel, -1, -1, pressure / 127.0, out);
+      return;
+   }
+
+   pushMidi(time, 0xD0 | channel, pressure, 0, out);
+}
+
+void MidiTranslator::pitchBend(
+   uint32_t time, uint8_t channel, uint8_t lsb, uint8_t msb, EventList &out) {
+   if (isMpeMemberChannel(channel)) {
+      const int value = ((msb << 7) | lsb) - 8192;
+      const double semitones = value / 8192.0 * _pitchBendRange[channel];
+      pushNoteExpression(CLAP_NOTE_EXPRESSION_TUNING, time, channel, -1, -1, semitones, out);
+      return;
+   }
+
+   pushMidi(time, 0xE0 | channel, lsb, msb, out);
+}
+
+void MidiTranslator::pushNote(uint16_t type,
+                              uint32_t time,
+                              uint8_t channel,
+                              uint8_t key,
+                              int32_t noteId,
+                              double velocity,
+                              EventList &out) {
+   clap_event_note ev;
+   ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+   ev.header.type = type;
+   ev.header.time = time;
+   ev.header.flags = 0;
+   ev.header.size = sizeof(ev);
+   ev.port_index = 0;
+   ev.key = key;
+   ev.channel = channel;
+   ev.note_id = noteId;
+   ev.velocity = velocity;
+
+   out.push(&ev.header);
+}
+
+void MidiTranslator::pushNoteExpression(clap_note_expression expression,
+                                        uint32_t time,
+                                        uint8_t channel,
+                                        int16_t key,
+                                        int32_t noteId,
+                                        double value,
+                                        EventList &out) {
+   clap_event_note_expression ev;
+   ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+   ev.header.type = CLAP_EVENT_NOTE_EXPRESSION;
+   ev.header.time = time;
+   ev.header.flags = 0;
+   ev.header.size = sizeof(ev);
+   ev.expression_id = expression;
+   ev.port_index = 0;
+   ev.key = key;
+   ev.channel = channel;
+   ev.note_id = noteId;
+   ev.value = value;
+
+   out.push(&ev.header);
+}
+
+/////////////////////////////
+// MIDI and MIDI2 dialects //
+/////////////////////////////
+
+void MidiTranslator::pushMidi(
+   uint32_t time, uint8_t status, uint8_t data1, uint8_t data2, EventList &out) {
+   if (!_canSendMidi)
+      return;
+
+   clap_event_midi ev;
+   ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+   ev.header.type = CLAP_EVENT_MIDI;
+   ev.header.time = time;
+   ev.header.flags = 0;
+   ev.header.size = sizeof(ev);
+   ev.port_index = 0;
+   ev.data[0] = status;
+   ev.data[1] = data1;
+   ev.data[2] = data2;
+
+   out.push(&ev.header);
+}
+
+void MidiTranslator::pushMidi2(
+   uint32_t time, uint8_t status, uint8_t data1, uint8_t data2, EventList &out) {
+   uint8_t opcode = status >> 4;
+   uint8_t index = data1;
+   uint32_t value;
+
+   switch (opcode) {
+   case 0x9:
+      if (data2 == 0) {
+         // note on with a velocity of 0 is a note off in MIDI 2.0
+         opcode = 0x8;
+         value = scaleUp(64, 7, 16) << 16;
+         break;
+      }
+      [[fallthrough]];
+   case 0x8:
+      value = scaleUp(data2, 7, 16) << 16;
+      break;
+
+   case 0xA:
+   case 0xB:
+      value = scaleUp(data2, 7, 32);
+      break;
+
+   case 0xC:
+      index = 0;
+      value = uint32_t(data1) << 24;
+      break;
+
+   case 0xD:
+      index = 0;
+      value = scaleUp(data1, 7, 32);
+      break;
+
+   case 0xE:
+      index = 0;
+      value = scaleUp((data2 << 7) | data1, 14, 32);
+      break;
+
+   default:
+      return;
+   }
+
+   clap_event_midi2 ev;
+   ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+   ev.header.type = CLAP_EVENT_MIDI2;
+   ev.header.time = time;
+   ev.header.flags = 0;
+   ev.header.size = sizeof(ev);
+   ev.port_index = 0;
+   // message type 4: MIDI 2.0 channel voice, group 0
+   ev.data[0] = (0x4u << 28) | (uint32_t(opcode) << 20) | (uint32_t(status & 0x0F) << 16) |
+                (uint32_t(index) << 8);
+   ev.data[1] = value;
+   ev.data[2] = 0;
+   ev.data[3] = 0;
+
+   out.push(&ev.header);
+}
+
+/////////////
+// RPN/MPE //
+/////////////
+
+void MidiTranslator::trackControlChange(uint8_t channel, uint8_t cc, uint8_t value) noexcept {
+   auto &rpn = _rpn[channel];
+
+   switch (cc) {
+   case 101: // RPN MSB
+      rpn = (rpn & 0x007F) | (value << 7);
+      break;
+
+   case 100: // RPN LSB
+      rpn = (rpn & 0x3F80) | value;
+      break;
+
+   case 98: // NRPN LSB
+   case 99: // NRPN MSB
+      rpn = RPN_NULL;
+      break;
+
+   case 6: // data entry MSB
+      if (rpn == 0x0000)
+         _pitchBendRange[channel] = value;
+      else if (rpn == 0x0006 && (channel == 0 || channel == 15))
+         setMpeZone(channel, value);
+      break;
+   }
+}
+
+void MidiTranslator::setMpeZone(uint8_t managerChannel, uint8_t memberCount) noexcept {
+   if (memberCount > 15)
+      memberCount = 15;
+
+   // The zones can't overlap, the last configured one wins.
+   if (managerChannel == 0) {
+      _lowerZoneMemberCount = memberCount;
+      if (_upperZoneMemberCount > 14 - memberCount)
+         _upperZoneMemberCount = memberCount >= 14 ? 0 : 14 - memberCount;
+   } else {
+      _upperZoneMemberCount = memberCount;
+      if (_lowerZoneMemberCount > 14 - memberCount)
+         _lowerZoneMemberCount = memberCount >= 14 ? 0 : 14 - memberCount;
+   }
+
+   // default pitch bend ranges from the MPE specification
+   _pitchBendRange[managerChannel] = 2;
+   for (int channel = 0; channel < 16; ++channel) {
+      if (isMpeMemberChannel(channel))
+         _pitchBendRange[channel] = 48;
+   }
+}
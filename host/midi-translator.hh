@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <clap/clap.h>
+#include <clap/helpers/event-list.hh>
+
+// Translates raw MIDI 1.0 bytes into CLAP events, in the note dialect preferred by the plugin:
+// - CLAP: notes with host assigned note_ids, and note expressions for the per-note messages
+//   (poly pressure, and pitch bend, channel pressure and CC74 on MPE member channels)
+// - MIDI: the messages are forwarded as CLAP_EVENT_MIDI
+// - MIDI2: the messages are converted to MIDI 2.0 channel voice messages
+//
+// MPE zones are configured by the MPE Configuration Message (RPN 6), as a MIDI controller would.
+// System messages are ignored.
+//
+// Not thread safe: setDialects() and reset() are called on the thread which calls translate(),
+// the audio thread for the host. translate() doesn't allocate beside pushing into the event list.
+class MidiTranslator {
+public:
+   MidiTranslator();
+
+   void setDialects(uint32_t supportedDialects, uint32_t preferredDialect);
+
+   // Forgets the notes in flight, the MPE configuration is kept as it comes from the controller.
+   void reset();
+
+   // Translates a buffer of MIDI messages, running status is supported. All the resulting
+   // events are stamped with time.
+   void translate(uint32_t time,
+                  const uint8_t *data,
+                  uint32_t size,
+                  clap::helpers::EventList &out) noexcept;
+
+   bool isMpeMemberChannel(int channel) const noexcept;
+
+private:
+   using EventList = clap::helpers::EventList;
+   using Handler = void (MidiTranslator::*)(
+      uint32_t time, uint8_t channel, uint8_t data1, uint8_t data2, EventList &out);
+
+   struct MessageType {
+      uint8_t dataSize;
+      Handler toClap;
+   };
+
+   // indexed by the high nibble of the status byte, minus 8
+   static const std::array<MessageType, 7> _messageTypes;
+
+   /* CLAP dialect */
+   void noteOff(uint32_t time, uint8_t channel, uint8_t key, uint8_t velocity, EventList &out);
+   void noteOn(uint32_t time, uint8_t channel, uint8_t key, uint8_t velocity, EventList &out);
+   void polyPressure(uint32_t time, uint8_t channel, uint8_t key, uint8_t pressure, EventList &out);
+   void controlChange(uint32_t time, uint8_t channel, uint8_t cc, uint8_t value, EventList &out);
+   void programChange(uint32_t time, uint8_t channel, uint8_t program, uint8_t, EventList &out);
+   void channelPressure(uint32_t time, uint8_t channel, uint8_t pressure, uint8_t, EventList &out);
+   void pitchBend(uint32_t time, uint8_t channel, uint8_t lsb, uint8_t msb, EventList &out);
+
+   void pushNote(uint16_t type,
+                 uint32_t time,
+                 uint8_t channel,
+                 uint8_t key,
+                 int32_t noteId,
+                 double velocity,
+                 EventList &out);
+   void pushNoteExpression(clap_note_expression expression,
+                           uint32_t time,
+                           uint8_t channel,
+                           int16_t key,
+                           int32_t noteId,
+                           double value,
+                           EventList &out);
+
+   /* MIDI and MIDI2 dialects */
+   void pushMidi(uint32_t time, uint8_t status, uint8_t data1, uint8_t data2, EventList &out);
+   void pushMidi2(uint32_t time, uint8_t status, uint8_t data1, uint8_t data2, EventList &out);
+
+   void trackControlChange(uint8_t channel, uint8_t cc, uint8_t value) noexcept;
+   void setMpeZone(uint8_t managerChannel, uint8_t memberCount) noexcept;
+
+   uint32_t _dialect = CLAP_NOTE_DIALECT_CLAP;
+   bool _canSendMidi = true;
+
+   uint8_t _runningStatus = 0;
+
+   int32_t _nextNoteId = 0;
+   std::array<std::array<int32_t, 128>, 16> _noteIds;
+
+   /* RPN and MPE state */
+   static constexpr uint16_t RPN_NULL = 0x3fff;
+   std::array<uint16_t, 16> _rpn;
+   std::array<double, 16> _pitchBendRange;
+   uint8_t _lowerZoneMemberCount = 0;
+   uint8_t _upperZoneMemberCount = 0;
+};
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "param-store.hh"
+
+void ParamStore::clear() {
+   _values.clear();
+   _modulations.clear();
+   _ids.clear();
+   _cookies.clear();
+   _flags.clear();
+   _minValues.clear();
+   _maxValues.clear();
+   _defaultValues.clear();
+   _nameIds.clear();
+   _moduleIds.clear();
+   _isAdjusting.clear();
+   _shouldReduceChanges.clear();
+   _sortedIndex.clear();
+   _stringIndex.clear();
+   _strings.clear();
+}
+
+void ParamStore::reserve(uint32_t count) {
+   _values.reserve(count);
+   _modulations.reserve(count);
+   _ids.reserve(count);
+   _cookies.reserve(count);
+   _flags.reserve(count);
+   _minValues.reserve(count);
+   _maxValues.reserve(count);
+   _defaultValues.reserve(count);
+   _nameIds.reserve(count);
+   _moduleIds.reserve(count);
+   _isAdjusting.reserve(count);
+   _shouldReduceChanges.reserve(count);
+   _sortedIndex.reserve(count);
+}
+
+uint32_t ParamStore::add(const clap_param_info &info, double value) {
+   const uint32_t index = _ids.size();
+
+   _values.push_back(value);
+   _modulations.push_back(0);
+   _ids.push_back(info.id);
+   _cookies.push_back(info.cookie);
+   _flags.push_back(info.flags);
+   _minValues.push_back(info.min_value);
+   _maxValues.push_back(info.max_value);
+   _defaultValues.push_back(info.default_value);
+   _nameIds.push_back(intern(info.name, sizeof(info.name)));
+   _moduleIds.push_back(intern(info.module, sizeof(info.module)));
+   _isAdjusting.push_back(false);
+
+   // intermediate values of a stepped parameter are not worth sending
+   _shouldReduceChanges.push_back((info.flags & CLAP_PARAM_IS_STEPPED) != 0);
+
+   return index;
+}
+
+bool ParamStore::buildIndex(std::pair<uint32_t, uint32_t> &duplicate) {
+   _sortedIndex.clear();
+   for (uint32_t i = 0; i < _ids.size(); ++i)
+      _sortedIndex.emplace_back(_ids[i], i);
+   std::sort(_sortedIndex.begin(), _sortedIndex.end());
+
+   auto it = std::adjacent_find(_sortedIndex.begin(),
+                                _sortedIndex.end(),
+                                [](const auto &a, const auto &b) { return a.first == b.first; });
+   if (it == _sortedIndex.end())
+      return true;
+
+   duplicate = {it->second, std::next(it)->second};
+   return false;
+}
+
+int32_t ParamStore::indexOf(clap_id paramId) const noexcept {
+   auto it = std::lower_bound(_sortedIndex.begin(),
+                              _sortedIndex.end(),
+                              paramId,
+                              [](const auto &entry, clap_id id) { return entry.first < id; });
+   if (it == _sortedIndex.end() || it->first != paramId)
+      return -1;
+   return it->second;
+}
+
+uint32_t ParamStore::intern(const char *str, size_t maxSize) {
+   const std::string_view view(str, ::strnlen(str, maxSize));
+   auto it = _stringIndex.find(view);
+   if (it != _stringIndex.end())
+      return it->second;
+
+   const uint32_t id = _strings.size();
+   auto &stored = _strings.emplace_back(view);
+   _stringIndex.emplace(stored, id);
+   return id;
+}
+
+bool ParamStore::isInfoEqualTo(uint32_t index, const clap_param_info &info) const noexcept {
+   return info.cookie == _cookies[index] && info.default_value == _defaultValues[index] &&
+          info.max_value == _maxValues[index] && info.min_value == _minValues[index] &&
+          info.flags == _flags[index] && info.id == _ids[index] &&
+          name(index) == std::string_view(info.name, ::strnlen(info.name, sizeof(info.name))) &&
+          module(index) ==
+             std::string_view(info.module, ::strnlen(info.module, sizeof(info.module)));
+}
+
+bool ParamStore::isInfoCriticallyDifferentTo(uint32_t index,
+                                             const clap_param_info &info) const noexcept {
+   assert(_ids[index] == info.id);
+   const uint32_t criticalFlags =
+      CLAP_PARAM_IS_AUTOMATABLE | CLAP_PARAM_IS_AUTOMATABLE_PER_NOTE_ID |
+      CLAP_PARAM_IS_AUTOMATABLE_PER_KEY | CLAP_PARAM_IS_AUTOMATABLE_PER_CHANNEL |
+      CLAP_PARAM_IS_AUTOMATABLE_PER_PORT | CLAP_PARAM_IS_MODULATABLE |
+      CLAP_PARAM_IS_MODULATABLE_PER_NOTE_ID | CLAP_PARAM_IS_MODULATABLE_PER_KEY |
+      CLAP_PARAM_IS_MODULATABLE_PER_CHANNEL | CLAP_PARAM_IS_MODULATABLE_PER_PORT |
+      CLAP_PARAM_IS_READONLY | CLAP_PARAM_REQUIRES_PROCESS;
+   return (_flags[index] & criticalFlags) != (info.flags & criticalFlags) ||
+          _minValues[index] != info.min_value || _maxValues[index] != info.max_value;
+}
+
+void ParamStore::setInfo(uint32_t index, const clap_param_info &info) {
+   assert(_ids[index] == info.id);
+   _cookies[index] = info.cookie;
+   _flags[index] = info.flags;
+   _minValues[index] = info.min_value;
+   _maxValues[index] = info.max_value;
+   _defaultValues[index] = info.default_value;
+   _nameIds[index] = intern(info.name, sizeof(info.name));
+   _moduleIds[index] = intern(info.module, sizeof(info.module));
+}
+
+double ParamStore::modulatedValue(uint32_t index) const noexcept {
+   const double value = _values[index] + _modulations[index];
+   return std::min(_maxValues[index], std::max(_minValues[index], value));
+}
+
+bool ParamStore::setValue(uint32_t index, double value) noexcept {
+   if (_values[index] == value)
+      return false;
+
+   _values[index] = value;
+   return true;
+}
+
+bool ParamStore::setModulation(uint32_t index, double modulation) noexcept {
+   if (_modulations[index] == modulation)
+      return false;
+
+   _modulations[index] = modulation;
+   return true;
+}
+
+bool ParamStore::setIsAdjusting(uint32_t index, bool isAdjusting) noexcept {
+   if (bool(_isAdjusting[index]) == isAdjusting)
+      return false;
+
+   _isAdjusting[index] = isAdjusting;
+   return true;
+}
+
+void ParamStore::printShortInfo(uint32_t index, std::ostream &os) const {
+   os << "id: " << _ids[index] << ", name: '" << name(index) << "', module: '" << module(index)
+      << "'";
+}
+
+void ParamStore::printInfo(uint32_t index, std::ostream &os) const {
+   printShortInfo(index, os);
+   os << ", min: " << _minValues[index] << ", max: " << _maxValues[index];
+}
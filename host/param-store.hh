@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <clap/clap.h>
+
+// The plugin's parameters, as a structure of arrays.
+//
+// Each parameter lives at a dense index, in the order the plugin declared them; the index is only
+// stable until the next rebuild, while the param_id is stable for as long as the plugin keeps it.
+// Names and modules are interned, most parameters of a large plugin share a handful of modules,
+// and the values which change all the time are contiguous.
+//
+// Everything runs on the main thread, except indexOf() which the audio thread may use while the
+// plugin is active: the plugin can't add or remove parameters then.
+class ParamStore {
+public:
+   // building, from scratch
+   void clear();
+   void reserve(uint32_t count);
+   uint32_t add(const clap_param_info &info, double value);
+
+   // Sorts the id lookup once all the parameters are added, returns false and the two indexes
+   // if a param_id was declared twice.
+   bool buildIndex(std::pair<uint32_t, uint32_t> &duplicate);
+
+   uint32_t size() const noexcept { return _ids.size(); }
+   bool empty() const noexcept { return _ids.empty(); }
+
+   // returns -1 if the parameter is unknown
+   int32_t indexOf(clap_id paramId) const noexcept;
+
+   clap_id id(uint32_t index) const noexcept { return _ids[index]; }
+   void *cookie(uint32_t index) const noexcept { return _cookies[index]; }
+   clap_param_info_flags flags(uint32_t index) const noexcept { return _flags[index]; }
+   double minValue(uint32_t index) const noexcept { return _minValues[index]; }
+   double maxValue(uint32_t index) const noexcept { return _maxValues[index]; }
+   double defaultValue(uint32_t index) const noexcept { return _defaultValues[index]; }
+   const std::string &name(uint32_t index) const noexcept { return _strings[_nameIds[index]]; }
+   const std::string &module(uint32_t index) const noexcept {
+      return _strings[_moduleIds[index]];
+   }
+
+   bool isInfoEqualTo(uint32_t index, const clap_param_info &info) const noexcept;
+   bool isInfoCriticallyDifferentTo(uint32_t index, const clap_param_info &info) const noexcept;
+   void setInfo(uint32_t index, const clap_param_info &info);
+
+   double value(uint32_t index) const noexcept { return _values[index]; }
+   double modulation(uint32_t index) const noexcept { return _modulations[index]; }
+   double modulatedValue(uint32_t index) const noexcept;
+   bool isValueValid(uint32_t index, double value) const noexcept {
+      return _minValues[index] <= value && value <= _maxValues[index];
+   }
+
+   // return true if the value did change
+   bool setValue(uint32_t index, double value) noexcept;
+   bool setModulation(uint32_t index, double modulation) noexcept;
+
+   bool isAdjusting(uint32_t index) const noexcept { return _isAdjusting[index]; }
+   bool setIsAdjusting(uint32_t index, bool isAdjusting) noexcept;
+
+   // Set for the stepped params: the changes made by the host are reduced to the latest one and
+   // sent at the start of the next block, instead of being sent with their timestamps.
+   bool shouldReduceChanges(uint32_t index) const noexcept { return _shouldReduceChanges[index]; }
+
+   void printShortInfo(uint32_t index, std::ostream &os) const;
+   void printInfo(uint32_t index, std::ostream &os) const;
+
+private:
+   uint32_t intern(const char *str, size_t maxSize);
+
+   // hot
+   std::vector<double> _values;
+   std::vector<double> _modulations;
+
+   // cold
+   std::vector<clap_id> _ids;
+   std::vector<void *> _cookies;
+   std::vector<clap_param_info_flags> _flags;
+   std::vector<double> _minValues;
+   std::vector<double> _maxValues;
+   std::vector<double> _defaultValues;
+   std::vector<uint32_t> _nameIds;
+   std::vector<uint32_t> _moduleIds;
+   std::vector<uint8_t> _isAdjusting;
+   std::vector<uint8_t> _shouldReduceChanges;
+
+   std::vector<std::pair<clap_id, uint32_t>> _sortedIndex;
+
+   // Interned strings, a deque so the views used as keys stay valid. Strings which are no longer
+   // used are only released by clear().
+   std::deque<std::string> _strings;
+   std::unordered_map<std::string_view, uint32_t> _stringIndex;
+};
@@ -0,0 +1,27 @@
+#include <cmath>
+
+#include "param-text-cache.hh"
+
+ParamTextCache::Key
+ParamTextCache::makeKey(clap_id paramId, double value, double min, double max) noexcept {
+   const double range = max - min;
+   const double normalized = range > 0 ? (value - min) / range : 0;
+   return {paramId, std::llround(normalized * RESOLUTION)};
+}
+
+const QString *ParamTextCache::find(clap_id paramId, double value, double min, double max) const {
+   auto it = _entries.find(makeKey(paramId, value, min, max));
+   return it != _entries.end() ? &it->second : nullptr;
+}
+
+void ParamTextCache::insert(clap_id paramId,
+                            double value,
+                            double min,
+                            double max,
+                            const QString &text) {
+   // Simpler than tracking the usage, and the visible values are back after one refresh.
+   if (_entries.size() >= MAX_ENTRIES)
+      _entries.clear();
+
+   _entries.insert_or_assign(makeKey(paramId, value, min, max), text);
+}
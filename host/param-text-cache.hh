@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include <QString>
+
+#include <clap/clap.h>
+
+// Texts produced by clap_plugin_params.value_to_text(), keyed by param_id and value.
+//
+// The values are quantized over the parameter's range, so a value moving by less than a step of
+// the display doesn't cost another call into the plugin. The plugin may change its texts at any
+// time with CLAP_PARAM_RESCAN_TEXT, which clears the whole cache.
+class ParamTextCache {
+public:
+   // returns nullptr if the text isn't cached
+   const QString *find(clap_id paramId, double value, double min, double max) const;
+   void insert(clap_id paramId, double value, double min, double max, const QString &text);
+   void clear() { _entries.clear(); }
+
+private:
+   // 2^24 steps over the range is finer than any display
+   static constexpr double RESOLUTION = 1 << 24;
+
+   // bounds the memory used by a plugin with many parameters being automated
+   static constexpr size_t MAX_ENTRIES = 1 << 16;
+
+   struct Key {
+      clap_id paramId;
+      int64_t value;
+
+      bool operator==(const Key &other) const noexcept {
+         return paramId == other.paramId && value == other.value;
+      }
+   };
+
+   struct KeyHash {
+      size_t operator()(const Key &key) const noexcept {
+         return std::hash<uint64_t>()(key.value * 0x9E3779B97F4A7C15ull ^ key.paramId);
+      }
+   };
+
+   static Key makeKey(clap_id paramId, double value, double min, double max) noexcept;
+
+   std::unordered_map<Key, QString, KeyHash> _entries;
+};
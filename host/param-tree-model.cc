@@ -0,0 +1,318 @@
+#include <algorithm>
+
+#include "param-tree-model.hh"
+#include "plugin-host.hh"
+
+ParamTreeModel::ParamTreeModel(PluginHost &pluginHost, QObject *parent)
+   : QAbstractItemModel(parent), _pluginHost(pluginHost) {
+   connect(&_pluginHost, &PluginHost::paramsChanged, this, &ParamTreeModel::rebuild);
+   connect(&_pluginHost.paramUpdates(),
+           &ParamUpdateCoalescer::paramsUpdated,
+           this,
+           &ParamTreeModel::paramsUpdated);
+   connect(
+      &_pluginHost, &PluginHost::paramsTextChanged, this, &ParamTreeModel::paramsTextChanged);
+
+   rebuild();
+}
+
+void ParamTreeModel::rebuild() {
+   beginResetModel();
+
+   _modules.clear();
+   _modulesByPath.clear();
+   _modules.push_back({"/", 0, 0});
+   _modulesByPath.emplace("", 0);
+
+   // a plugin has far fewer modules than parameters, the paths are only split once each
+   auto &params = _pluginHost.params();
+   _paramRows.resize(params.size());
+   for (uint32_t i = 0; i < params.size(); ++i) {
+      const uint32_t module = findOrCreateModule(params.module(i));
+      _modules[module].params.push_back(i);
+      _paramRows[i] = {module, 0};
+   }
+   sortModules(0);
+
+   endResetModel();
+}
+
+uint32_t ParamTreeModel::findOrCreateModule(const std::string &path) {
+   auto it = _modulesByPath.find(path);
+   if (it != _modulesByPath.end())
+      return it->second;
+
+   // the empty components are skipped: "a//b/" is "/a/b"
+   uint32_t module = 0;
+   std::string prefix;
+   size_t begin = 0;
+   while (begin < path.size()) {
+      size_t end = path.find('/', begin);
+      if (end == std::string::npos)
+         end = path.size();
+
+      if (end > begin) {
+         prefix += '/';
+         prefix.append(path, begin, end - begin);
+
+         auto prefixIt = _modulesByPath.find(prefix);
+         if (prefixIt != _modulesByPath.end())
+            module = prefixIt->second;
+         else {
+            const uint32_t child = _modules.size();
+            _modules.push_back(
+               {QString::fromStdString(path.substr(begin, end - begin)), module, 0});
+            _modules[module].modules.push_back(child);
+            _modulesByPath.emplace(prefix, child);
+            module = child;
+         }
+      }
+      begin = end + 1;
+   }
+
+   _modulesByPath.emplace(path, module);
+   return module;
+}
+
+void ParamTreeModel::sortModules(uint32_t module) {
+   auto &children = _modules[module].modules;
+   std::sort(children.begin(), children.end(), [this](uint32_t a, uint32_t b) {
+      return _modules[a].name < _modules[b].name;
+   });
+
+   for (uint32_t row = 0; row < children.size(); ++row) {
+      _modules[children[row]].row = row;
+      sortModules(children[row]);
+   }
+}
+
+void ParamTreeModel::sortParams(uint32_t module) {
+   auto &m = _modules[module];
+   if (m.areParamsSorted)
+      return;
+
+   auto &params = _pluginHost.params();
+   std::stable_sort(m.params.begin(), m.params.end(), [&params](uint32_t a, uint32_t b) {
+      return params.name(a) < params.name(b);
+   });
+
+   // the parameters come after the sub-modules
+   for (uint32_t i = 0; i < m.params.size(); ++i)
+      _paramRows[m.params[i]].row = m.modules.size() + i;
+   m.areParamsSorted = true;
+}
+
+void ParamTreeModel::fetchParams(uint32_t module, uint32_t count) {
+   sortParams(module);
+
+   auto &m = _modules[module];
+   count = std::min<uint32_t>(count, m.params.size() - m.fetchedParams);
+   if (count == 0)
+      return;
+
+   const int first = m.modules.size() + m.fetchedParams;
+   beginInsertRows(moduleIndex(module), first, first + count - 1);
+   m.fetchedParams += count;
+   endInsertRows();
+}
+
+QModelIndex ParamTreeModel::moduleIndex(uint32_t module, int column) const {
+   return createIndex(_modules[module].row, column, quintptr(module) << 1);
+}
+
+int32_t ParamTreeModel::paramStoreIndex(const QModelIndex &index) const {
+   if (!index.isValid() || !isParam(index))
+      return -1;
+
+   auto &m = _modules[moduleOf(index)];
+   return m.params[index.row() - m.modules.size()];
+}
+
+clap_id ParamTreeModel::paramId(const QModelIndex &index) const {
+   const int32_t storeIndex = paramStoreIndex(index);
+   return storeIndex < 0 ? CLAP_INVALID_ID : _pluginHost.params().id(storeIndex);
+}
+
+QModelIndex ParamTreeModel::paramIndex(clap_id paramId) {
+   const int32_t storeIndex = _pluginHost.params().indexOf(paramId);
+   if (storeIndex < 0 || uint32_t(storeIndex) >= _paramRows.size())
+      return {};
+
+   const uint32_t module = _paramRows[storeIndex].module;
+   sortParams(module);
+
+   auto &m = _modules[module];
+   const uint32_t row = _paramRows[storeIndex].row;
+   const uint32_t fetched = m.modules.size() + m.fetchedParams;
+   if (row >= fetched)
+      fetchParams(module, row + 1 - fetched);
+
+   return createIndex(row, NameColumn, (quintptr(module) << 1) | 1);
+}
+
+QModelIndex ParamTreeModel::index(int row, int column, const QModelIndex &parent) const {
+   if (!hasIndex(row, column, parent))
+      return {};
+
+   if (!parent.isValid())
+      return moduleIndex(0, column);
+
+   const uint32_t module = moduleOf(parent);
+   auto &m = _modules[module];
+   if (uint32_t(row) < m.modules.size())
+      return moduleIndex(m.modules[row], column);
+   return createIndex(row, column, (quintptr(module) << 1) | 1);
+}
+
+QModelIndex ParamTreeModel::parent(const QModelIndex &child) const {
+   if (!child.isValid())
+      return {};
+
+   const uint32_t module = moduleOf(child);
+   if (isParam(child))
+      return moduleIndex(module);
+   if (module == 0)
+      return {};
+   return moduleIndex(_modules[module].parent);
+}
+
+int ParamTreeModel::rowCount(const QModelIndex &parent) const {
+   if (!parent.isValid())
+      return 1;
+
+   if (parent.column() > 0 || isParam(parent))
+      return 0;
+
+   auto &m = _modules[moduleOf(parent)];
+   return m.modules.size() + m.fetchedParams;
+}
+
+int ParamTreeModel::columnCount(const QModelIndex &parent) const { return ColumnCount; }
+
+bool ParamTreeModel::hasChildren(const QModelIndex &parent) const {
+   if (!parent.isValid())
+      return true;
+
+   if (parent.column() > 0 || isParam(parent))
+      return false;
+
+   auto &m = _modules[moduleOf(parent)];
+   return !m.modules.empty() || !m.params.empty();
+}
+
+bool ParamTreeModel::canFetchMore(const QModelIndex &parent) const {
+   if (!parent.isValid() || isParam(parent))
+      return false;
+
+   auto &m = _modules[moduleOf(parent)];
+   return m.fetchedParams < m.params.size();
+}
+
+void ParamTreeModel::fetchMore(const QModelIndex &parent) {
+   if (!parent.isValid() || isParam(parent))
+      return;
+
+   fetchParams(moduleOf(parent), FETCH_BATCH_SIZE);
+}
+
+QVariant ParamTreeModel::data(const QModelIndex &index, int role) const {
+   if (!index.isValid() || role != Qt::DisplayRole)
+      return {};
+
+   const int32_t storeIndex = paramStoreIndex(index);
+   if (storeIndex < 0)
+      return index.column() == NameColumn ? _modules[moduleOf(index)].name : QVariant();
+
+   // the view only asks for the visible rows
+   auto &params = _pluginHost.params();
+   switch (index.column()) {
+   case NameColumn:
+      return QString::fromStdString(params.name(storeIndex));
+
+   case ValueColumn:
+      return _pluginHost.paramValueToText(params.id(storeIndex), params.value(storeIndex));
+   }
+   return {};
+}
+
+QVariant ParamTreeModel::headerData(int section, Qt::Orientation orientation, int role) const {
+   if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+      return {};
+
+   switch (section) {
+   case NameColumn:
+      return tr("Name");
+   case ValueColumn:
+      return tr("Value");
+   }
+   return {};
+}
+
+void ParamTreeModel::paramsUpdated() {
+   auto &paramUpdates = _pluginHost.paramUpdates();
+   auto &dirtyParams = paramUpdates.dirtyParams();
+
+   // one range per module is cheaper than thousands of single rows
+   const bool isLargeUpdate = dirtyParams.size() > FETCH_BATCH_SIZE;
+
+   for (auto storeIndex : dirtyParams) {
+      const auto updates = paramUpdates.updatesAt(storeIndex);
+      if (updates & ParamUpdateCoalescer::Info) {
+         if (paramInfoChanged(storeIndex))
+            return;
+      } else if ((updates & ParamUpdateCoalescer::Value) && !isLargeUpdate)
+         paramValueChanged(storeIndex);
+   }
+
+   if (isLargeUpdate)
+      paramsTextChanged();
+}
+
+bool ParamTreeModel::paramInfoChanged(uint32_t storeIndex) {
+   if (storeIndex >= _paramRows.size())
+      return false;
+
+   // moving a parameter to another module is rare enough to start over
+   auto &paramRow = _paramRows[storeIndex];
+   auto it = _modulesByPath.find(_pluginHost.params().module(storeIndex));
+   if (it == _modulesByPath.end() || it->second != paramRow.module) {
+      rebuild();
+      return true;
+   }
+
+   // a renamed parameter keeps its row until the next rebuild
+   auto &m = _modules[paramRow.module];
+   if (!m.areParamsSorted || paramRow.row >= m.modules.size() + m.fetchedParams)
+      return false;
+
+   const quintptr id = (quintptr(paramRow.module) << 1) | 1;
+   emit dataChanged(createIndex(paramRow.row, NameColumn, id),
+                    createIndex(paramRow.row, ValueColumn, id));
+   return false;
+}
+
+void ParamTreeModel::paramValueChanged(uint32_t storeIndex) {
+   if (storeIndex >= _paramRows.size())
+      return;
+
+   auto &paramRow = _paramRows[storeIndex];
+   auto &m = _modules[paramRow.module];
+   if (!m.areParamsSorted || paramRow.row >= m.modules.size() + m.fetchedParams)
+      return;
+
+   auto index = createIndex(paramRow.row, ValueColumn, (quintptr(paramRow.module) << 1) | 1);
+   emit dataChanged(index, index);
+}
+
+void ParamTreeModel::paramsTextChanged() {
+   for (uint32_t module = 0; module < _modules.size(); ++module) {
+      auto &m = _modules[module];
+      if (m.fetchedParams == 0)
+         continue;
+
+      const quintptr id = (quintptr(module) << 1) | 1;
+      const int first = m.modules.size();
+      emit dataChanged(createIndex(first, ValueColumn, id),
+                       createIndex(first + m.fetchedParams - 1, ValueColumn, id));
+   }
+}
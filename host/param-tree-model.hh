@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <QAbstractItemModel>
+
+#include <clap/clap.h>
+
+class PluginHost;
+
+// Tree of the plugin's modules and parameters, over the host's ParamStore.
+//
+// The module nodes are built once per full rescan, from the distinct module paths. A module's
+// parameters are only sorted when the view first expands it, then handed to the view in batches
+// through fetchMore(): no item is allocated per parameter. Later changes to the names and values,
+// once per frame, only emit dataChanged() for their rows.
+class ParamTreeModel : public QAbstractItemModel {
+   Q_OBJECT
+
+public:
+   enum Column {
+      NameColumn,
+      ValueColumn,
+      ColumnCount,
+   };
+
+   explicit ParamTreeModel(PluginHost &pluginHost, QObject *parent = nullptr);
+
+   // CLAP_INVALID_ID if the index is a module
+   clap_id paramId(const QModelIndex &index) const;
+
+   // fetches the module's rows up to the parameter if needed
+   QModelIndex paramIndex(clap_id paramId);
+
+   QModelIndex index(int row, int column, const QModelIndex &parent) const override;
+   QModelIndex parent(const QModelIndex &child) const override;
+   int rowCount(const QModelIndex &parent) const override;
+   int columnCount(const QModelIndex &parent) const override;
+   QVariant data(const QModelIndex &index, int role) const override;
+   QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+   bool hasChildren(const QModelIndex &parent) const override;
+   bool canFetchMore(const QModelIndex &parent) const override;
+   void fetchMore(const QModelIndex &parent) override;
+
+private:
+   static constexpr uint32_t FETCH_BATCH_SIZE = 256;
+
+   struct Module {
+      QString name;
+      uint32_t parent;
+      uint32_t row; // among the parent's children
+
+      std::vector<uint32_t> modules; // sorted by name
+      std::vector<uint32_t> params;  // ParamStore indexes, sorted by name once fetched
+      uint32_t fetchedParams = 0;
+      bool areParamsSorted = false;
+   };
+
+   // where a parameter is in the tree, by ParamStore index
+   struct ParamRow {
+      uint32_t module;
+      uint32_t row; // only valid once the module's params are sorted
+   };
+
+   void rebuild();
+   uint32_t findOrCreateModule(const std::string &path);
+   void sortModules(uint32_t module);
+   void sortParams(uint32_t module);
+   void fetchParams(uint32_t module, uint32_t count);
+
+   QModelIndex moduleIndex(uint32_t module, int column = NameColumn) const;
+   bool isParam(const QModelIndex &index) const { return index.internalId() & 1; }
+   uint32_t moduleOf(const QModelIndex &index) const { return index.internalId() >> 1; }
+   int32_t paramStoreIndex(const QModelIndex &index) const;
+
+   void paramsUpdated();
+   bool paramInfoChanged(uint32_t storeIndex); // returns true if the model was rebuilt
+   void paramValueChanged(uint32_t storeIndex);
+   void paramsTextChanged();
+
+   PluginHost &_pluginHost;
+
+   // _modules[0] is the root, "/"
+   std::vector<Module> _modules;
+   std::vector<ParamRow> _paramRows;
+
+   // the plugin's module paths, and their prefixes, to their node
+   std::unordered_map<std::string, uint32_t> _modulesByPath;
+};
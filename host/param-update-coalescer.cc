@@ -0,0 +1,88 @@
+#include <algorithm>
+
+#include <QEvent>
+#include <QGuiApplication>
+#include <QScreen>
+
+#include "param-store.hh"
+#include "param-update-coalescer.hh"
+
+ParamUpdateCoalescer::ParamUpdateCoalescer(const ParamStore &params, QObject *parent)
+   : QObject(parent), _params(params) {
+   // one flush per refresh of the screen, 60 Hz if it is unknown
+   int interval = 16;
+   auto screen = QGuiApplication::primaryScreen();
+   if (screen && screen->refreshRate() > 1)
+      interval = std::max<int>(1, 1000 / screen->refreshRate());
+
+   _frameTimer.setInterval(interval);
+   _frameTimer.setTimerType(Qt::PreciseTimer);
+   connect(&_frameTimer, &QTimer::timeout, this, &ParamUpdateCoalescer::flush);
+}
+
+void ParamUpdateCoalescer::reset(uint32_t paramCount) {
+   _updates.assign(paramCount, 0);
+   _dirtyParams.clear();
+   _dirtyParams.reserve(paramCount);
+   _frameTimer.stop();
+}
+
+void ParamUpdateCoalescer::markDirty(uint32_t index, Update update) {
+   Q_ASSERT(index < _updates.size());
+
+   auto &updates = _updates[index];
+   if (!updates)
+      _dirtyParams.push_back(index);
+   updates |= update;
+
+   if (!_frameTimer.isActive() && isAnyWidgetShown())
+      _frameTimer.start();
+}
+
+void ParamUpdateCoalescer::addWidget(QWidget *widget) {
+   _widgets.emplace_back(widget);
+
+   // A window being shown or restored sends a show event to its children as well.
+   widget->installEventFilter(this);
+}
+
+uint8_t ParamUpdateCoalescer::updates(clap_id paramId) const {
+   const int32_t index = _params.indexOf(paramId);
+   if (index < 0 || uint32_t(index) >= _updates.size())
+      return 0;
+   return _updates[index];
+}
+
+bool ParamUpdateCoalescer::eventFilter(QObject *watched, QEvent *event) {
+   if (event->type() == QEvent::Show && !_dirtyParams.empty() && !_frameTimer.isActive())
+      _frameTimer.start();
+   return QObject::eventFilter(watched, event);
+}
+
+bool ParamUpdateCoalescer::isAnyWidgetShown() const {
+   for (auto &widget : _widgets) {
+      if (widget && widget->isVisible() && !widget->window()->isMinimized())
+         return true;
+   }
+   return false;
+}
+
+void ParamUpdateCoalescer::flush() {
+   // Nothing changed during the last frame: sleep until the next change.
+   if (_dirtyParams.empty()) {
+      _frameTimer.stop();
+      return;
+   }
+
+   // Keep the updates until a widget is shown again, see eventFilter().
+   if (!isAnyWidgetShown()) {
+      _frameTimer.stop();
+      return;
+   }
+
+   emit paramsUpdated();
+
+   for (auto index : _dirtyParams)
+      _updates[index] = 0;
+   _dirtyParams.clear();
+}
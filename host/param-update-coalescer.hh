@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QWidget>
+
+#include <clap/clap.h>
+
+class ParamStore;
+
+// Collects the parameters which changed, and tells the widgets about them once per display
+// frame.
+//
+// A parameter can change many times per frame, from the plugin or from the host, and each change
+// used to repaint the widgets showing it. The changes are now marked in a dense array, indexed
+// like the ParamStore, and paramsUpdated() is emitted at most once per frame. While none of the
+// widgets is on screen, the changes keep accumulating and are flushed when one is shown again.
+class ParamUpdateCoalescer : public QObject {
+   Q_OBJECT
+
+public:
+   enum Update : uint8_t {
+      Value = 1 << 0,
+      Modulation = 1 << 1,
+      IsAdjusting = 1 << 2,
+      Info = 1 << 3,
+   };
+
+   explicit ParamUpdateCoalescer(const ParamStore &params, QObject *parent = nullptr);
+
+   // called when the parameters are rebuilt, the pending updates are dropped
+   void reset(uint32_t paramCount);
+
+   void markDirty(uint32_t index, Update update);
+
+   // The widgets which display the parameters: the flush is skipped while none of them is visible
+   // in a window which isn't minimized.
+   void addWidget(QWidget *widget);
+
+   // during paramsUpdated(): the updates of a parameter since the previous flush
+   uint8_t updates(clap_id paramId) const;
+   uint8_t updatesAt(uint32_t index) const noexcept { return _updates[index]; }
+   const std::vector<uint32_t> &dirtyParams() const noexcept { return _dirtyParams; }
+
+signals:
+   void paramsUpdated();
+
+protected:
+   bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+   bool isAnyWidgetShown() const;
+   void flush();
+
+   const ParamStore &_params;
+
+   // by ParamStore index
+   std::vector<uint8_t> _updates;
+   std::vector<uint32_t> _dirtyParams;
+
+   std::vector<QPointer<QWidget>> _widgets;
+   QTimer _frameTimer;
+};
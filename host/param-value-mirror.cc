@@ -0,0 +1,99 @@
+#include "param-value-mirror.hh"
+
+void ParamValueMirror::rebuild(uint32_t size) {
+   if (size > _capacity) {
+      _slots.reset(new Slot[size]);
+      _capacity = size;
+   } else {
+      for (uint32_t i = 0; i < size; ++i) {
+         auto &slot = _slots[i];
+         slot.sequence.store(0, std::memory_order_relaxed);
+         slot.value.store(0, std::memory_order_relaxed);
+         slot.valueCount.store(0, std::memory_order_relaxed);
+         slot.gestureBeginCount.store(0, std::memory_order_relaxed);
+         slot.isAdjusting.store(false, std::memory_order_relaxed);
+      }
+   }
+
+   // zero-initialized
+   const uint32_t wordCount = (size + 63) / 64;
+   _summaryCount = (wordCount + 63) / 64;
+   _dirtyWords.reset(new std::atomic<uint64_t>[wordCount]());
+   _dirtySummary.reset(new std::atomic<uint64_t>[_summaryCount]());
+
+   _size = size;
+   _readSnapshots.assign(size, Snapshot());
+   _isDirty = false;
+}
+
+template <typename Fn>
+void ParamValueMirror::write(uint32_t index, Fn &&fn) noexcept {
+   auto &slot = _slots[index];
+
+   // odd while the slot is being written
+   const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+   slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+
+   fn(slot);
+
+   slot.sequence.store(sequence + 2, std::memory_order_release);
+   markDirty(index);
+   _isDirty = true;
+}
+
+void ParamValueMirror::markDirty(uint32_t index) noexcept {
+   // The word's bit is set before the summary's, and the reader takes them in the opposite
+   // order: when it takes the summary bit, it sees the word bit and the slot written before.
+   const uint32_t w = index / 64;
+   _dirtyWords[w].fetch_or(uint64_t(1) << (index % 64), std::memory_order_release);
+   _dirtySummary[w / 64].fetch_or(uint64_t(1) << (w % 64), std::memory_order_release);
+}
+
+void ParamValueMirror::setValue(uint32_t index, double value) noexcept {
+   write(index, [value](Slot &slot) {
+      slot.value.store(value, std::memory_order_relaxed);
+      slot.valueCount.fetch_add(1, std::memory_order_relaxed);
+   });
+}
+
+void ParamValueMirror::setGesture(uint32_t index, bool isBegin) noexcept {
+   write(index, [isBegin](Slot &slot) {
+      slot.isAdjusting.store(isBegin, std::memory_order_relaxed);
+      if (isBegin)
+         slot.gestureBeginCount.fetch_add(1, std::memory_order_relaxed);
+   });
+}
+
+bool ParamValueMirror::publish() noexcept {
+   if (!_isDirty)
+      return false;
+
+   _isDirty = false;
+   _generation.fetch_add(1, std::memory_order_release);
+   return true;
+}
+
+bool ParamValueMirror::read(uint32_t index, Snapshot &snapshot) const noexcept {
+   auto &slot = _slots[index];
+
+   // The writer only holds the slot for a few stores, give up after a while rather than spinning
+   // against a preempted audio thread: the change will be picked up by the next read.
+   for (int attempt = 0; attempt < 64; ++attempt) {
+      const uint32_t before = slot.sequence.load(std::memory_order_acquire);
+      if (before & 1)
+         continue;
+
+      snapshot.value = slot.value.load(std::memory_order_relaxed);
+      snapshot.valueCount = slot.valueCount.load(std::memory_order_relaxed);
+      snapshot.gestureBeginCount = slot.gestureBeginCount.load(std::memory_order_relaxed);
+      snapshot.isAdjusting = slot.isAdjusting.load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == before) {
+         snapshot.sequence = before;
+         return true;
+      }
+   }
+   return false;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <clap/clap.h>
+
+// Latest parameter values and gesture states produced by the plugin, written by the audio thread
+// and read by the main thread.
+//
+// Each parameter has a cache-line sized slot, at its ParamStore index, protected by a sequence
+// counter (seqlock): the writer never waits, and the reader retries if it raced with a write. The
+// plugin can output any number of values per block, the reader only sees the latest one.
+//
+// The writer also marks the slot in a two-level dirty bitset: a bit per slot, and a bit per word
+// of those. The reader takes the bits and only visits the slots which were written, so the cost
+// of a read depends on the number of changes, not on the number of parameters.
+//
+// rebuild() is called on the main thread while the plugin is not processing.
+class ParamValueMirror {
+public:
+   struct Change {
+      double value;
+      bool hasValueChanged;
+      bool isAdjusting;
+
+      // a gesture did begin, even if it already ended
+      bool hasGestureBegun;
+   };
+
+   void rebuild(uint32_t size);
+
+   uint32_t size() const noexcept { return _size; }
+
+   // writer
+   void setValue(uint32_t index, double value) noexcept;
+   void setGesture(uint32_t index, bool isBegin) noexcept;
+   // returns true if there was something to publish
+   bool publish() noexcept;
+
+   // reader: calls fn(index, change) for each parameter written since the previous call
+   template <typename Fn>
+   void consumeChanges(Fn &&fn) {
+      const uint32_t generation = _generation.load(std::memory_order_acquire);
+      if (generation == _readGeneration)
+         return;
+
+      bool isComplete = true;
+      for (uint32_t s = 0; s < _summaryCount; ++s) {
+         uint64_t summary = _dirtySummary[s].exchange(0, std::memory_order_acquire);
+         while (summary) {
+            const uint32_t w = s * 64 + std::countr_zero(summary);
+            summary &= summary - 1;
+
+            uint64_t word = _dirtyWords[w].exchange(0, std::memory_order_acquire);
+            while (word) {
+               const uint32_t i = w * 64 + std::countr_zero(word);
+               word &= word - 1;
+
+               Snapshot snapshot;
+               if (!read(i, snapshot)) {
+                  // busy, look at it again on the next call
+                  markDirty(i);
+                  isComplete = false;
+                  continue;
+               }
+
+               auto &previous = _readSnapshots[i];
+               if (snapshot.sequence == previous.sequence)
+                  continue;
+
+               Change change;
+               change.value = snapshot.value;
+               change.hasValueChanged = snapshot.valueCount != previous.valueCount;
+               change.isAdjusting = snapshot.isAdjusting;
+               change.hasGestureBegun = snapshot.gestureBeginCount != previous.gestureBeginCount;
+               previous = snapshot;
+               fn(i, change);
+            }
+         }
+      }
+
+      if (isComplete)
+         _readGeneration = generation;
+   }
+
+private:
+   static constexpr size_t CACHE_LINE_SIZE = 64;
+
+   // The counters tell the reader what happened since its previous read, even if the writer
+   // wrote several times in between.
+   struct alignas(CACHE_LINE_SIZE) Slot {
+      std::atomic<uint32_t> sequence = {0};
+      std::atomic<double> value = {0};
+      std::atomic<uint32_t> valueCount = {0};
+      std::atomic<uint32_t> gestureBeginCount = {0};
+      std::atomic<bool> isAdjusting = {false};
+   };
+
+   struct Snapshot {
+      uint32_t sequence = 0;
+      double value = 0;
+      uint32_t valueCount = 0;
+      uint32_t gestureBeginCount = 0;
+      bool isAdjusting = false;
+   };
+
+   template <typename Fn>
+   void write(uint32_t index, Fn &&fn) noexcept;
+   bool read(uint32_t index, Snapshot &snapshot) const noexcept;
+   void markDirty(uint32_t index) noexcept;
+
+   uint32_t _size = 0;
+   uint32_t _capacity = 0; // the slots are reused by the next rebuilds if there are enough
+   std::unique_ptr<Slot[]> _slots;
+
+   // set by the writer after writing a slot, and taken by the reader
+   std::unique_ptr<std::atomic<uint64_t>[]> _dirtyWords;   // a bit per slot
+   std::unique_ptr<std::atomic<uint64_t>[]> _dirtySummary; // a bit per dirty word
+   uint32_t _summaryCount = 0;
+
+   // writer side
+   bool _isDirty = false;
+   std::atomic<uint32_t> _generation = {0};
+
+   // reader side
+   uint32_t _readGeneration = 0;
+   std::vector<Snapshot> _readSnapshots;
+};
@@ -0,0 +1,206 @@
+#include <cstring>
+
+#ifdef __linux__
+#   include <linux/perf_event.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
+
+#include "perf-counters.hh"
+
+const char *PerfCounters::name(Counter counter) noexcept {
+   switch (counter) {
+   case Cycles:
+      return "cycles";
+   case Instructions:
+      return "instructions";
+   case CacheMisses:
+      return "cache misses";
+   case BranchMisses:
+      return "branch misses";
+   case ContextSwitches:
+      return "context switches";
+   default:
+      return "unknown";
+   }
+}
+
+#ifdef __linux__
+
+// The counters of a thread, opened as a group led by the first counter which could be opened.
+struct PerfCounterGroup {
+   // what read() returns, with PERF_FORMAT_GROUP and the total times enabled and running
+   struct ReadFormat {
+      uint64_t count;
+      uint64_t timeEnabled;
+      uint64_t timeRunning;
+      uint64_t values[PerfCounters::COUNT];
+   };
+
+   bool isOpened = false;
+   int leaderFd = -1;
+   std::array<int, PerfCounters::COUNT> fds = {-1, -1, -1, -1, -1};
+
+   // the counters in the order of the group
+   std::array<PerfCounters::Counter, PerfCounters::COUNT> order = {};
+   uint32_t size = 0;
+   uint32_t available = 0;
+
+   ReadFormat start = {};
+
+   void open() noexcept;
+   void close() noexcept;
+   bool read(ReadFormat &data) const noexcept;
+
+   ~PerfCounterGroup() { close(); }
+};
+
+static int perfEventOpen(PerfCounters::Counter counter, int groupFd) noexcept {
+   perf_event_attr attr;
+   std::memset(&attr, 0, sizeof(attr));
+   attr.size = sizeof(attr);
+   attr.read_format =
+      PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+   attr.exclude_hv = 1;
+
+   switch (counter) {
+   case PerfCounters::Cycles:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+   case PerfCounters::Instructions:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+   case PerfCounters::CacheMisses:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+   case PerfCounters::BranchMisses:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+   case PerfCounters::ContextSwitches:
+      attr.type = PERF_TYPE_SOFTWARE;
+      attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+      break;
+   default:
+      return -1;
+   }
+
+   // the switches happen in the kernel, the other counters are about the plugin's code
+   attr.exclude_kernel = counter == PerfCounters::ContextSwitches ? 0 : 1;
+
+   // this thread, on any cpu
+   return ::syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC);
+}
+
+void PerfCounterGroup::open() noexcept {
+   isOpened = true;
+
+   for (uint32_t i = 0; i < PerfCounters::COUNT; ++i) {
+      const auto counter = PerfCounters::Counter(i);
+      const int fd = perfEventOpen(counter, leaderFd);
+      if (fd < 0)
+         continue;
+
+      if (leaderFd < 0)
+         leaderFd = fd;
+      fds[i] = fd;
+      order[size++] = counter;
+      available |= 1u << counter;
+   }
+}
+
+void PerfCounterGroup::close() noexcept {
+   for (auto &fd : fds) {
+      if (fd >= 0)
+         ::close(fd);
+      fd = -1;
+   }
+   leaderFd = -1;
+   size = 0;
+   available = 0;
+}
+
+bool PerfCounterGroup::read(ReadFormat &data) const noexcept {
+   const ssize_t expected = sizeof(uint64_t) * (3 + size);
+   return ::read(leaderFd, &data, sizeof(data)) == expected && data.count == size;
+}
+
+static thread_local PerfCounterGroup g_perfCounters;
+
+uint32_t PerfCounters::probe() noexcept {
+   PerfCounterGroup group;
+   group.open();
+   return group.available;
+}
+
+bool PerfCounters::begin() noexcept {
+   auto &group = g_perfCounters;
+   if (!group.isOpened) [[unlikely]]
+      group.open();
+
+   return group.size > 0 && group.read(group.start);
+}
+
+bool PerfCounters::end(Values &values) noexcept {
+   auto &group = g_perfCounters;
+   PerfCounterGroup::ReadFormat now;
+   if (group.size == 0 || !group.read(now))
+      return false;
+
+   const uint64_t enabled = now.timeEnabled - group.start.timeEnabled;
+   const uint64_t running = now.timeRunning - group.start.timeRunning;
+
+   values = {};
+   values.available = group.available;
+   values.isMultiplexed = running < enabled;
+   for (uint32_t i = 0; i < group.size; ++i) {
+      uint64_t count = now.values[i] - group.start.values[i];
+      if (values.isMultiplexed && running > 0)
+         count = uint64_t(double(count) * enabled / running);
+      values.counts[group.order[i]] = count;
+   }
+   return true;
+}
+
+#else
+
+uint32_t PerfCounters::probe() noexcept { return 0; }
+
+bool PerfCounters::begin() noexcept { return false; }
+
+bool PerfCounters::end(Values &values) noexcept { return false; }
+
+#endif
+
+void PerfCounterTotals::add(const PerfCounters::Values &values, uint32_t frames) noexcept {
+   for (uint32_t i = 0; i < PerfCounters::COUNT; ++i)
+      _counts[i].fetch_add(values.counts[i], std::memory_order_relaxed);
+   _available.fetch_or(values.available, std::memory_order_relaxed);
+   _calls.fetch_add(1, std::memory_order_relaxed);
+   _frames.fetch_add(frames, std::memory_order_relaxed);
+   if (values.isMultiplexed)
+      _multiplexedCalls.fetch_add(1, std::memory_order_relaxed);
+}
+
+PerfCounterTotals::Snapshot PerfCounterTotals::take() noexcept {
+   Snapshot snapshot;
+   for (uint32_t i = 0; i < PerfCounters::COUNT; ++i)
+      snapshot.counts[i] = _counts[i].exchange(0, std::memory_order_relaxed);
+   snapshot.available = _available.exchange(0, std::memory_order_relaxed);
+   snapshot.calls = _calls.exchange(0, std::memory_order_relaxed);
+   snapshot.frames = _frames.exchange(0, std::memory_order_relaxed);
+   snapshot.multiplexedCalls = _multiplexedCalls.exchange(0, std::memory_order_relaxed);
+   return snapshot;
+}
+
+double PerfCounterTotals::Snapshot::ipc() const noexcept {
+   const uint64_t cycles = counts[PerfCounters::Cycles];
+   return cycles ? double(counts[PerfCounters::Instructions]) / cycles : 0;
+}
+
+double PerfCounterTotals::Snapshot::perSample(PerfCounters::Counter counter) const noexcept {
+   return frames ? double(counts[counter]) / frames : 0;
+}
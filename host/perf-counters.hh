@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// The hardware performance counters of the calling thread, from perf_event_open(), Linux only.
+//
+// The counters are opened as one group by the thread's first begin(), which makes a few syscalls
+// and is done once per thread. Afterwards, begin() and end() each read the whole group with a
+// single read(). The counters the kernel refuses, because there is no PMU in a VM or because of
+// perf_event_paranoid, are unavailable and the others still work: counting the context switches
+// requires kernel counting to be allowed. The counters are closed when the thread exits.
+class PerfCounters {
+public:
+   enum Counter : uint32_t {
+      Cycles,
+      Instructions,
+      CacheMisses,
+      BranchMisses,
+      ContextSwitches,
+      COUNT,
+   };
+
+   struct Values {
+      std::array<uint64_t, COUNT> counts = {};
+      uint32_t available = 0; // a bit per Counter
+
+      // the kernel time-shared the PMU with other events: the counts are scaled estimates
+      bool isMultiplexed = false;
+
+      bool isAvailable(Counter counter) const noexcept { return available & (1u << counter); }
+   };
+
+   static const char *name(Counter counter) noexcept;
+
+   // main thread: opens and closes a group, returns the available counters
+   static uint32_t probe() noexcept;
+
+   // calling thread, returns false if no counter could be opened
+   static bool begin() noexcept;
+
+   // calling thread: the counts since begin()
+   static bool end(Values &values) noexcept;
+};
+
+// Sums the counters of many calls, from any thread.
+class PerfCounterTotals {
+public:
+   struct Snapshot {
+      std::array<uint64_t, PerfCounters::COUNT> counts = {};
+      uint32_t available = 0;
+      uint64_t calls = 0;
+      uint64_t frames = 0;
+      uint64_t multiplexedCalls = 0;
+
+      double ipc() const noexcept;
+      double perSample(PerfCounters::Counter counter) const noexcept;
+   };
+
+   void add(const PerfCounters::Values &values, uint32_t frames) noexcept;
+
+   // returns the totals since the previous call, and resets them
+   Snapshot take() noexcept;
+
+private:
+   std::array<std::atomic<uint64_t>, PerfCounters::COUNT> _counts = {};
+   std::atomic<uint32_t> _available = {0};
+   std::atomic<uint64_t> _calls = {0};
+   std::atomic<uint64_t> _frames = {0};
+   std::atomic<uint64_t> _multiplexedCalls = {0};
+};
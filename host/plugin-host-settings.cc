@@ -3,13 +3,16 @@
 #include "plugin-host-settings.hh"
 
 static const char SHOULD_PROVIDE_COOKIE_KEY[] = "PluginHost/ShouldProvideCookie";
+static const char SHOULD_RUN_IN_SANDBOX_KEY[] = "PluginHost/ShouldRunInSandbox";
 
 PluginHostSettings::PluginHostSettings() {}
 
 void PluginHostSettings::load(QSettings &settings) {
    _shouldProvideCookie = settings.value(SHOULD_PROVIDE_COOKIE_KEY).toBool();
+   _shouldRunInSandbox = settings.value(SHOULD_RUN_IN_SANDBOX_KEY).toBool();
 }
 
 void PluginHostSettings::save(QSettings &settings) const {
    settings.setValue(SHOULD_PROVIDE_COOKIE_KEY, _shouldProvideCookie);
+   settings.setValue(SHOULD_RUN_IN_SANDBOX_KEY, _shouldRunInSandbox);
 }
@@ -16,6 +16,10 @@ public:
    bool shouldProvideCookie() const { return _shouldProvideCookie; }
    void setShouldProvideCookie(bool enable) { _shouldProvideCookie = enable; }
 
+   bool shouldRunInSandbox() const { return _shouldRunInSandbox; }
+   void setShouldRunInSandbox(bool enable) { _shouldRunInSandbox = enable; }
+
 private:
    bool _shouldProvideCookie = true;
+   bool _shouldRunInSandbox = false;
 };
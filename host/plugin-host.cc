@@ -1,33 +1,47 @@
+#include <algorithm>
+#include <chrono>
 #include <exception>
 #include <iostream>
 #include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string_view>
-#include <unordered_set>
 
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QStringList>
 
 #include "application.hh"
 #include "engine.hh"
 #include "main-window.hh"
 #include "plugin-host-settings.hh"
 #include "plugin-host.hh"
+#include "plugin-sandbox.hh"
 #include "settings.hh"
+#include "state-stream.hh"
+#include "thread-type.hh"
+#include "tracer.hh"
+
+#ifdef CLAP_HOST_RT_CHECKS
+#   include "rt-checks.hh"
+#endif
 
 #include <clap/helpers/host.hxx>
 #include <clap/helpers/plugin-proxy.hxx>
-#include <clap/helpers/reducing-param-queue.hxx>
-
-enum class ThreadType {
-   Unknown,
-   MainThread,
-   AudioThread,
-   AudioThreadPool,
-};
 
 thread_local ThreadType g_thread_type = ThreadType::Unknown;
 
+static bool g_minimal_checks = PluginHost_CL == clap::helpers::CheckingLevel::Minimal;
+
+static bool g_perf_counters = false;
+static QString g_perf_counters_csv;
+
+static int64_t steadyTimeNs() noexcept {
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
 template class clap::helpers::Host<PluginHost_MH, PluginHost_CL>;
 
 template class clap::helpers::PluginProxy<PluginHost_MH, PluginHost_CL>;
@@ -41,6 +55,8 @@ PluginHost::PluginHost(Engine &engine)
      ) {
    g_thread_type = ThreadType::MainThread;
 
+   connect(&_mainThreadWaker, &MainThreadWaker::woken, this, &PluginHost::idle);
+
    initThreadPool();
 }
 
@@ -80,8 +96,18 @@ void PluginHost::threadPoolEntry() {
       if (_threadPoolStop)
          return;
 
+      // the buffer is claimed by the first task, the threads which never run one don't take any
+      Tracer::setThreadName("thread pool");
+
       int taskIndex = _threadPoolTaskIndex++;
+      TraceScope scope("thread pool task", taskIndex);
+      const bool isCounting = g_perf_counters && PerfCounters::begin();
       _plugin->threadPoolExec(taskIndex);
+      if (isCounting) {
+         PerfCounters::Values values;
+         if (PerfCounters::end(values))
+            _perfThreadPoolTotals.add(values, 0);
+      }
       _threadPoolSemaphoreDone.release();
    }
 }
@@ -89,9 +115,15 @@ void PluginHost::threadPoolEntry() {
 bool PluginHost::load(const QString &path, int pluginIndex) {
    checkForMainThread();
 
-   if (_library.isLoaded())
+   if (_library.isLoaded() || _sandbox)
       unload();
 
+   if (_settings.shouldRunInSandbox()) {
+      if (PluginSandbox::isSupported())
+         return loadSandboxed(path, pluginIndex);
+      qWarning() << "The plugin sandbox is not supported on this platform, loading in-process";
+   }
+
    _library.setFileName(path);
    _library.setLoadHints(QLibrary::ResolveAllSymbolsHint | QLibrary::DeepBindHint);
    if (!_library.load()) {
@@ -155,11 +187,62 @@ bool PluginHost::load(const QString &path, int pluginIndex) {
    return true;
 }
 
+bool PluginHost::loadSandboxed(const QString &path, int pluginIndex) {
+   checkForMainThread();
+
+   qInfo() << "Loading plugin index:" << pluginIndex << "in a sandbox process";
+
+   _sandbox = std::make_unique<PluginSandbox>();
+   if (!_sandbox->start(path, pluginIndex)) {
+      _sandbox.reset();
+      return false;
+   }
+
+   connect(_sandbox.get(), &PluginSandbox::crashed, this, &PluginHost::sandboxCrashed);
+
+   pluginLoadedChanged(true);
+
+   return true;
+}
+
+void PluginHost::sandboxCrashed() {
+   checkForMainThread();
+
+   // The audio thread outputs silence from now on, the plugin has to be loaded again.
+   qWarning() << "The sandboxed plugin crashed";
+}
+
 void PluginHost::unload() {
    checkForMainThread();
 
    pluginLoadedChanged(false);
 
+   clearStateSnapshots();
+
+   printRtLog();
+   reportCallbackLatency();
+   _callbackLatency = {};
+   _callbackRequestNs = 0;
+
+   drainPerfBlocks();
+   reportPerfCounters();
+
+#ifdef CLAP_HOST_RT_CHECKS
+   RtChecks::report();
+#endif
+
+   if (_pluginLatency != 0) {
+      _pluginLatency = 0;
+      emit pluginLatencyChanged(0);
+   }
+
+   if (_sandbox) {
+      deactivate();
+      _sandbox->stop();
+      _sandbox.reset();
+      return;
+   }
+
    if (!_library.isLoaded())
       return;
 
@@ -176,6 +259,10 @@ void PluginHost::unload() {
       _plugin->destroy();
    }
 
+   // the plugin may unregister its timers and fds while being destroyed
+   _timers.clear();
+   _fds.clear();
+
    _pluginEntry->deinit();
    _pluginEntry = nullptr;
 
@@ -197,15 +284,20 @@ bool PluginHost::canActivate() const {
 void PluginHost::activate(int32_t sample_rate, int32_t blockSize) {
    checkForMainThread();
 
-   if (!_plugin.get())
+   if (!_plugin.get() && !_sandbox)
       return;
 
    assert(!isPluginActive());
-   if (!_plugin->activate(sample_rate, blockSize, blockSize)) {
+   updateNoteDialects();
+   const bool activated = _sandbox ? _sandbox->activate(sample_rate, blockSize)
+                                   : _plugin->activate(sample_rate, blockSize, blockSize);
+   if (!activated) {
       setPluginState(InactiveWithError);
       return;
    }
 
+   updateLatency(sample_rate);
+
    _scheduleProcess = true;
    setPluginState(ActiveAndSleeping);
 }
@@ -222,22 +314,109 @@ void PluginHost::deactivate() {
    }
    _scheduleDeactivate = false;
 
-   _plugin->deactivate();
+   if (_sandbox)
+      _sandbox->deactivate();
+   else
+      _plugin->deactivate();
    setPluginState(Inactive);
 }
 
-void PluginHost::setPorts(int numInputs, float **inputs, int numOutputs, float **outputs) {
+void PluginHost::setPorts(int numInputs,
+                          float **inputs,
+                          int numOutputs,
+                          float **outputs,
+                          uint32_t inputLatency,
+                          uint32_t outputLatency) {
    _audioIn.channel_count = numInputs;
    _audioIn.data32 = inputs;
    _audioIn.data64 = nullptr;
    _audioIn.constant_mask = 0;
-   _audioIn.latency = 0;
+   _audioIn.latency = inputLatency;
 
    _audioOut.channel_count = numOutputs;
    _audioOut.data32 = outputs;
    _audioOut.data64 = nullptr;
    _audioOut.constant_mask = 0;
-   _audioOut.latency = 0;
+   _audioOut.latency = outputLatency;
+}
+
+void PluginHost::updateNoteDialects() {
+   checkForMainThread();
+
+   // without note ports, keep sending CLAP notes and MIDI as before
+   uint32_t supported = CLAP_NOTE_DIALECT_CLAP | CLAP_NOTE_DIALECT_MIDI;
+   uint32_t preferred = CLAP_NOTE_DIALECT_CLAP;
+
+   clap_note_port_info info;
+   if (_plugin && _plugin->canUseNotePorts() && _plugin->notePortsCount(true) > 0 &&
+       _plugin->notePortsGet(0, true, &info)) {
+      supported = info.supported_dialects;
+      preferred = info.preferred_dialect;
+   }
+
+   _audioBlock.setNoteDialects(supported, preferred);
+}
+
+void PluginHost::updateLatency(int32_t sampleRate) {
+   checkForMainThread();
+
+   const uint32_t latency = _plugin && _plugin->canUseLatency() ? _plugin->latencyGet() : 0;
+
+   for (auto &delayLine : _dryDelayLines)
+      delayLine.setDelay(latency);
+
+   // measure up to one second, or twice the reported latency if it is longer
+   _latencyProbe.prepare(std::max<uint32_t>(sampleRate, 2 * latency));
+
+   if (latency != _pluginLatency) {
+      _pluginLatency = latency;
+      emit pluginLatencyChanged(latency);
+   }
+}
+
+void PluginHost::latencyChanged() noexcept {
+   checkForMainThread();
+
+   // The latency may change during activate(), it is queried right after. Otherwise the plugin
+   // has to be restarted for the new latency to be taken into account.
+   if (isPluginActive()) {
+      qWarning() << "The plugin changed its latency while being active, restarting it";
+      _scheduleRestart = true;
+      _mainThreadWaker.wake();
+   }
+}
+
+void PluginHost::setBypassed(bool isBypassed) {
+   _isBypassed.store(isBypassed, std::memory_order_relaxed);
+}
+
+bool PluginHost::measureLatency() {
+   checkForMainThread();
+
+   if (!isPluginActive())
+      return false;
+
+   _scheduleProcess = true;
+   return _latencyProbe.start();
+}
+
+void PluginHost::reportMeasuredLatency() {
+   checkForMainThread();
+
+   auto measured = _latencyProbe.measure();
+   if (!measured) {
+      qWarning() << "Could not measure the plugin latency: the probe was not found in its output";
+      emit pluginLatencyMeasured(-1);
+      return;
+   }
+
+   if (*measured != _pluginLatency)
+      qWarning() << "The plugin reports a latency of" << _pluginLatency << "samples, but"
+                 << *measured << "samples were measured";
+   else
+      qInfo() << "Measured plugin latency:" << *measured << "samples, as reported";
+
+   emit pluginLatencyMeasured(*measured);
 }
 
 const char *PluginHost::getCurrentClapGuiApi() {
@@ -270,8 +449,9 @@ static clap_window makeClapWindow(WId window) {
 
 void PluginHost::setParentWindow(WId parentWindow) {
    checkForMainThread();
+   TraceScope scope("gui setup");
 
-   if (!_plugin->canUseGui())
+   if (!_plugin || !_plugin->canUseGui())
       return;
 
    if (_isGuiCreated) {
@@ -334,39 +514,94 @@ void PluginHost::setPluginWindowVisibility(bool isVisible) {
       return;
 
    if (isVisible && !_isGuiVisible) {
+      TraceScope scope("gui show");
       _plugin->guiShow();
       _isGuiVisible = true;
    } else if (!isVisible && _isGuiVisible) {
+      TraceScope scope("gui hide");
       _plugin->guiHide();
       _isGuiVisible = false;
    }
 }
 
-void PluginHost::requestCallback() noexcept { _scheduleMainThreadCallback = true; }
+void PluginHost::requestCallback() noexcept {
+   // the latency is measured from the first request
+   int64_t expected = 0;
+   _callbackRequestNs.compare_exchange_strong(expected, steadyTimeNs());
+
+   _scheduleMainThreadCallback = true;
+   _mainThreadWaker.wake();
+}
 
 void PluginHost::requestProcess() noexcept { _scheduleProcess = true; }
 
-void PluginHost::requestRestart() noexcept { _scheduleRestart = true; }
+void PluginHost::requestRestart() noexcept {
+   _scheduleRestart = true;
+   _mainThreadWaker.wake();
+}
 
-void PluginHost::logLog(clap_log_severity severity, const char *msg) const noexcept {
+static QDebug logStream(clap_log_severity severity) {
    switch (severity) {
    case CLAP_LOG_DEBUG:
-      qDebug() << msg;
-      break;
+      return qDebug();
 
    case CLAP_LOG_INFO:
-      qInfo() << msg;
-      break;
+      return qInfo();
 
-   case CLAP_LOG_WARNING:
-   case CLAP_LOG_ERROR:
-   case CLAP_LOG_FATAL:
-   case CLAP_LOG_HOST_MISBEHAVING:
-      qWarning() << msg;
-      break;
+   default:
+      return qWarning();
    }
 }
 
+// threadName is null for the main thread
+static void printLog(clap_log_severity severity, const char *threadName, const char *msg) {
+   auto stream = logStream(severity);
+   if (threadName)
+      stream << threadName;
+   stream << msg;
+}
+
+static const char *threadName(ThreadType threadType) noexcept {
+   switch (threadType) {
+   case ThreadType::MainThread:
+      return nullptr;
+   case ThreadType::AudioThread:
+      return "[audio thread]";
+   case ThreadType::AudioThreadPool:
+      return "[thread pool]";
+   default:
+      return "[plugin thread]";
+   }
+}
+
+void PluginHost::logLog(clap_log_severity severity, const char *msg) const noexcept {
+   if (g_thread_type == ThreadType::MainThread) {
+      printLog(severity, threadName(g_thread_type), msg);
+      return;
+   }
+
+   // qDebug() locks and allocates: the other threads, which may be realtime, go through a ring
+   if (_rtLog.log(severity, threadName(g_thread_type), msg))
+      _mainThreadWaker.wake();
+}
+
+void PluginHost::printRtLog() {
+   _rtLog.drain([](const RtLog::Message &message) {
+      if (message.isTruncated)
+         printLog(message.severity,
+                  message.threadName,
+                  (std::string(message.text) + " [truncated]").c_str());
+      else
+         printLog(message.severity, message.threadName, message.text);
+   });
+
+   const auto dropped = _rtLog.takeDroppedCount();
+   if (dropped.total() > 0)
+      qWarning().nospace() << "dropped " << dropped.total() << " log messages from the plugin ("
+                           << dropped.rateLimited << " over the rate limit, " << dropped.ringFull
+                           << " with a full ring, " << dropped.noRing << " from too many threads)";
+}
+
 bool PluginHost::threadCheckIsMainThread() const noexcept {
    return g_thread_type == ThreadType::MainThread;
 }
@@ -383,12 +618,36 @@ void PluginHost::checkForMainThread() {
 }
 
 void PluginHost::checkForAudioThread() {
+   if (g_minimal_checks)
+      return;
+
    if (g_thread_type != ThreadType::AudioThread) {
       qFatal() << "Requires Audio Thread!";
       std::terminate();
    }
 }
 
+void PluginHost::setMinimalChecks(bool isMinimal) noexcept { g_minimal_checks = isMinimal; }
+
+void PluginHost::setPerfCounters(bool isEnabled, const QString &csvPath) {
+   g_perf_counters = isEnabled;
+   g_perf_counters_csv = isEnabled ? csvPath : QString();
+   if (!isEnabled)
+      return;
+
+   const uint32_t available = PerfCounters::probe();
+   if (available == 0) {
+      qWarning() << "No performance counter could be opened, see perf_event_paranoid";
+      return;
+   }
+
+   for (uint32_t i = 0; i < PerfCounters::COUNT; ++i) {
+      if (!(available & (1u << i)))
+         qWarning() << "The" << PerfCounters::name(PerfCounters::Counter(i))
+                    << "performance counter is unavailable";
+   }
+}
+
 bool PluginHost::threadPoolRequestExec(uint32_t num_tasks) noexcept {
    checkForAudioThread();
 
@@ -423,16 +682,7 @@ bool PluginHost::timerSupportRegisterTimer(uint32_t period_ms, clap_id *timer_id
 
    auto id = _nextTimerId++;
    *timer_id = id;
-   auto timer = std::make_unique<QTimer>();
-
-   QObject::connect(timer.get(), &QTimer::timeout, [this, id] {
-      checkForMainThread();
-      _plugin->timerSupportOnTimer(id);
-   });
-
-   auto t = timer.get();
-   _timers.insert_or_assign(*timer_id, std::move(timer));
-   t->start(period_ms);
+   _timers.add(id, period_ms);
    return true;
 }
 
@@ -444,11 +694,8 @@ bool PluginHost::timerSupportUnregisterTimer(clap_id timer_id) noexcept {
          "Called unregister_timer() without providing clap_plugin_timer_support.on_timer() to "
          "receive the timer event.");
 
-   auto it = _timers.find(timer_id);
-   if (it == _timers.end())
+   if (!_timers.remove(timer_id))
       throw std::logic_error("Called unregister_timer() for a timer_id that was not registered.");
-
-   _timers.erase(it);
    return true;
 }
 
@@ -459,13 +706,9 @@ bool PluginHost::posixFdSupportRegisterFd(int fd, clap_posix_fd_flags_t flags) n
       throw std::logic_error("Called register_fd() without providing clap_plugin_fd_support to "
                              "receive the fd event.");
 
-   auto it = _fds.find(fd);
-   if (it != _fds.end())
+   if (!_fds.add(fd, flags))
       throw std::logic_error(
          "Called register_fd() for a fd that was already registered, use modify_fd() instead.");
-
-   _fds.insert_or_assign(fd, std::make_unique<Notifiers>());
-   eventLoopSetFdNotifierFlags(fd, flags);
    return true;
 }
 
@@ -476,13 +719,9 @@ bool PluginHost::posixFdSupportModifyFd(int fd, clap_posix_fd_flags_t flags) noe
       throw std::logic_error("Called modify_fd() without providing clap_plugin_fd_support to "
                              "receive the fd event.");
 
-   auto it = _fds.find(fd);
-   if (it == _fds.end())
+   if (!_fds.modify(fd, flags))
       throw std::logic_error(
          "Called modify_fd() for a fd that was not registered, use register_fd() instead.");
-
-   _fds.insert_or_assign(fd, std::make_unique<Notifiers>());
-   eventLoopSetFdNotifierFlags(fd, flags);
    return true;
 }
 
@@ -493,45 +732,11 @@ bool PluginHost::posixFdSupportUnregisterFd(int fd) noexcept {
       throw std::logic_error("Called unregister_fd() without providing clap_plugin_fd_support to "
                              "receive the fd event.");
 
-   auto it = _fds.find(fd);
-   if (it == _fds.end())
+   if (!_fds.remove(fd))
       throw std::logic_error("Called unregister_fd() for a fd that was not registered.");
-
-   _fds.erase(it);
    return true;
 }
 
-void PluginHost::eventLoopSetFdNotifierFlags(int fd, int flags) {
-   checkForMainThread();
-
-   auto it = _fds.find(fd);
-   Q_ASSERT(it != _fds.end());
-
-   if (flags & CLAP_POSIX_FD_READ) {
-      if (!it->second->rd) {
-         it->second->rd.reset(new QSocketNotifier((qintptr)fd, QSocketNotifier::Read));
-         QObject::connect(it->second->rd.get(), &QSocketNotifier::activated, [this, fd] {
-            checkForMainThread();
-            _plugin->posixFdSupportOnFd(fd, CLAP_POSIX_FD_READ);
-         });
-      }
-      it->second->rd->setEnabled(true);
-   } else if (it->second->rd)
-      it->second->rd->setEnabled(false);
-
-   if (flags & CLAP_POSIX_FD_WRITE) {
-      if (!it->second->wr) {
-         it->second->wr.reset(new QSocketNotifier((qintptr)fd, QSocketNotifier::Write));
-         QObject::connect(it->second->wr.get(), &QSocketNotifier::activated, [this, fd] {
-            checkForMainThread();
-            _plugin->posixFdSupportOnFd(fd, CLAP_POSIX_FD_WRITE);
-         });
-      }
-      it->second->wr->setEnabled(true);
-   } else if (it->second->wr)
-      it->second->wr->setEnabled(false);
-}
-
 void PluginHost::guiResizeHintsChanged() noexcept {
    // TODO
 }
@@ -570,6 +775,8 @@ void PluginHost::processBegin(int nframes) {
 
    _process.frames_count = nframes;
    _process.steady_time = _engine._steadyTime;
+
+   _audioBlock.beginBlock(nframes, steadyTimeNs());
 }
 
 void PluginHost::processEnd(int nframes) {
@@ -579,75 +786,22 @@ void PluginHost::processEnd(int nframes) {
    _process.steady_time = _engine._steadyTime;
 }
 
-void PluginHost::processNoteOn(int sampleOffset, int channel, int key, int velocity) {
+void PluginHost::processKeyboardMidi(const uint8_t *data, uint32_t size) {
    checkForAudioThread();
 
-   clap_event_note ev;
-   ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
-   ev.header.type = CLAP_EVENT_NOTE_ON;
-   ev.header.time = sampleOffset;
-   ev.header.flags = 0;
-   ev.header.size = sizeof(ev);
-   ev.port_index = 0;
-   ev.key = key;
-   ev.channel = channel;
-   ev.note_id = -1;
-   ev.velocity = velocity / 127.0;
-
-   _evIn.push(&ev.header);
+   _audioBlock.pushKeyboardMidi(data, size);
 }
 
-void PluginHost::processNoteOff(int sampleOffset, int channel, int key, int velocity) {
+void PluginHost::processMidi(int sampleOffset, const uint8_t *data, uint32_t size) {
    checkForAudioThread();
 
-   clap_event_note ev;
-   ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
-   ev.header.type = CLAP_EVENT_NOTE_OFF;
-   ev.header.time = sampleOffset;
-   ev.header.flags = 0;
-   ev.header.size = sizeof(ev);
-   ev.port_index = 0;
-   ev.key = key;
-   ev.channel = channel;
-   ev.note_id = -1;
-   ev.velocity = velocity / 127.0;
-
-   _evIn.push(&ev.header);
-}
-
-void PluginHost::processNoteAt(int sampleOffset, int channel, int key, int pressure) {
-   checkForAudioThread();
-
-   // TODO
-}
-
-void PluginHost::processPitchBend(int sampleOffset, int channel, int value) {
-   checkForAudioThread();
-
-   // TODO
-}
-
-void PluginHost::processCC(int sampleOffset, int channel, int cc, int value) {
-   checkForAudioThread();
-
-   clap_event_midi ev;
-   ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
-   ev.header.type = CLAP_EVENT_MIDI;
-   ev.header.time = sampleOffset;
-   ev.header.flags = 0;
-   ev.header.size = sizeof(ev);
-   ev.port_index = 0;
-   ev.data[0] = 0xB0 | channel;
-   ev.data[1] = cc;
-   ev.data[2] = value;
-
-   _evIn.push(&ev.header);
+   _audioBlock.pushMidi(sampleOffset, data, size);
 }
 
 void PluginHost::process() {
    checkForAudioThread();
 
-   if (!_plugin.get())
+   if (!_plugin.get() && !_sandbox)
       return;
 
    // Can't process a plugin that is not active
@@ -657,8 +811,12 @@ void PluginHost::process() {
    // Do we want to deactivate the plugin?
    if (_scheduleDeactivate) {
       _scheduleDeactivate = false;
-      if (_state == ActiveAndProcessing)
-         _plugin->stopProcessing();
+      if (_state == ActiveAndProcessing) {
+         if (_sandbox)
+            _sandbox->stopProcessing();
+         else
+            _plugin->stopProcessing();
+      }
       setPluginState(ActiveAndReadyToDeactivate);
       return;
    }
@@ -669,25 +827,25 @@ void PluginHost::process() {
 
    _process.transport = nullptr;
 
-   _process.in_events = _evIn.clapInputEvents();
-   _process.out_events = _evOut.clapOutputEvents();
+   _process.in_events = _audioBlock.inputEvents();
+   _process.out_events = _audioBlock.outputEvents();
 
    _process.audio_inputs = &_audioIn;
    _process.audio_inputs_count = 1;
    _process.audio_outputs = &_audioOut;
    _process.audio_outputs_count = 1;
 
-   _evOut.clear();
-   generatePluginInputEvents();
+   _audioBlock.prepareInputEvents(_settings.shouldProvideCookie());
 
    if (isPluginSleeping()) {
-      if (!_scheduleProcess && _evIn.empty())
+      if (!_scheduleProcess && !_audioBlock.hasInputEvents())
          // The plugin is sleeping, there is no request to wake it up and there are no events to
          // process
          return;
 
       _scheduleProcess = false;
-      if (!_plugin->startProcessing()) {
+      // the sandbox worker starts processing on its own audio thread
+      if (!_sandbox && !_plugin->startProcessing()) {
          // the plugin failed to start processing
          setPluginState(ActiveWithError);
          return;
@@ -696,148 +854,135 @@ void PluginHost::process() {
       setPluginState(ActiveAndProcessing);
    }
 
-   int32_t status = CLAP_PROCESS_SLEEP;
-   if (isPluginProcessing())
-      status = _plugin->process(&_process);
+   const bool isProbingLatency = isPluginProcessing() && _latencyProbe.isRunning();
+   if (isProbingLatency)
+      _latencyProbe.generate(_audioIn.data32, _audioIn.channel_count, _process.frames_count);
 
-   handlePluginOutputEvents();
+   int32_t status = CLAP_PROCESS_SLEEP;
+   if (isPluginProcessing()) {
+      // the sandboxed plugin runs in another process, its counters aren't ours
+      status = _audioBlock.process(_process, g_perf_counters && !_sandbox, [this] {
+         return _sandbox ? _sandbox->process(_process) : _plugin->process(&_process);
+      });
+   }
 
-   _evOut.clear();
-   _evIn.clear();
+   if (isProbingLatency) {
+      _latencyProbe.record(_audioOut.data32, _audioOut.channel_count, _process.frames_count);
+      if (_latencyProbe.isDone())
+         _mainThreadWaker.wake();
+   } else if (isPluginProcessing())
+      processDryPath();
 
-   _engineToAppValueQueue.producerDone();
+   // the values, gestures and misbehaviours are shown by idle()
+   if (_audioBlock.handleOutputEvents(_params))
+      _mainThreadWaker.wake();
+   _audioBlock.endBlock();
 
    // TODO: send plugin to sleep if possible
 
    g_thread_type = ThreadType::Unknown;
 }
 
-void PluginHost::generatePluginInputEvents() {
-   _appToEngineValueQueue.consume(
-      [this](clap_id param_id, const AppToEngineParamQueueValue &value) {
-         clap_event_param_value ev;
-         ev.header.time = 0;
-         ev.header.type = CLAP_EVENT_PARAM_VALUE;
-         ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
-         ev.header.flags = 0;
-         ev.header.size = sizeof(ev);
-         ev.param_id = param_id;
-         ev.cookie = _settings.shouldProvideCookie() ? value.cookie : nullptr;
-         ev.port_index = 0;
-         ev.key = -1;
-         ev.channel = -1;
-         ev.note_id = -1;
-         ev.value = value.value;
-         _evIn.push(&ev.header);
-      });
-
-   _appToEngineModQueue.consume([this](clap_id param_id, const AppToEngineParamQueueValue &value) {
-      clap_event_param_mod ev;
-      ev.header.time = 0;
-      ev.header.type = CLAP_EVENT_PARAM_MOD;
-      ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
-      ev.header.flags = 0;
-      ev.header.size = sizeof(ev);
-      ev.param_id = param_id;
-      ev.cookie = _settings.shouldProvideCookie() ? value.cookie : nullptr;
-      ev.port_index = 0;
-      ev.key = -1;
-      ev.channel = -1;
-      ev.note_id = -1;
-      ev.amount = value.value;
-      _evIn.push(&ev.header);
-   });
+void PluginHost::processDryPath() noexcept {
+   const uint32_t frames = _process.frames_count;
+   const uint32_t channelCount = std::min<uint32_t>(
+      {_audioIn.channel_count, _audioOut.channel_count, uint32_t(_dryDelayLines.size())});
+   const bool isBypassed = _isBypassed.load(std::memory_order_relaxed);
+
+   // The delay lines are always fed, so that toggling the bypass doesn't cause a gap.
+   for (uint32_t c = 0; c < channelCount; ++c) {
+      if (isBypassed)
+         _dryDelayLines[c].process(_audioIn.data32[c], _audioOut.data32[c], frames);
+      else
+         _dryDelayLines[c].write(_audioIn.data32[c], frames);
+   }
 }
 
-void PluginHost::handlePluginOutputEvents() {
-   for (uint32_t i = 0; i < _evOut.size(); ++i) {
-      auto h = _evOut.get(i);
-      switch (h->type) {
-      case CLAP_EVENT_PARAM_GESTURE_BEGIN: {
-         auto ev = reinterpret_cast<const clap_event_param_gesture *>(h);
-         bool &isAdj = _isAdjustingParameter[ev->param_id];
-
-         if (isAdj)
-            throw std::logic_error("The plugin sent BEGIN_ADJUST twice");
-         isAdj = true;
+void PluginHost::handlePluginMisbehaviours() {
+   checkForMainThread();
 
-         EngineToAppParamQueueValue v;
-         v.has_gesture = true;
-         v.is_begin = true;
-         _engineToAppValueQueue.setOrUpdate(ev->param_id, v);
+   AudioBlock::MisbehaviourReport report;
+   bool hasMisbehaved = false;
+   while (_audioBlock.takeMisbehaviour(report)) {
+      hasMisbehaved = true;
+      switch (report.type) {
+      case AudioBlock::Misbehaviour::GestureBeginTwice:
+         qWarning() << "The plugin sent CLAP_EVENT_PARAM_GESTURE_BEGIN twice for param_id:"
+                    << report.paramId;
          break;
-      }
 
-      case CLAP_EVENT_PARAM_GESTURE_END: {
-         auto ev = reinterpret_cast<const clap_event_param_gesture *>(h);
-         bool &isAdj = _isAdjustingParameter[ev->param_id];
-
-         if (!isAdj)
-            throw std::logic_error("The plugin sent END_ADJUST without a preceding BEGIN_ADJUST");
-         isAdj = false;
-         EngineToAppParamQueueValue v;
-         v.has_gesture = true;
-         v.is_begin = false;
-         _engineToAppValueQueue.setOrUpdate(ev->param_id, v);
+      case AudioBlock::Misbehaviour::GestureEndWithoutBegin:
+         qWarning() << "The plugin sent CLAP_EVENT_PARAM_GESTURE_END without a preceding "
+                       "CLAP_EVENT_PARAM_GESTURE_BEGIN for param_id:"
+                    << report.paramId;
          break;
-      }
 
-      case CLAP_EVENT_PARAM_VALUE: {
-         auto ev = reinterpret_cast<const clap_event_param_value *>(h);
-         EngineToAppParamQueueValue v;
-         v.has_value = true;
-         v.value = ev->value;
-         _engineToAppValueQueue.setOrUpdate(ev->param_id, v);
+      case AudioBlock::Misbehaviour::UnknownParamId:
+         qWarning() << "The plugin produced a parameter event with an unknown param_id:"
+                    << report.paramId;
          break;
       }
-      }
    }
+
+   if (hasMisbehaved && PluginHost_MH == clap::helpers::MisbehaviourHandler::Terminate &&
+       !g_minimal_checks)
+      std::terminate();
 }
 
 void PluginHost::paramFlushOnMainThread() {
    checkForMainThread();
+   TraceScope scope("param flush");
 
    assert(!isPluginActive());
 
    _scheduleParamFlush = false;
 
-   _evIn.clear();
-   _evOut.clear();
-
-   generatePluginInputEvents();
-
+   auto in = _audioBlock.prepareFlushEvents(_settings.shouldProvideCookie());
    if (_plugin->canUseParams())
-      _plugin->paramsFlush(_evIn.clapInputEvents(), _evOut.clapOutputEvents());
-   handlePluginOutputEvents();
-
-   _evOut.clear();
-   _engineToAppValueQueue.producerDone();
+      _plugin->paramsFlush(in, _audioBlock.outputEvents());
+   if (_audioBlock.handleOutputEvents(_params))
+      _mainThreadWaker.wake();
+   _audioBlock.endBlock();
 }
 
 void PluginHost::idle() {
    checkForMainThread();
 
    // Try to send events to the audio engine
-   _appToEngineValueQueue.producerDone();
-   _appToEngineModQueue.producerDone();
-
-   _engineToAppValueQueue.consume(
-      [this](clap_id param_id, const EngineToAppParamQueueValue &value) {
-         auto it = _params.find(param_id);
-         if (it == _params.end()) {
-            std::ostringstream msg;
-            msg << "Plugin produced a CLAP_EVENT_PARAM_SET with an unknown param_id: " << param_id;
-            throw std::invalid_argument(msg.str());
-         }
+   _audioBlock.producerDone();
+
+   handlePluginMisbehaviours();
+   printRtLog();
+   drainPerfBlocks();
+
+   const uint64_t droppedEvents = _audioBlock.takeDroppedEventCount();
+   if (droppedEvents > 0)
+      qWarning() << "Dropped" << droppedEvents << "input events over the limit of"
+                 << EventMerger::MAX_EVENTS << "per block";
+
+   if (_sandbox) {
+      const uint64_t droppedSandboxEvents = _sandbox->takeDroppedInputEventCount();
+      if (droppedSandboxEvents > 0)
+         qWarning() << "Dropped" << droppedSandboxEvents
+                    << "input events which didn't fit in the plugin sandbox's shared memory";
+   }
 
-         if (value.has_value)
-            it->second->setValue(value.value);
+#ifdef CLAP_HOST_RT_CHECKS
+   RtChecks::report();
+#endif
 
-         if (value.has_gesture)
-            it->second->setIsAdjusting(value.is_begin);
+   _audioBlock.consumeParamChanges([this](uint32_t index, const ParamValueMirror::Change &change) {
+      const clap_id paramId = _params.id(index);
+      if (change.hasValueChanged && _params.setValue(index, change.value))
+         _paramUpdates.markDirty(index, ParamUpdateCoalescer::Value);
 
-         emit paramAdjusted(param_id);
-      });
+      // a short gesture has to be shown as well
+      if (change.hasGestureBegun) {
+         setParamIsAdjusting(index, true);
+         emit paramAdjusted(paramId);
+      }
+      setParamIsAdjusting(index, change.isAdjusting);
+   });
 
    if (_scheduleParamFlush && !isPluginActive()) {
       paramFlushOnMainThread();
@@ -845,9 +990,14 @@ void PluginHost::idle() {
 
    if (_scheduleMainThreadCallback) {
       _scheduleMainThreadCallback = false;
+      updateCallbackLatency();
+      TraceScope scope("on_main_thread");
       _plugin->onMainThread();
    }
 
+   if (_latencyProbe.isDone())
+      reportMeasuredLatency();
+
    if (_scheduleRestart) {
       deactivate();
       _scheduleRestart = false;
@@ -855,9 +1005,151 @@ void PluginHost::idle() {
    }
 }
 
-PluginParam &PluginHost::checkValidParamId(const std::string_view &function,
-                                           const std::string_view &param_name,
-                                           clap_id param_id) {
+void PluginHost::updateCallbackLatency() {
+   const int64_t now = steadyTimeNs();
+   const int64_t requestNs = _callbackRequestNs.exchange(0);
+   if (requestNs > 0) {
+      const int64_t latency = now - requestNs;
+      if (_callbackLatency.count == 0)
+         _callbackLatency.periodStartNs = now;
+      ++_callbackLatency.count;
+      _callbackLatency.totalNs += latency;
+      _callbackLatency.maxNs = std::max(_callbackLatency.maxNs, latency);
+   }
+
+   // a summary every few seconds, if the plugin is using the callback
+   if (_callbackLatency.count == 0 || now - _callbackLatency.periodStartNs < 10'000'000'000)
+      return;
+
+   reportCallbackLatency();
+   _callbackLatency = {};
+   _callbackLatency.periodStartNs = now;
+}
+
+void PluginHost::reportCallbackLatency() const {
+   if (_callbackLatency.count == 0)
+      return;
+
+   qInfo().nospace() << "request_callback() to on_main_thread() latency: "
+                     << _callbackLatency.count << " callbacks, average "
+                     << _callbackLatency.totalNs / _callbackLatency.count / 1000 << " us, max "
+                     << _callbackLatency.maxNs / 1000 << " us";
+}
+
+void PluginHost::drainPerfBlocks() {
+   if (!g_perf_counters)
+      return;
+
+   if (!g_perf_counters_csv.isEmpty() && !_perfCsv) {
+      _perfCsv = std::make_unique<QFile>(g_perf_counters_csv);
+      if (!_perfCsv->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+         qWarning() << "Failed to open" << g_perf_counters_csv << ":" << _perfCsv->errorString();
+         g_perf_counters_csv.clear();
+         _perfCsv.reset();
+      } else
+         _perfCsv->write("steady_time,frames,cycles,instructions,cache_misses,branch_misses,"
+                         "context_switches,multiplexed\n");
+   }
+
+   AudioBlock::PerfBlock block;
+   while (_audioBlock.takePerfBlock(block)) {
+      _perfProcessTotals.add(block.values, block.frames);
+
+      if (block.values.isAvailable(PerfCounters::Cycles) && block.frames > 0) {
+         const double cyclesPerSample =
+            double(block.values.counts[PerfCounters::Cycles]) / block.frames;
+         if (cyclesPerSample > _perfWorstCyclesPerSample) {
+            _perfWorstCyclesPerSample = cyclesPerSample;
+            _perfWorstBlock = block;
+         }
+      }
+
+      if (_perfCsv) {
+         // the unavailable counters are left empty
+         QByteArray line = QByteArray::number(qlonglong(block.steadyTime)) + ',' +
+                           QByteArray::number(block.frames);
+         for (uint32_t i = 0; i < PerfCounters::COUNT; ++i) {
+            line += ',';
+            if (block.values.isAvailable(PerfCounters::Counter(i)))
+               line += QByteArray::number(qulonglong(block.values.counts[i]));
+         }
+         line += block.values.isMultiplexed ? ",1\n" : ",0\n";
+         _perfCsv->write(line);
+      }
+   }
+
+   // a summary every few seconds
+   const int64_t now = steadyTimeNs();
+   if (_perfPeriodStartNs == 0)
+      _perfPeriodStartNs = now;
+   else if (now - _perfPeriodStartNs >= 10'000'000'000) {
+      reportPerfCounters();
+      _perfPeriodStartNs = now;
+   }
+}
+
+// the counts are divided by the samples of the blocks, or by the calls
+static QString formatPerfCounters(const PerfCounterTotals::Snapshot &totals, bool isPerSample) {
+   const char *unit = isPerSample ? "sample" : "task";
+   const auto isAvailable = [&](PerfCounters::Counter counter) {
+      return totals.available & (1u << counter);
+   };
+
+   QStringList parts;
+   if (isAvailable(PerfCounters::Cycles) && isAvailable(PerfCounters::Instructions))
+      parts << QString("IPC %1").arg(totals.ipc(), 0, 'f', 2);
+
+   for (uint32_t i = 0; i < PerfCounters::COUNT; ++i) {
+      const auto counter = PerfCounters::Counter(i);
+      const QString name = QString("%1/%2").arg(PerfCounters::name(counter), unit);
+      if (!isAvailable(counter))
+         parts << name + " n/a";
+      else if (isPerSample)
+         parts << QString("%1 %2").arg(name).arg(totals.perSample(counter), 0, 'f', 3);
+      else {
+         const double perCall = double(totals.counts[i]) / totals.calls;
+         parts << QString("%1 %2").arg(name).arg(perCall, 0, 'f', 1);
+      }
+   }
+   return parts.join(", ");
+}
+
+void PluginHost::reportPerfCounters() {
+   const auto process = _perfProcessTotals.take();
+   const auto threadPool = _perfThreadPoolTotals.take();
+   const uint64_t dropped = _audioBlock.takePerfBlocksDropped();
+
+   if (process.calls > 0) {
+      auto stream = qInfo().nospace().noquote();
+      stream << "process() performance counters over " << process.calls
+             << " blocks: " << formatPerfCounters(process, true);
+      if (process.multiplexedCalls > 0)
+         stream << " (estimated in " << process.multiplexedCalls << " blocks)";
+      if (dropped > 0)
+         stream << ", " << dropped << " blocks not counted";
+
+      if (_perfWorstCyclesPerSample > 0) {
+         PerfCounterTotals::Snapshot worst;
+         worst.counts = _perfWorstBlock.values.counts;
+         worst.available = _perfWorstBlock.values.available;
+         worst.calls = 1;
+         worst.frames = _perfWorstBlock.frames;
+         stream << "; worst block at steady time " << _perfWorstBlock.steadyTime << ": "
+                << formatPerfCounters(worst, true);
+      }
+   }
+
+   if (threadPool.calls > 0)
+      qInfo().nospace().noquote() << "thread pool performance counters over " << threadPool.calls
+                                  << " tasks: " << formatPerfCounters(threadPool, false);
+
+   _perfWorstBlock = {};
+   _perfWorstCyclesPerSample = 0;
+}
+
+uint32_t PluginHost::checkValidParamId(const std::string_view &function,
+                                       const std::string_view &param_name,
+                                       clap_id param_id) {
    checkForMainThread();
 
    if (param_id == CLAP_INVALID_ID) {
@@ -866,48 +1158,60 @@ PluginParam &PluginHost::checkValidParamId(const std::string_view &function,
       throw std::invalid_argument(msg.str());
    }
 
-   auto it = _params.find(param_id);
-   if (it == _params.end()) {
+   const int32_t index = _params.indexOf(param_id);
+   if (index < 0) {
       std::ostringstream msg;
       msg << "Plugin called " << function << " with  an invalid " << param_name
           << " == " << param_id;
       throw std::invalid_argument(msg.str());
    }
 
-   Q_ASSERT(it->first == param_id);
-   Q_ASSERT(it->second->info().id == param_id);
-   return *it->second;
+   Q_ASSERT(_params.id(index) == param_id);
+   return index;
 }
 
-void PluginHost::checkValidParamValue(const PluginParam &param, double value) {
+void PluginHost::checkValidParamValue(const ParamStore &params, uint32_t index, double value) {
    checkForMainThread();
-   if (!param.isValueValid(value)) {
+   if (!params.isValueValid(index, value)) {
       std::ostringstream msg;
       msg << "Invalid value for param. ";
-      param.printInfo(msg);
+      params.printInfo(index, msg);
       msg << "; value: " << value;
       // std::cerr << msg.str() << std::endl;
       throw std::invalid_argument(msg.str());
    }
 }
 
-void PluginHost::setParamValueByHost(PluginParam &param, double value) {
+void PluginHost::setParamIsAdjusting(uint32_t index, bool isAdjusting) {
+   if (_params.setIsAdjusting(index, isAdjusting))
+      _paramUpdates.markDirty(index, ParamUpdateCoalescer::IsAdjusting);
+}
+
+void PluginHost::setParamValueByHost(clap_id paramId, double value) {
    checkForMainThread();
 
-   param.setValue(value);
+   const int32_t index = _params.indexOf(paramId);
+   if (index < 0)
+      return;
+
+   if (_params.setValue(index, value))
+      _paramUpdates.markDirty(index, ParamUpdateCoalescer::Value);
 
-   _appToEngineValueQueue.set(param.info().id, {param.info().cookie, value});
-   _appToEngineValueQueue.producerDone();
+   _audioBlock.sendParamValue(_params, index, value, steadyTimeNs());
    paramsRequestFlush();
 }
 
-void PluginHost::setParamModulationByHost(PluginParam &param, double value) {
+void PluginHost::setParamModulationByHost(clap_id paramId, double value) {
    checkForMainThread();
 
-   param.setModulation(value);
+   const int32_t index = _params.indexOf(paramId);
+   if (index < 0)
+      return;
+
+   if (_params.setModulation(index, value))
+      _paramUpdates.markDirty(index, ParamUpdateCoalescer::Modulation);
 
-   _appToEngineModQueue.set(param.info().id, {param.info().cookie, value});
-   _appToEngineModQueue.producerDone();
+   _audioBlock.sendParamModulation(paramId, _params.cookie(index), value);
    paramsRequestFlush();
 }
 
@@ -926,114 +1230,176 @@ void PluginHost::paramsRescan(uint32_t flags) noexcept {
       return;
    }
 
-   // 2. scan the params.
+   // 2. scan the params, only as much as the flags require
    auto count = _plugin->paramsCount();
-   std::unordered_set<clap_id> paramIds(count * 2);
+   if (flags & CLAP_PARAM_RESCAN_ALL)
+      rebuildParams(count);
+   else if (flags & CLAP_PARAM_RESCAN_INFO)
+      updateParams(count, flags);
+   else if (flags & CLAP_PARAM_RESCAN_VALUES)
+      refreshParamValues(count);
+
+   if (flags & (CLAP_PARAM_RESCAN_ALL | CLAP_PARAM_RESCAN_INFO | CLAP_PARAM_RESCAN_TEXT)) {
+      _paramTextCache.clear();
+      emit paramsTextChanged();
+   }
+}
+
+clap_param_info PluginHost::getParamInfo(uint32_t index) {
+   clap_param_info info;
+   if (!_plugin->paramsGetInfo(index, &info))
+      throw std::logic_error("clap_plugin_params.get_info did return false!");
+
+   if (info.id == CLAP_INVALID_ID) {
+      std::ostringstream msg;
+      msg << "clap_plugin_params.get_info() reported a parameter with id = CLAP_INVALID_ID"
+          << std::endl
+          << " 2. name: " << info.name << ", module: " << info.module << std::endl;
+      throw std::logic_error(msg.str());
+   }
+   return info;
+}
+
+void PluginHost::rebuildParams(uint32_t count) {
+   // The new parameters are built next to the current ones, so the widgets never see a
+   // half-built store.
+   _paramsScratch.clear();
+   _paramsScratch.reserve(count);
+   for (uint32_t i = 0; i < count; ++i) {
+      auto info = getParamInfo(i);
+      double value = getParamValue(info);
+      auto index = _paramsScratch.add(info, value);
+      checkValidParamValue(_paramsScratch, index, value);
+   }
+
+   // check that no parameter is declared twice
+   std::pair<uint32_t, uint32_t> duplicate;
+   if (!_paramsScratch.buildIndex(duplicate)) {
+      std::ostringstream msg;
+      msg << "the parameter with id: " << _paramsScratch.id(duplicate.first)
+          << " was declared twice." << std::endl
+          << " 1. name: " << _paramsScratch.name(duplicate.first)
+          << ", module: " << _paramsScratch.module(duplicate.first) << std::endl
+          << " 2. name: " << _paramsScratch.name(duplicate.second)
+          << ", module: " << _paramsScratch.module(duplicate.second) << std::endl;
+      throw std::logic_error(msg.str());
+   }
+
+   std::swap(_params, _paramsScratch);
+   _audioBlock.rebuildParams(_params.size());
+   _paramUpdates.reset(_params.size());
 
-   for (int32_t i = 0; i < count; ++i) {
-      clap_param_info info;
-      if (!_plugin->paramsGetInfo(i, &info))
-         throw std::logic_error("clap_plugin_params.get_info did return false!");
+   paramsChanged();
+}
+
+void PluginHost::updateParams(uint32_t count, uint32_t flags) {
+   auto &isScanned = _paramsScanned;
+   isScanned.assign(_params.size(), false);
+
+   for (uint32_t i = 0; i < count; ++i) {
+      auto info = getParamInfo(i);
+      const int32_t index = _params.indexOf(info.id);
 
-      if (info.id == CLAP_INVALID_ID) {
+      if (index < 0) {
          std::ostringstream msg;
-         msg << "clap_plugin_params.get_info() reported a parameter with id = CLAP_INVALID_ID"
-             << std::endl
-             << " 2. name: " << info.name << ", module: " << info.module << std::endl;
+         msg << "a new parameter was declared, but the flag CLAP_PARAM_RESCAN_ALL was not "
+                "specified; id: "
+             << info.id << ", name: " << info.name << ", module: " << info.module << std::endl;
          throw std::logic_error(msg.str());
       }
 
-      auto it = _params.find(info.id);
-
       // check that the parameter is not declared twice
-      if (paramIds.count(info.id) > 0) {
-         Q_ASSERT(it != _params.end());
-
+      if (isScanned[index]) {
          std::ostringstream msg;
          msg << "the parameter with id: " << info.id << " was declared twice." << std::endl
-             << " 1. name: " << it->second->info().name << ", module: " << it->second->info().module
+             << " 1. name: " << _params.name(index) << ", module: " << _params.module(index)
              << std::endl
              << " 2. name: " << info.name << ", module: " << info.module << std::endl;
          throw std::logic_error(msg.str());
       }
-      paramIds.insert(info.id);
+      isScanned[index] = true;
 
-      if (it == _params.end()) {
-         if (!(flags & CLAP_PARAM_RESCAN_ALL)) {
+      // update param info
+      if (!_params.isInfoEqualTo(index, info)) {
+         if (!clapParamsRescanMayInfoChange(flags)) {
             std::ostringstream msg;
-            msg << "a new parameter was declared, but the flag CLAP_PARAM_RESCAN_ALL was not "
-                   "specified; id: "
+            msg << "a parameter's info did change, but the flag CLAP_PARAM_RESCAN_INFO "
+                   "was not specified; id: "
                 << info.id << ", name: " << info.name << ", module: " << info.module << std::endl;
             throw std::logic_error(msg.str());
          }
 
-         double value = getParamValue(info);
-         auto param = std::make_unique<PluginParam>(*this, info, value);
-         checkValidParamValue(*param, value);
-         _params.insert_or_assign(info.id, std::move(param));
-      } else {
-         // update param info
-         if (!it->second->isInfoEqualTo(info)) {
-            if (!clapParamsRescanMayInfoChange(flags)) {
-               std::ostringstream msg;
-               msg << "a parameter's info did change, but the flag CLAP_PARAM_RESCAN_INFO "
-                      "was not specified; id: "
-                   << info.id << ", name: " << info.name << ", module: " << info.module
-                   << std::endl;
-               throw std::logic_error(msg.str());
-            }
-
-            if (!(flags & CLAP_PARAM_RESCAN_ALL) &&
-                !it->second->isInfoCriticallyDifferentTo(info)) {
-               std::ostringstream msg;
-               msg << "a parameter's info has critical changes, but the flag CLAP_PARAM_RESCAN_ALL "
-                      "was not specified; id: "
-                   << info.id << ", name: " << info.name << ", module: " << info.module
-                   << std::endl;
-               throw std::logic_error(msg.str());
-            }
-
-            it->second->setInfo(info);
+         if (_params.isInfoCriticallyDifferentTo(index, info)) {
+            std::ostringstream msg;
+            msg << "a parameter's info has critical changes, but the flag CLAP_PARAM_RESCAN_ALL "
+                   "was not specified; id: "
+                << info.id << ", name: " << info.name << ", module: " << info.module << std::endl;
+            throw std::logic_error(msg.str());
          }
 
-         double value = getParamValue(info);
-         if (it->second->value() != value) {
-            if (!clapParamsRescanMayValueChange(flags)) {
-               std::ostringstream msg;
-               msg << "a parameter's value did change but, but the flag CLAP_PARAM_RESCAN_VALUES "
-                      "was not specified; id: "
-                   << info.id << ", name: " << info.name << ", module: " << info.module
-                   << std::endl;
-               throw std::logic_error(msg.str());
-            }
-
-            // update param value
-            checkValidParamValue(*it->second, value);
-            it->second->setValue(value);
-            it->second->setModulation(value);
-         }
+         _params.setInfo(index, info);
+         _paramUpdates.markDirty(index, ParamUpdateCoalescer::Info);
       }
-   }
 
-   // remove parameters which are gone
-   for (auto it = _params.begin(); it != _params.end();) {
-      if (paramIds.find(it->first) != paramIds.end())
-         ++it;
-      else {
-         if (!(flags & CLAP_PARAM_RESCAN_ALL)) {
+      double value = getParamValue(info);
+      if (_params.value(index) != value) {
+         if (!clapParamsRescanMayValueChange(flags)) {
             std::ostringstream msg;
-            auto &info = it->second->info();
-            msg << "a parameter was removed, but the flag CLAP_PARAM_RESCAN_ALL was not "
-                   "specified; id: "
+            msg << "a parameter's value did change but, but the flag CLAP_PARAM_RESCAN_VALUES "
+                   "was not specified; id: "
                 << info.id << ", name: " << info.name << ", module: " << info.module << std::endl;
             throw std::logic_error(msg.str());
          }
-         it = _params.erase(it);
+
+         // update param value
+         checkValidParamValue(_params, index, value);
+         _params.setValue(index, value);
+         _paramUpdates.markDirty(index, ParamUpdateCoalescer::Value);
       }
    }
 
-   if (flags & CLAP_PARAM_RESCAN_ALL)
-      paramsChanged();
+   // parameters can only be removed with CLAP_PARAM_RESCAN_ALL
+   for (uint32_t index = 0; index < _params.size(); ++index) {
+      if (isScanned[index])
+         continue;
+
+      std::ostringstream msg;
+      msg << "a parameter was removed, but the flag CLAP_PARAM_RESCAN_ALL was not "
+             "specified; id: "
+          << _params.id(index) << ", name: " << _params.name(index)
+          << ", module: " << _params.module(index) << std::endl;
+      throw std::logic_error(msg.str());
+   }
+}
+
+void PluginHost::refreshParamValues(uint32_t count) {
+   if (count != _params.size()) {
+      std::ostringstream msg;
+      msg << "the parameter count did change from " << _params.size() << " to " << count
+          << ", but the flag CLAP_PARAM_RESCAN_ALL was not specified" << std::endl;
+      throw std::logic_error(msg.str());
+   }
+
+   // Only the values can change: fetch them all in one pass, then compare the arrays.
+   _paramValuesScratch.resize(count);
+   for (uint32_t i = 0; i < count; ++i) {
+      if (!_plugin->paramsGetValue(_params.id(i), &_paramValuesScratch[i])) {
+         std::ostringstream msg;
+         msg << "failed to get the param value, ";
+         _params.printShortInfo(i, msg);
+         throw std::logic_error(msg.str());
+      }
+   }
+
+   for (uint32_t i = 0; i < count; ++i) {
+      const double value = _paramValuesScratch[i];
+      if (_params.value(i) == value)
+         continue;
+
+      checkValidParamValue(_params, i, value);
+      _params.setValue(i, value);
+      _paramUpdates.markDirty(i, ParamUpdateCoalescer::Value);
+   }
 }
 
 void PluginHost::paramsClear(clap_id param_id, clap_param_clear_flags flags) noexcept {
@@ -1048,6 +1414,7 @@ void PluginHost::paramsRequestFlush() noexcept {
    }
 
    _scheduleParamFlush = true;
+   _mainThreadWaker.wake();
    return;
 }
 
@@ -1177,13 +1544,182 @@ void PluginHost::remoteControlsSuggestPage(clap_id page_id) noexcept {
 bool PluginHost::loadNativePluginPreset(const std::string &path) {
    checkForMainThread();
 
-   if (!_plugin->canUsePresetLoad())
+   if (!_plugin || !_plugin->canUsePresetLoad())
       return false;
 
+   _stateSnapshotBase.reset();
    return _plugin->presetLoadFromLocation(
       CLAP_PRESET_DISCOVERY_LOCATION_FILE, path.c_str(), nullptr);
 }
 
+static void logStateThroughput(const char *action,
+                               const std::string &path,
+                               uint64_t bytes,
+                               qint64 elapsedNs) {
+   const double mb = bytes / (1024. * 1024.);
+   const double ms = elapsedNs / 1e6;
+   qInfo().nospace() << action << " plugin state " << path.c_str() << ": " << mb << " MB in " << ms
+                     << " ms (" << (ms > 0 ? mb * 1000 / ms : 0) << " MB/s)";
+}
+
+bool PluginHost::loadStateFromFile(const std::string &path) {
+   checkForMainThread();
+
+   if (!_plugin || !_plugin->canUseState())
+      return false;
+
+   StateFileReader reader(QString::fromStdString(path));
+   if (!reader.open()) {
+      qWarning() << "Failed to open the plugin state file" << path.c_str();
+      return false;
+   }
+
+   QElapsedTimer timer;
+   timer.start();
+   if (!_plugin->stateLoad(reader.clapIStream())) {
+      qWarning() << "The plugin failed to load its state from" << path.c_str();
+      return false;
+   }
+
+   logStateThroughput("Loaded", path, reader.bytesRead(), timer.nsecsElapsed());
+   _stateIsDirty = false;
+   _stateSnapshotBase.reset();
+   return true;
+}
+
+bool PluginHost::saveStateToFile(const std::string &path) {
+   checkForMainThread();
+
+   if (!_plugin || !_plugin->canUseState())
+      return false;
+
+   StateFileWriter writer(QString::fromStdString(path));
+   if (!writer.open()) {
+      qWarning() << "Failed to open the plugin state file" << path.c_str();
+      return false;
+   }
+
+   QElapsedTimer timer;
+   timer.start();
+   if (!_plugin->stateSave(writer.clapOStream())) {
+      qWarning() << "The plugin failed to save its state to" << path.c_str();
+      return false;
+   }
+
+   if (!writer.commit()) {
+      qWarning() << "Failed to write the plugin state file" << path.c_str();
+      return false;
+   }
+
+   logStateThroughput("Saved", path, writer.bytesWritten(), timer.nsecsElapsed());
+   _stateIsDirty = false;
+   return true;
+}
+
+bool PluginHost::hasStateSnapshot(int slot) const {
+   return 0 <= slot && slot < STATE_SNAPSHOT_COUNT && _stateSnapshots[slot].state;
+}
+
+std::shared_ptr<const StateBuffer>
+PluginHost::findIdenticalStateSnapshot(const StateBuffer &state) const {
+   for (auto &snapshot : _stateSnapshots) {
+      if (snapshot.state && snapshot.state->isSameAs(state))
+         return snapshot.state;
+   }
+   return nullptr;
+}
+
+void PluginHost::clearStateSnapshots() {
+   for (auto &snapshot : _stateSnapshots) {
+      snapshot.state.reset();
+      snapshot.paramValues.clear();
+   }
+   _stateSnapshotBase.reset();
+}
+
+bool PluginHost::storeStateSnapshot(int slot) {
+   checkForMainThread();
+
+   if (!_plugin || slot < 0 || slot >= STATE_SNAPSHOT_COUNT)
+      return false;
+
+   std::shared_ptr<const StateBuffer> state;
+   if (_stateSnapshotBase && !_stateIsDirty) {
+      // Only the parameters may have changed since the base state was captured, and they are
+      // stored separately.
+      state = _stateSnapshotBase;
+   } else {
+      if (!_plugin->canUseState())
+         return false;
+
+      if (!_stateSnapshotScratch)
+         _stateSnapshotScratch = std::make_shared<StateBuffer>();
+
+      auto &scratch = *_stateSnapshotScratch;
+      scratch.data.clear();
+      StateBufferWriter writer(scratch.data);
+      if (!_plugin->stateSave(writer.clapOStream())) {
+         qWarning() << "The plugin failed to save its state into snapshot" << slot;
+         return false;
+      }
+      scratch.updateHash();
+
+      state = findIdenticalStateSnapshot(scratch);
+      if (!state) {
+         state = std::move(_stateSnapshotScratch);
+      }
+   }
+
+   auto &snapshot = _stateSnapshots[slot];
+   snapshot.state = state;
+   snapshot.paramValues.clear();
+   snapshot.paramValues.reserve(_params.size());
+   for (uint32_t i = 0; i < _params.size(); ++i)
+      snapshot.paramValues.emplace_back(_params.id(i), _params.value(i));
+
+   _stateSnapshotBase = std::move(state);
+   _stateIsDirty = false;
+   return true;
+}
+
+bool PluginHost::recallStateSnapshot(int slot) {
+   checkForMainThread();
+
+   if (!_plugin || !hasStateSnapshot(slot))
+      return false;
+
+   auto &snapshot = _stateSnapshots[slot];
+   if (snapshot.state != _stateSnapshotBase || _stateIsDirty) {
+      if (!_plugin->canUseState())
+         return false;
+
+      StateBufferReader reader(snapshot.state->data.data(), snapshot.state->data.size());
+      if (!_plugin->stateLoad(reader.clapIStream())) {
+         qWarning() << "The plugin failed to load its state from snapshot" << slot;
+         return false;
+      }
+
+      _stateSnapshotBase = snapshot.state;
+      _stateIsDirty = false;
+   }
+
+   // Send the parameters which differ as one burst of events.
+   bool hasChanges = false;
+   for (auto &[paramId, value] : snapshot.paramValues) {
+      const int32_t index = _params.indexOf(paramId);
+      if (index < 0 || !_params.setValue(index, value))
+         continue;
+
+      _paramUpdates.markDirty(index, ParamUpdateCoalescer::Value);
+      _audioBlock.sendParamValue(_params, index, value, steadyTimeNs());
+      hasChanges = true;
+   }
+
+   if (hasChanges)
+      paramsRequestFlush();
+   return true;
+}
+
 void PluginHost::stateMarkDirty() noexcept {
    checkForMainThread();
 
@@ -1244,13 +1780,29 @@ bool PluginHost::isPluginProcessing() const { return _state == ActiveAndProcessi
 bool PluginHost::isPluginSleeping() const { return _state == ActiveAndSleeping; }
 
 QString PluginHost::paramValueToText(clap_id paramId, double value) {
+   checkForMainThread();
+
    std::array<char, 256> buffer;
 
    if (!_plugin->canUseParams())
       return "-";
 
-   if (_plugin->paramsValueToText(paramId, value, buffer.data(), buffer.size()))
-      return buffer.data();
+   const int32_t index = _params.indexOf(paramId);
+   if (index >= 0) {
+      auto text =
+         _paramTextCache.find(paramId, value, _params.minValue(index), _params.maxValue(index));
+      if (text)
+         return *text;
+   }
 
-   return QString::number(value);
+   QString text;
+   if (_plugin->paramsValueToText(paramId, value, buffer.data(), buffer.size()))
+      text = buffer.data();
+   else
+      text = QString::number(value);
+
+   if (index >= 0)
+      _paramTextCache.insert(
+         paramId, value, _params.minValue(index), _params.maxValue(index), text);
+   return text;
 }
@@ -1,32 +1,50 @@
 ﻿#pragma once
 
 #include <array>
+#include <atomic>
 #include <memory>
 #include <unordered_map>
-#include <unordered_set>
 
+#include <QFile>
 #include <QLibrary>
 #include <QSemaphore>
-#include <QSocketNotifier>
 #include <QString>
 #include <QThread>
 #include <QTimer>
 #include <QWidget>
 
 #include <clap/clap.h>
-#include <clap/helpers/event-list.hh>
-#include <clap/helpers/reducing-param-queue.hh>
 #include <clap/helpers/host.hh>
 #include <clap/helpers/plugin-proxy.hh>
 
+#include "audio-block.hh"
+#include "delay-line.hh"
 #include "engine.hh"
-#include "plugin-param.hh"
+#include "fd-reactor.hh"
+#include "latency-probe.hh"
+#include "main-thread-waker.hh"
+#include "param-store.hh"
+#include "param-text-cache.hh"
+#include "param-update-coalescer.hh"
+#include "perf-counters.hh"
+#include "rt-log.hh"
+#include "state-stream.hh"
+#include "timer-wheel.hh"
+#include "tracer.hh"
 
 class Engine;
 class PluginHostSettings;
-
+class PluginSandbox;
+
+// The CLAP_HOST_MINIMAL_CHECKS build option trades the validation of every plugin call for
+// speed, to measure a plugin's performance without the host's overhead.
+#ifdef CLAP_HOST_MINIMAL_CHECKS
+constexpr auto PluginHost_MH = clap::helpers::MisbehaviourHandler::Ignore;
+constexpr auto PluginHost_CL = clap::helpers::CheckingLevel::Minimal;
+#else
 constexpr auto PluginHost_MH = clap::helpers::MisbehaviourHandler::Terminate;
 constexpr auto PluginHost_CL = clap::helpers::CheckingLevel::Maximal;
+#endif
 
 using BaseHost = clap::helpers::Host<PluginHost_MH, PluginHost_CL>;
 extern template class clap::helpers::Host<PluginHost_MH, PluginHost_CL>;
@@ -51,15 +69,17 @@ public:
    void recreatePluginWindow();
    void setPluginWindowVisibility(bool isVisible);
 
-   void setPorts(int numInputs, float **inputs, int numOutputs, float **outputs);
+   void setPorts(int numInputs,
+                 float **inputs,
+                 int numOutputs,
+                 float **outputs,
+                 uint32_t inputLatency,
+                 uint32_t outputLatency);
    void setParentWindow(WId parentWindow);
 
    void processBegin(int nframes);
-   void processNoteOn(int sampleOffset, int channel, int key, int velocity);
-   void processNoteOff(int sampleOffset, int channel, int key, int velocity);
-   void processNoteAt(int sampleOffset, int channel, int key, int pressure);
-   void processPitchBend(int sampleOffset, int channel, int value);
-   void processCC(int sampleOffset, int channel, int cc, int value);
+   void processKeyboardMidi(const uint8_t *data, uint32_t size);
+   void processMidi(int sampleOffset, const uint8_t *data, uint32_t size);
    void process();
    void processEnd(int nframes);
 
@@ -69,10 +89,11 @@ public:
    void terminateThreadPool();
    void threadPoolEntry();
 
-   void setParamValueByHost(PluginParam &param, double value);
-   void setParamModulationByHost(PluginParam &param, double value);
+   void setParamValueByHost(clap_id paramId, double value);
+   void setParamModulationByHost(clap_id paramId, double value);
 
-   auto &params() const { return _params; }
+   const ParamStore &params() const { return _params; }
+   ParamUpdateCoalescer &paramUpdates() { return _paramUpdates; }
    auto &remoteControlsPages() const { return _remoteControlsPages; }
    auto &remoteControlsPagesIndex() const { return _remoteControlsPagesIndex; }
    auto remoteControlsSelectedPage() const { return _remoteControlsSelectedPage; }
@@ -82,9 +103,28 @@ public:
    bool loadStateFromFile(const std::string &path);
    bool saveStateToFile(const std::string &path);
 
+   uint32_t pluginLatency() const { return _pluginLatency; }
+   void setBypassed(bool isBypassed);
+   bool measureLatency();
+
+   static constexpr int STATE_SNAPSHOT_COUNT = 4;
+   bool storeStateSnapshot(int slot);
+   bool recallStateSnapshot(int slot);
+   bool hasStateSnapshot(int slot) const;
+
    static void checkForMainThread();
    static void checkForAudioThread();
 
+   // Set at startup by --minimal-checks: skips checkForAudioThread(), and only warns about the
+   // plugin misbehaviours detected by the host instead of terminating. The plugin proxy keeps
+   // its own checks, as chosen by CLAP_HOST_MINIMAL_CHECKS at build time.
+   static void setMinimalChecks(bool isMinimal) noexcept;
+
+   // Set at startup by --perf-counters: reads the hardware performance counters around the
+   // plugin's process() and thread pool tasks, and logs a summary every few seconds. Each block's
+   // counters are also written to csvPath, if not empty.
+   static void setPerfCounters(bool isEnabled, const QString &csvPath);
+
    QString paramValueToText(clap_id paramId, double value);
 
 signals:
@@ -92,7 +132,14 @@ signals:
    void quickControlsPagesChanged();
    void quickControlsSelectedPageChanged();
    void paramAdjusted(clap_id paramId);
+
+   // the texts given by paramValueToText() may have changed
+   void paramsTextChanged();
    void pluginLoadedChanged(bool pluginLoaded);
+   void pluginLatencyChanged(uint32_t latency);
+
+   // measured is -1 if the probe could not be found in the plugin's output
+   void pluginLatencyMeasured(int measured);
 
 protected:
    /////////////////////////
@@ -112,6 +159,10 @@ protected:
    bool guiRequestHide() noexcept override;
    void guiClosed(bool wasDestroyed) noexcept override;
 
+   // clap_host_latency
+   bool implementsLatency() const noexcept override { return true; }
+   void latencyChanged() noexcept override;
+
    // clap_host_log
    bool implementsLog() const noexcept override { return true; }
    void logLog(clap_log_severity severity, const char *message) const noexcept override;
@@ -154,10 +205,15 @@ private:
    /* clap host callbacks */
    void scanParams();
    void scanParam(int32_t index);
-   PluginParam &checkValidParamId(const std::string_view &function,
-                                  const std::string_view &param_name,
-                                  clap_id param_id);
-   void checkValidParamValue(const PluginParam &param, double value);
+   clap_param_info getParamInfo(uint32_t index);
+   void rebuildParams(uint32_t count);
+   void updateParams(uint32_t count, uint32_t flags);
+   void refreshParamValues(uint32_t count);
+   uint32_t checkValidParamId(const std::string_view &function,
+                              const std::string_view &param_name,
+                              clap_id param_id);
+   void checkValidParamValue(const ParamStore &params, uint32_t index, double value);
+   void setParamIsAdjusting(uint32_t index, bool isAdjusting);
    double getParamValue(const clap_param_info &info);
    static bool clapParamsRescanMayValueChange(uint32_t flags) {
       return flags & (CLAP_PARAM_RESCAN_ALL | CLAP_PARAM_RESCAN_VALUES);
@@ -169,13 +225,20 @@ private:
    void scanQuickControls();
    void quickControlsSetSelectedPage(clap_id pageId);
 
-   void eventLoopSetFdNotifierFlags(int fd, int flags);
+   std::shared_ptr<const StateBuffer> findIdenticalStateSnapshot(const StateBuffer &state) const;
+   void clearStateSnapshots();
+
+   void updateNoteDialects();
+   void updateLatency(int32_t sampleRate);
+   void reportMeasuredLatency();
+   void processDryPath() noexcept;
 
    static const char *getCurrentClapGuiApi();
 
    void paramFlushOnMainThread();
-   void handlePluginOutputEvents();
-   void generatePluginInputEvents();
+
+   bool loadSandboxed(const QString &path, int pluginIndex);
+   void sandboxCrashed();
 
 private:
    Engine &_engine;
@@ -187,16 +250,23 @@ private:
    const clap_plugin_factory *_pluginFactory = nullptr;
    std::unique_ptr<PluginProxy> _plugin;
 
+   /* out-of-process plugin, used instead of _plugin when set */
+   std::unique_ptr<PluginSandbox> _sandbox;
+
    /* timers */
    clap_id _nextTimerId = 0;
-   std::unordered_map<clap_id, std::unique_ptr<QTimer>> _timers;
+   TimerWheel _timers{[this](clap_id timerId) {
+      checkForMainThread();
+      TraceScope scope("on_timer", timerId);
+      _plugin->timerSupportOnTimer(timerId);
+   }};
 
    /* fd events */
-   struct Notifiers {
-      std::unique_ptr<QSocketNotifier> rd;
-      std::unique_ptr<QSocketNotifier> wr;
-   };
-   std::unordered_map<int, std::unique_ptr<Notifiers>> _fds;
+   FdReactor _fds{[this](int fd, clap_posix_fd_flags_t flags) {
+      checkForMainThread();
+      TraceScope scope("on_fd", fd);
+      _plugin->posixFdSupportOnFd(fd, flags);
+   }};
 
    /* thread pool */
    std::vector<std::unique_ptr<QThread>> _threadPool;
@@ -208,42 +278,34 @@ private:
    /* process stuff */
    clap_audio_buffer _audioIn = {};
    clap_audio_buffer _audioOut = {};
-   clap::helpers::EventList _evIn;
-   clap::helpers::EventList _evOut;
    clap_process _process;
 
-   /* param update queues */
-   std::unordered_map<clap_id, std::unique_ptr<PluginParam>> _params;
+   // the events in and out of the plugin, and the parameter queues between the threads
+   AudioBlock _audioBlock;
 
-   struct AppToEngineParamQueueValue {
-      void *cookie;
-      double value;
-   };
+   /* latency */
+   uint32_t _pluginLatency = 0;
+   std::atomic<bool> _isBypassed = {false};
 
-   struct EngineToAppParamQueueValue {
-      void update(const EngineToAppParamQueueValue& v) noexcept {
-         if (v.has_value) {
-            has_value = true;
-            value = v.value;
-         }
-
-         if (v.has_gesture) {
-            has_gesture = true;
-            is_begin = v.is_begin;
-         }
-      }
-
-      bool has_value = false;
-      bool has_gesture = false;
-      bool is_begin = false;
-      double value = 0;
-   };
+   // the inputs delayed by the plugin's latency, so that bypassing the plugin keeps the alignment
+   std::array<DelayLine, 2> _dryDelayLines;
+   LatencyProbe _latencyProbe;
+
+   /* params */
+   ParamStore _params;
+   ParamStore _paramsScratch; // the next _params, during a full rescan
 
-   clap::helpers::ReducingParamQueue<clap_id, AppToEngineParamQueueValue> _appToEngineValueQueue;
-   clap::helpers::ReducingParamQueue<clap_id, AppToEngineParamQueueValue> _appToEngineModQueue;
-   clap::helpers::ReducingParamQueue<clap_id, EngineToAppParamQueueValue> _engineToAppValueQueue;
+   ParamTextCache _paramTextCache;
 
-   std::unordered_map<clap_id, bool> _isAdjustingParameter;
+   // the changes to show in the widgets, at the next frame
+   ParamUpdateCoalescer _paramUpdates{_params};
+
+   // kept between the rescans, to reuse their allocations
+   std::vector<bool> _paramsScanned;
+   std::vector<double> _paramValuesScratch;
+
+   // the plugin misbehaviours detected on the audio thread, reported by idle()
+   void handlePluginMisbehaviours();
 
    std::vector<std::unique_ptr<clap_remote_controls_page>> _remoteControlsPages;
    std::unordered_map<clap_id, clap_remote_controls_page *> _remoteControlsPagesIndex;
@@ -279,6 +341,19 @@ private:
    PluginState _state = Inactive;
    bool _stateIsDirty = false;
 
+   /* in-memory state snapshots */
+   struct StateSnapshot {
+      // identical states are shared between the slots
+      std::shared_ptr<const StateBuffer> state;
+      std::vector<std::pair<clap_id, double>> paramValues;
+   };
+   std::array<StateSnapshot, STATE_SNAPSHOT_COUNT> _stateSnapshots;
+
+   // State the plugin currently matches, apart from its parameter values. It stays valid as long
+   // as the plugin doesn't call clap_host_state.mark_dirty().
+   std::shared_ptr<const StateBuffer> _stateSnapshotBase;
+   std::shared_ptr<StateBuffer> _stateSnapshotScratch;
+
    bool _scheduleRestart = false;
    bool _scheduleDeactivate = false;
 
@@ -292,4 +367,38 @@ private:
    bool _isGuiFloating = false;
 
    bool _scheduleMainThreadCallback = false;
+
+   /* wakes idle() when a thread sets one of the above, instead of polling them */
+   mutable MainThreadWaker _mainThreadWaker; // mutable for logLog()
+
+   /* the log messages from the other threads than the main one, printed by idle() */
+   void printRtLog();
+
+   mutable RtLog _rtLog;
+
+   void updateCallbackLatency();
+   void reportCallbackLatency() const;
+
+   // set by the first request_callback() since the last on_main_thread()
+   std::atomic<int64_t> _callbackRequestNs = {0};
+
+   struct CallbackLatency {
+      int64_t periodStartNs = 0;
+      uint64_t count = 0;
+      int64_t totalNs = 0;
+      int64_t maxNs = 0;
+   };
+   CallbackLatency _callbackLatency;
+
+   /* hardware performance counters, see setPerfCounters() */
+   void drainPerfBlocks();
+   void reportPerfCounters();
+
+   PerfCounterTotals _perfProcessTotals; // main thread, from the drained blocks of _audioBlock
+   PerfCounterTotals _perfThreadPoolTotals;
+
+   int64_t _perfPeriodStartNs = 0;
+   AudioBlock::PerfBlock _perfWorstBlock = {};
+   double _perfWorstCyclesPerSample = 0;
+   std::unique_ptr<QFile> _perfCsv;
 };
@@ -1,71 +1,17 @@
 #include <QFormLayout>
 #include <QFrame>
+#include <QHeaderView>
 #include <QLabel>
 #include <QLayout>
 #include <QSlider>
 #include <QSplitter>
-#include <QTreeWidget>
+#include <QTimer>
+#include <QTreeView>
 
+#include "param-tree-model.hh"
 #include "plugin-host.hh"
-#include "plugin-param.hh"
 #include "plugin-parameters-widget.hh"
 
-///////////////////
-// ParamTreeItem //
-///////////////////
-
-PluginParametersWidget::ParamTreeItem::ParamTreeItem(ModuleTreeItem *parent, PluginParam &param)
-   : QTreeWidgetItem(parent), param_(param) {}
-
-QVariant PluginParametersWidget::ParamTreeItem::data(int column, int role) const {
-   if (column == 0 && role == Qt::DisplayRole)
-      return QString(param_.info().name);
-   return {};
-}
-
-void PluginParametersWidget::ParamTreeItem::setData(int column, int role, const QVariant &value) {
-   // nothing to do, read-only
-}
-
-////////////////////
-// ModuleTreeItem //
-////////////////////
-
-PluginParametersWidget::ModuleTreeItem::ModuleTreeItem(QTreeWidget *parent)
-   : QTreeWidgetItem(parent), name_("/") {}
-
-PluginParametersWidget::ModuleTreeItem::ModuleTreeItem(ModuleTreeItem *parent, const QString &name)
-   : QTreeWidgetItem(parent), name_(name) {}
-
-void PluginParametersWidget::ModuleTreeItem::clear() {
-   while (childCount() > 0)
-      removeChild(child(0));
-   modules_.clear();
-}
-
-PluginParametersWidget::ModuleTreeItem &
-PluginParametersWidget::ModuleTreeItem::subModule(const QString &name) {
-   auto it = modules_.find(name);
-   if (it != modules_.end())
-      return *it.value();
-   auto module = new ModuleTreeItem(this, name);
-   addChild(module);
-   modules_.insert(name, module);
-   return *module;
-}
-
-void PluginParametersWidget::ModuleTreeItem::addItem(ParamTreeItem *item) { addChild(item); }
-
-QVariant PluginParametersWidget::ModuleTreeItem::data(int column, int role) const {
-   if (column == 0 && role == Qt::DisplayRole)
-      return name_;
-   return {};
-}
-
-void PluginParametersWidget::ModuleTreeItem::setData(int column, int role, const QVariant &value) {
-   // nothing to do, read-only
-}
-
 ////////////////////////////
 // PluginParametersWidget //
 ////////////////////////////
@@ -73,29 +19,38 @@ void PluginParametersWidget::ModuleTreeItem::setData(int column, int role, const
 PluginParametersWidget::PluginParametersWidget(QWidget *parent, PluginHost &pluginHost)
    : QWidget(parent), _pluginHost(pluginHost) {
 
-   _treeWidget = new QTreeWidget(this);
-
    // Tree
-   _rootModuleItem = new ModuleTreeItem(_treeWidget);
-   _rootModuleItem->setExpanded(true);
-
-   _treeWidget->addTopLevelItem(_rootModuleItem);
-   _treeWidget->setHeaderHidden(true);
-   _treeWidget->setAnimated(true);
-   _treeWidget->setRootIsDecorated(false);
-   _treeWidget->setSelectionMode(QAbstractItemView::SingleSelection);
-   _treeWidget->setSelectionBehavior(QAbstractItemView::SelectItems);
-   _treeWidget->setVerticalScrollMode(QAbstractItemView::ScrollPerItem);
-   connect(
-      &_pluginHost, &PluginHost::paramsChanged, this, &PluginParametersWidget::computeDataModel);
+   _treeModel = new ParamTreeModel(_pluginHost, this);
+   _treeView = new QTreeView(this);
+   _treeView->setModel(_treeModel);
+   _treeView->setAnimated(true);
+   _treeView->setRootIsDecorated(false);
+   _treeView->setUniformRowHeights(true);
+   _treeView->setSelectionMode(QAbstractItemView::SingleSelection);
+   _treeView->setSelectionBehavior(QAbstractItemView::SelectRows);
+   _treeView->setVerticalScrollMode(QAbstractItemView::ScrollPerItem);
+   _treeView->header()->setStretchLastSection(true);
+   _treeView->expand(_treeModel->index(0, 0, {}));
+
+   // the model is connected first, so it is up to date when paramsChanged() is called
+   connect(&_pluginHost, &PluginHost::paramsChanged, this, &PluginParametersWidget::paramsChanged);
    connect(&_pluginHost,
            &PluginHost::paramAdjusted,
            this,
            &PluginParametersWidget::paramAdjustedFromPlugin);
-   connect(_treeWidget,
-           &QTreeWidget::currentItemChanged,
+   connect(_treeView->selectionModel(),
+           &QItemSelectionModel::currentChanged,
            this,
            &PluginParametersWidget::selectionChanged);
+   connect(&_pluginHost.paramUpdates(),
+           &ParamUpdateCoalescer::paramsUpdated,
+           this,
+           &PluginParametersWidget::paramsUpdated);
+   _pluginHost.paramUpdates().addWidget(this);
+   connect(&_pluginHost,
+           &PluginHost::paramsTextChanged,
+           this,
+           &PluginParametersWidget::updateParamValueText);
 
    // Info
    auto infoWidget = new QFrame(this);
@@ -128,6 +83,12 @@ PluginParametersWidget::PluginParametersWidget(QWidget *parent, PluginHost &plug
    _isBeingAdjusted = new QLabel;
    _valueLabel = new QLabel;
 
+   _valueTextTimer = new QTimer(this);
+   _valueTextTimer->setSingleShot(true);
+   _valueTextTimer->setInterval(16);
+   connect(
+      _valueTextTimer, &QTimer::timeout, this, &PluginParametersWidget::refreshParamValueText);
+
    _valueSlider = new QSlider;
    _valueSlider->setMinimum(0);
    _valueSlider->setMaximum(SLIDER_RANGE);
@@ -174,93 +135,46 @@ PluginParametersWidget::PluginParametersWidget(QWidget *parent, PluginHost &plug
 
    // Splitter
    auto splitter = new QSplitter();
-   splitter->addWidget(_treeWidget);
+   splitter->addWidget(_treeView);
    splitter->addWidget(infoWidget);
 
    auto layout = new QHBoxLayout(this);
    layout->addWidget(splitter);
    setLayout(layout);
 
-   computeDataModel();
    updateParamInfo();
 }
 
 void PluginParametersWidget::paramAdjustedFromPlugin(clap_id paramId) {
-   auto it = _idToParamTreeItem.find(paramId);
-   if (it == _idToParamTreeItem.end())
-      return;
-   _treeWidget->setCurrentItem(it->second.get());
+   auto index = _treeModel->paramIndex(paramId);
+   if (index.isValid())
+      _treeView->setCurrentIndex(index);
 }
 
-void PluginParametersWidget::computeDataModel() {
-   _rootModuleItem->clear();
-   _idToParamTreeItem.clear();
+void PluginParametersWidget::paramsChanged() {
+   _treeView->expand(_treeModel->index(0, 0, {}));
 
-   for (auto &it : _pluginHost.params()) {
-      auto &param = *it.second;
-
-      QString path(param.info().module);
-      auto modules = path.split("/", Qt::SkipEmptyParts);
-      auto module = _rootModuleItem;
-      for (auto &m : modules)
-         module = &module->subModule(m);
-
-      auto item = std::make_unique<ParamTreeItem>(module, param);
-      _idToParamTreeItem.insert_or_assign(param.info().id, std::move(item));
-   }
-   _treeWidget->sortItems(0, Qt::AscendingOrder);
+   // the selected parameter may be gone
+   updateAll();
 }
 
-void PluginParametersWidget::selectionChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous) {
-   if (!current) {
-      disconnectFromParam();
-      return;
-   }
-
-   auto module = dynamic_cast<ModuleTreeItem *>(current);
-   if (module) {
-      disconnectFromParam();
-      return;
-   }
-
-   auto item = dynamic_cast<ParamTreeItem *>(current);
-   if (item) {
-      connectToParam(&item->param());
-      return;
-   }
+void PluginParametersWidget::selectionChanged(const QModelIndex &current,
+                                              const QModelIndex &previous) {
+   setCurrentParam(_treeModel->paramId(current));
 }
 
-void PluginParametersWidget::connectToParam(PluginParam *param) {
-   if (_currentParam)
-      disconnectFromParam();
-
-   _currentParam = param;
-   connect(param, &PluginParam::infoChanged, this, &PluginParametersWidget::paramInfoChanged);
-   connect(param, &PluginParam::valueChanged, this, &PluginParametersWidget::paramValueChanged);
-   connect(param,
-           &PluginParam::isBeingAdjustedChanged,
-           this,
-           &PluginParametersWidget::updateParamIsBeingAjusted);
+void PluginParametersWidget::setCurrentParam(clap_id paramId) {
+   if (_currentParamId == paramId)
+      return;
 
+   _currentParamId = paramId;
    updateAll();
 }
 
-void PluginParametersWidget::disconnectFromParam() {
-   if (!_currentParam)
-      return;
-
-   disconnect(
-      _currentParam, &PluginParam::infoChanged, this, &PluginParametersWidget::paramInfoChanged);
-   disconnect(
-      _currentParam, &PluginParam::valueChanged, this, &PluginParametersWidget::paramValueChanged);
-   disconnect(_currentParam,
-              &PluginParam::isBeingAdjustedChanged,
-              this,
-              &PluginParametersWidget::updateParamIsBeingAjusted);
-
-   _currentParam = nullptr;
-
-   updateAll();
+int32_t PluginParametersWidget::currentParamIndex() const {
+   if (_currentParamId == CLAP_INVALID_ID)
+      return -1;
+   return _pluginHost.params().indexOf(_currentParamId);
 }
 
 void PluginParametersWidget::updateAll() {
@@ -271,7 +185,8 @@ void PluginParametersWidget::updateAll() {
 }
 
 void PluginParametersWidget::updateParamInfo() {
-   if (!_currentParam) {
+   const int32_t index = currentParamIndex();
+   if (index < 0) {
       _idLabel->setText("-");
       _nameLabel->setText("-");
       _moduleLabel->setText("-");
@@ -298,42 +213,43 @@ void PluginParametersWidget::updateParamInfo() {
       _isBeingAdjusted->setText("-");
       _valueLabel->setText("-");
    } else {
-      auto &p = *_currentParam;
-      auto &i = p.info();
-      _idLabel->setText(QString::number(i.id));
-      _nameLabel->setText(i.name);
-      _moduleLabel->setText(i.module);
-
-      _isAutomatableLabel->setText(i.flags & CLAP_PARAM_IS_AUTOMATABLE ? "true" : "false");
-      _isAutomatablePerNoteIdLabel->setText(i.flags & CLAP_PARAM_IS_AUTOMATABLE_PER_NOTE_ID ? "true" : "false");
-      _isAutomatablePerKeyLabel->setText(i.flags & CLAP_PARAM_IS_AUTOMATABLE_PER_KEY ? "true" : "false");
-      _isAutomatablePerChannelLabel->setText(i.flags & CLAP_PARAM_IS_AUTOMATABLE_PER_CHANNEL ? "true" : "false");
-      _isAutomatablePerPortLabel->setText(i.flags & CLAP_PARAM_IS_AUTOMATABLE_PER_PORT ? "true" : "false");
-      _isModulatableLabel->setText(i.flags & CLAP_PARAM_IS_MODULATABLE ? "true" : "false");
-      _isModulatablePerNoteIdLabel->setText(i.flags & CLAP_PARAM_IS_MODULATABLE_PER_NOTE_ID ? "true" : "false");
-      _isModulatablePerKeyLabel->setText(i.flags & CLAP_PARAM_IS_MODULATABLE_PER_KEY ? "true" : "false");
-      _isModulatablePerChannelLabel->setText(i.flags & CLAP_PARAM_IS_MODULATABLE_PER_CHANNEL ? "true" : "false");
-      _isModulatablePerPortLabel->setText(i.flags & CLAP_PARAM_IS_MODULATABLE_PER_PORT ? "true" : "false");
-
-      _isPeriodicLabel->setText(i.flags & CLAP_PARAM_IS_PERIODIC ? "true" : "false");
-      _isReadOnlyLabel->setText(i.flags & CLAP_PARAM_IS_READONLY ? "true" : "false");
-      _isHiddenLabel->setText(i.flags & CLAP_PARAM_IS_HIDDEN ? "true" : "false");
-      _isBypassLabel->setText(i.flags & CLAP_PARAM_IS_BYPASS ? "true" : "false");
-      _isBeingAdjusted->setText(p.isBeingAdjusted() ? "true" : "false");
-
-      _isSteppedLabel->setText(i.flags & CLAP_PARAM_IS_STEPPED ? "true" : "false");
-      _minValueLabel->setText(QString::number(i.min_value));
-      _maxValueLabel->setText(QString::number(i.max_value));
-      _defaultValueLabel->setText(QString::number(i.default_value));
+      auto &p = _pluginHost.params();
+      const auto flags = p.flags(index);
+      _idLabel->setText(QString::number(p.id(index)));
+      _nameLabel->setText(QString::fromStdString(p.name(index)));
+      _moduleLabel->setText(QString::fromStdString(p.module(index)));
+
+      _isAutomatableLabel->setText(flags & CLAP_PARAM_IS_AUTOMATABLE ? "true" : "false");
+      _isAutomatablePerNoteIdLabel->setText(flags & CLAP_PARAM_IS_AUTOMATABLE_PER_NOTE_ID ? "true" : "false");
+      _isAutomatablePerKeyLabel->setText(flags & CLAP_PARAM_IS_AUTOMATABLE_PER_KEY ? "true" : "false");
+      _isAutomatablePerChannelLabel->setText(flags & CLAP_PARAM_IS_AUTOMATABLE_PER_CHANNEL ? "true" : "false");
+      _isAutomatablePerPortLabel->setText(flags & CLAP_PARAM_IS_AUTOMATABLE_PER_PORT ? "true" : "false");
+      _isModulatableLabel->setText(flags & CLAP_PARAM_IS_MODULATABLE ? "true" : "false");
+      _isModulatablePerNoteIdLabel->setText(flags & CLAP_PARAM_IS_MODULATABLE_PER_NOTE_ID ? "true" : "false");
+      _isModulatablePerKeyLabel->setText(flags & CLAP_PARAM_IS_MODULATABLE_PER_KEY ? "true" : "false");
+      _isModulatablePerChannelLabel->setText(flags & CLAP_PARAM_IS_MODULATABLE_PER_CHANNEL ? "true" : "false");
+      _isModulatablePerPortLabel->setText(flags & CLAP_PARAM_IS_MODULATABLE_PER_PORT ? "true" : "false");
+
+      _isPeriodicLabel->setText(flags & CLAP_PARAM_IS_PERIODIC ? "true" : "false");
+      _isReadOnlyLabel->setText(flags & CLAP_PARAM_IS_READONLY ? "true" : "false");
+      _isHiddenLabel->setText(flags & CLAP_PARAM_IS_HIDDEN ? "true" : "false");
+      _isBypassLabel->setText(flags & CLAP_PARAM_IS_BYPASS ? "true" : "false");
+      _isBeingAdjusted->setText(p.isAdjusting(index) ? "true" : "false");
+
+      _isSteppedLabel->setText(flags & CLAP_PARAM_IS_STEPPED ? "true" : "false");
+      _minValueLabel->setText(QString::number(p.minValue(index)));
+      _maxValueLabel->setText(QString::number(p.maxValue(index)));
+      _defaultValueLabel->setText(QString::number(p.defaultValue(index)));
    }
 }
 
 void PluginParametersWidget::updateParamIsBeingAjusted() {
-   if (!_currentParam) {
+   const int32_t index = currentParamIndex();
+   if (index < 0) {
       _isBeingAdjusted->setText("-");
    } else {
-      auto &p = *_currentParam;
-      _isBeingAdjusted->setText(p.isBeingAdjusted() ? "true" : "false");
+      auto &p = _pluginHost.params();
+      _isBeingAdjusted->setText(p.isAdjusting(index) ? "true" : "false");
    }
 }
 
@@ -341,60 +257,95 @@ void PluginParametersWidget::updateParamValue() {
    if (_valueSlider->isSliderDown())
       return;
 
-   if (!_currentParam)
+   const int32_t index = currentParamIndex();
+   if (index < 0)
       return;
 
-   auto info = _currentParam->info();
-   auto v = _currentParam->value();
-   _valueSlider->setValue(SLIDER_RANGE * (v - info.min_value) / (info.max_value - info.min_value));
+   auto &p = _pluginHost.params();
+   auto min = p.minValue(index);
+   auto max = p.maxValue(index);
+   _valueSlider->setValue(SLIDER_RANGE * (p.value(index) - min) / (max - min));
    updateParamValueText();
 }
 
 void PluginParametersWidget::updateParamValueText() {
+   // the plugin's value_to_text() can be slow, ask for the text at most once per frame
+   if (!_valueTextTimer->isActive())
+      _valueTextTimer->start();
+}
+
+void PluginParametersWidget::refreshParamValueText() {
+   // showEvent() will refresh it
+   if (!isVisible())
+      return;
+
+   const int32_t index = currentParamIndex();
+   if (index < 0)
+      return;
+
    _valueLabel->setText(
-      _pluginHost.paramValueToText(_currentParam->info().id, _currentParam->value()));
+      _pluginHost.paramValueToText(_currentParamId, _pluginHost.params().value(index)));
+}
+
+void PluginParametersWidget::showEvent(QShowEvent *event) {
+   QWidget::showEvent(event);
+   updateParamValueText();
 }
 
 void PluginParametersWidget::updateParamModulation() {
    if (_valueSlider->isSliderDown())
       return;
 
-   if (!_currentParam)
+   const int32_t index = currentParamIndex();
+   if (index < 0)
       return;
 
-   auto info = _currentParam->info();
-   auto v = _currentParam->value();
-   _valueSlider->setValue(SLIDER_RANGE * (v - info.min_value) / (info.max_value - info.min_value));
+   auto &p = _pluginHost.params();
+   auto min = p.minValue(index);
+   auto max = p.maxValue(index);
+   _valueSlider->setValue(SLIDER_RANGE * (p.value(index) - min) / (max - min));
 }
 
-void PluginParametersWidget::paramInfoChanged() { updateParamInfo(); }
-
-void PluginParametersWidget::paramValueChanged() { updateParamValue(); }
+void PluginParametersWidget::paramsUpdated() {
+   const auto updates = _pluginHost.paramUpdates().updates(_currentParamId);
+   if (updates & ParamUpdateCoalescer::Info)
+      updateParamInfo();
+   if (updates & (ParamUpdateCoalescer::Info | ParamUpdateCoalescer::Value))
+      updateParamValue();
+   if (updates & ParamUpdateCoalescer::Modulation)
+      updateParamModulation();
+   if (updates & ParamUpdateCoalescer::IsAdjusting)
+      updateParamIsBeingAjusted();
+}
 
 void PluginParametersWidget::sliderValueChanged(int newValue) {
-   if (!_currentParam)
+   const int32_t index = currentParamIndex();
+   if (index < 0)
       return;
 
    if (!_valueSlider->isSliderDown())
       return;
 
-   auto &info = _currentParam->info();
+   auto &p = _pluginHost.params();
+   auto min = p.minValue(index);
+   auto max = p.maxValue(index);
 
-   double value = newValue * (info.max_value - info.min_value) / SLIDER_RANGE + info.min_value;
-   _pluginHost.setParamValueByHost(*_currentParam, value);
+   double value = newValue * (max - min) / SLIDER_RANGE + min;
+   _pluginHost.setParamValueByHost(_currentParamId, value);
    updateParamValueText();
 }
 
 void PluginParametersWidget::sliderModulationChanged(int newValue) {
-   if (!_currentParam)
+   const int32_t index = currentParamIndex();
+   if (index < 0)
       return;
 
    if (!_modulationSlider->isSliderDown())
       return;
 
-   auto &info = _currentParam->info();
+   auto &p = _pluginHost.params();
 
-   double dist = info.max_value - info.min_value;
+   double dist = p.maxValue(index) - p.minValue(index);
    double value = newValue * dist / SLIDER_RANGE;
-   _pluginHost.setParamModulationByHost(*_currentParam, value);
+   _pluginHost.setParamModulationByHost(_currentParamId, value);
 }
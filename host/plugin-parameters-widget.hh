@@ -1,74 +1,42 @@
 #pragma once
 
-#include <unordered_map>
-
-#include <QHash>
-#include <QList>
-#include <QTreeWidgetItem>
 #include <QWidget>
 
 #include <clap/clap.h>
 
 QT_BEGIN_NAMESPACE
-class QTreeWidget;
-class QTreeWidgetItem;
+class QModelIndex;
+class QTimer;
+class QTreeView;
 class QLabel;
 class QDial;
 class QSlider;
 QT_END_NAMESPACE
 
 class PluginHost;
-class PluginParam;
+class ParamTreeModel;
 
 class PluginParametersWidget : public QWidget {
    Q_OBJECT
 public:
    explicit PluginParametersWidget(QWidget *parent, PluginHost &pluginHost);
 
-   class ModuleTreeItem;
-   class ParamTreeItem : public QTreeWidgetItem {
-   public:
-      ParamTreeItem(ModuleTreeItem *parent, PluginParam &param);
-      QVariant data(int column, int role) const override;
-      void setData(int column, int role, const QVariant &value) override;
-
-      auto &param() { return param_; }
-      auto &param() const { return param_; }
-
-   private:
-      PluginParam &param_;
-   };
-
-   class ModuleTreeItem : public QTreeWidgetItem {
-   public:
-      ModuleTreeItem(QTreeWidget *parent);
-      ModuleTreeItem(ModuleTreeItem *parent, const QString &name);
-
-      void clear();
-
-      ModuleTreeItem &subModule(const QString &name);
-      void addItem(ParamTreeItem *item);
-
-      QVariant data(int column, int role) const override;
-      void setData(int column, int role, const QVariant &value) override;
-
-   private:
-      QString name_;
-      QHash<QString, ModuleTreeItem *> modules_;
-   };
-
 signals:
 
+protected:
+   void showEvent(QShowEvent *event) override;
+
 private:
-   void computeDataModel();
+   void paramsChanged();
    void paramAdjustedFromPlugin(clap_id paramId);
-   void selectionChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous);
+   void selectionChanged(const QModelIndex &current, const QModelIndex &previous);
+
+   void setCurrentParam(clap_id paramId);
 
-   void connectToParam(PluginParam *param);
-   void disconnectFromParam();
+   // -1 if no parameter is selected
+   int32_t currentParamIndex() const;
 
-   void paramInfoChanged();
-   void paramValueChanged();
+   void paramsUpdated();
    void sliderValueChanged(int newValue);
    void sliderModulationChanged(int newValue);
 
@@ -76,16 +44,16 @@ private:
    void updateParamInfo();
    void updateParamValue();
    void updateParamValueText();
+   void refreshParamValueText();
    void updateParamModulation();
    void updateParamIsBeingAjusted();
 
    static const constexpr int SLIDER_RANGE = 10000;
 
    PluginHost &_pluginHost;
-   QTreeWidget *_treeWidget = nullptr;
-   std::unordered_map<clap_id, std::unique_ptr<ParamTreeItem>> _idToParamTreeItem;
-   ModuleTreeItem *_rootModuleItem;
-   PluginParam *_currentParam = nullptr;
+   ParamTreeModel *_treeModel = nullptr;
+   QTreeView *_treeView = nullptr;
+   clap_id _currentParamId = CLAP_INVALID_ID;
 
    QLabel *_idLabel = nullptr;
    QLabel *_nameLabel = nullptr;
@@ -110,6 +78,7 @@ private:
    QLabel *_defaultValueLabel = nullptr;
    QLabel *_isBeingAdjusted = nullptr;
    QLabel *_valueLabel = nullptr;
+   QTimer *_valueTextTimer = nullptr;
    QSlider *_valueSlider = nullptr;
    QSlider *_modulationSlider = nullptr;
 };
@@ -3,7 +3,6 @@
 #include <QVBoxLayout>
 
 #include "plugin-host.hh"
-#include "plugin-param.hh"
 #include "plugin-quick-control-widget.hh"
 
 PluginQuickControlWidget::PluginQuickControlWidget(QWidget *parent, PluginHost &pluginHost)
@@ -20,65 +19,57 @@ PluginQuickControlWidget::PluginQuickControlWidget(QWidget *parent, PluginHost &
    layout->addWidget(_label);
    setLayout(layout);
 
-   setPluginParam(nullptr);
-
    connect(_dial, &QDial::valueChanged, this, &PluginQuickControlWidget::dialValueChanged);
+   connect(&pluginHost_.paramUpdates(),
+           &ParamUpdateCoalescer::paramsUpdated,
+           this,
+           &PluginQuickControlWidget::paramsUpdated);
+   pluginHost_.paramUpdates().addWidget(this);
+   connect(&pluginHost_, &PluginHost::paramsChanged, this, &PluginQuickControlWidget::updateAll);
 
    updateAll();
 }
 
-void PluginQuickControlWidget::setPluginParam(PluginParam *param) {
-   if (_param == param)
+void PluginQuickControlWidget::setParamId(clap_id paramId) {
+   if (_paramId == paramId)
       return;
 
-   if (_param)
-      disconnectFromParam();
-
-   Q_ASSERT(!_param);
-
-   if (param)
-      connectToParam(param);
-}
-
-void PluginQuickControlWidget::connectToParam(PluginParam *param) {
-   Q_ASSERT(!_param);
-   Q_ASSERT(param);
-
-   _param = param;
-   connect(_param, &PluginParam::infoChanged, this, &PluginQuickControlWidget::paramInfoChanged);
-   connect(_param, &PluginParam::valueChanged, this, &PluginQuickControlWidget::paramValueChanged);
+   _paramId = paramId;
    updateAll();
 }
 
-void PluginQuickControlWidget::disconnectFromParam() {
-   Q_ASSERT(_param);
-
-   disconnect(_param, &PluginParam::infoChanged, this, &PluginQuickControlWidget::paramInfoChanged);
-   disconnect(
-      _param, &PluginParam::valueChanged, this, &PluginQuickControlWidget::paramValueChanged);
-   _param = nullptr;
-
-   updateAll();
+int32_t PluginQuickControlWidget::paramIndex() const {
+   if (_paramId == CLAP_INVALID_ID)
+      return -1;
+   return pluginHost_.params().indexOf(_paramId);
 }
 
-void PluginQuickControlWidget::paramInfoChanged() { updateParamInfo(); }
-
-void PluginQuickControlWidget::paramValueChanged() { updateParamValue(); }
+void PluginQuickControlWidget::paramsUpdated() {
+   const auto updates = pluginHost_.paramUpdates().updates(_paramId);
+   if (updates & ParamUpdateCoalescer::Info)
+      updateParamInfo();
+   if (updates & (ParamUpdateCoalescer::Info | ParamUpdateCoalescer::Value))
+      updateParamValue();
+}
 
 void PluginQuickControlWidget::dialValueChanged(int newValue) {
-   if (!_param)
+   const int32_t index = paramIndex();
+   if (index < 0)
       return;
 
    if (!_dial->isSliderDown())
       return;
 
-   auto &info = _param->info();
+   auto &params = pluginHost_.params();
+   const double min = params.minValue(index);
+   const double max = params.maxValue(index);
 
-   double value = newValue * (info.max_value - info.min_value) / DIAL_RANGE + info.min_value;
-   pluginHost_.setParamValueByHost(*_param, value);
+   double value = newValue * (max - min) / DIAL_RANGE + min;
+   pluginHost_.setParamValueByHost(_paramId, value);
 }
 void PluginQuickControlWidget::updateParamValue() {
-   if (!_param) {
+   const int32_t index = paramIndex();
+   if (index < 0) {
       _dial->setEnabled(false);
       return;
    }
@@ -87,15 +78,17 @@ void PluginQuickControlWidget::updateParamValue() {
    if (_dial->isSliderDown())
       return;
 
-   auto info = _param->info();
-   auto v = _param->value();
-   auto normalizedValue = (v - info.min_value) / (info.max_value - info.min_value);
+   auto &params = pluginHost_.params();
+   const double min = params.minValue(index);
+   const double max = params.maxValue(index);
+   auto normalizedValue = (params.value(index) - min) / (max - min);
    _dial->setValue(DIAL_RANGE * normalizedValue);
 }
 
 void PluginQuickControlWidget::updateParamInfo() {
-   if (_param) {
-      _label->setText(_param->info().name);
+   const int32_t index = paramIndex();
+   if (index >= 0) {
+      _label->setText(QString::fromStdString(pluginHost_.params().name(index)));
       _label->setEnabled(true);
    } else {
       _label->setText("-");
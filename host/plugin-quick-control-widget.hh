@@ -10,22 +10,20 @@ class QLabel;
 QT_END_NAMESPACE
 
 class PluginHost;
-class PluginParam;
 class PluginQuickControlWidget : public QWidget {
    Q_OBJECT;
 
 public:
    PluginQuickControlWidget(QWidget *parent, PluginHost &pluginHost);
 
-   void setPluginParam(PluginParam *param);
+   void setParamId(clap_id paramId);
 
 private:
-   void paramInfoChanged();
-   void paramValueChanged();
+   void paramsUpdated();
    void dialValueChanged(int newValue);
 
-   void disconnectFromParam();
-   void connectToParam(PluginParam *param);
+   // -1 if there is no parameter, or if it is gone
+   int32_t paramIndex() const;
 
    void updateParamValue();
    void updateParamInfo();
@@ -37,5 +35,5 @@ private:
 
    QDial *_dial = nullptr;
    QLabel *_label = nullptr;
-   PluginParam *_param = nullptr;
+   clap_id _paramId = CLAP_INVALID_ID;
 };
\ No newline at end of file
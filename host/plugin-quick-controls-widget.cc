@@ -52,20 +52,14 @@ void PluginQuickControlsWidget::pagesChanged() {
 void PluginQuickControlsWidget::selectedPageChanged() {
    auto pageId = _pluginHost.remoteControlsSelectedPage();
    auto &pagesIndex = _pluginHost.remoteControlsPagesIndex();
-   auto &params = _pluginHost.params();
    auto it = pagesIndex.find(pageId);
 
    for (int i = 0; i < CLAP_REMOTE_CONTROLS_COUNT; ++i) {
-      PluginParam *param = nullptr;
+      clap_id paramId = CLAP_INVALID_ID;
+      if (it != pagesIndex.end())
+         paramId = it->second->param_ids[i];
 
-      if (it != pagesIndex.end()) {
-         auto paramId = it->second->param_ids[i];
-         auto paramIt = params.find(paramId);
-         if (paramIt != params.end())
-            param = paramIt->second.get();
-      }
-
-      _controls[i]->setPluginParam(param);
+      _controls[i]->setParamId(paramId);
    }
 }
 
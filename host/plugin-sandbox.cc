@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <QCoreApplication>
+#include <QDebug>
+
+#include "plugin-sandbox.hh"
+#include "sandbox-shm.hh"
+
+#ifdef Q_OS_LINUX
+#   include <csignal>
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <unistd.h>
+#endif
+
+PluginSandbox::PluginSandbox(QObject *parent) : QObject(parent) {
+   _eventScratch.resize(SANDBOX_EVENT_HEAP_SIZE / sizeof(uint64_t));
+   _worker.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+   connect(&_worker, &QProcess::finished, this, &PluginSandbox::workerFinished);
+}
+
+PluginSandbox::~PluginSandbox() { stop(); }
+
+static void silenceOutputs(const clap_process &process) noexcept {
+   for (uint32_t i = 0; i < process.audio_outputs_count; ++i) {
+      auto &out = process.audio_outputs[i];
+      for (uint32_t c = 0; c < out.channel_count; ++c)
+         std::fill_n(out.data32[c], process.frames_count, 0.f);
+   }
+}
+
+#ifdef Q_OS_LINUX
+
+bool PluginSandbox::isSupported() { return true; }
+
+bool PluginSandbox::start(const QString &path, int pluginIndex) {
+   stop();
+
+   static int counter = 0;
+   _shmName = QString("/clap-host-%1-%2").arg(QCoreApplication::applicationPid()).arg(counter++);
+   const auto shmName = _shmName.toStdString();
+
+   int fd = ::shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+   if (fd < 0) {
+      qWarning() << "Failed to create the plugin sandbox shared memory" << _shmName;
+      return false;
+   }
+
+   if (::ftruncate(fd, sizeof(SandboxShm)) != 0) {
+      qWarning() << "Failed to allocate the plugin sandbox shared memory";
+      ::close(fd);
+      ::shm_unlink(shmName.c_str());
+      return false;
+   }
+
+   void *mem = ::mmap(nullptr, sizeof(SandboxShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   ::close(fd);
+   if (mem == MAP_FAILED) {
+      qWarning() << "Failed to map the plugin sandbox shared memory";
+      ::shm_unlink(shmName.c_str());
+      return false;
+   }
+
+   // ftruncate() zero-fills the memory
+   _shm = static_cast<SandboxShm *>(mem);
+   _shm->magic = SANDBOX_SHM_MAGIC;
+   _shm->version = SANDBOX_SHM_VERSION;
+
+   auto program = QCoreApplication::applicationDirPath() + "/clap-host-sandbox";
+   _isHung = false;
+   _hasCorruptedOutput = false;
+   _worker.start(program, {path, QString::number(pluginIndex), _shmName});
+
+   QByteArray reply;
+   if (!_worker.waitForStarted(5000) || !readReply(reply) || reply != "ready") {
+      qWarning() << "Failed to start the plugin sandbox" << program;
+      stop();
+      return false;
+   }
+
+   // The worker did map the memory, the name is not needed anymore.
+   ::shm_unlink(shmName.c_str());
+   _shmName.clear();
+
+   _workerPid = _worker.processId();
+   _isAlive = true;
+   return true;
+}
+
+void PluginSandbox::stop() {
+   _isAlive = false;
+
+   if (_worker.state() != QProcess::NotRunning) {
+      _worker.write("quit\n");
+      if (!_worker.waitForFinished(2000)) {
+         _worker.kill();
+         _worker.waitForFinished();
+      }
+   }
+
+   _workerPid = 0;
+
+   if (_shm) {
+      ::munmap(_shm, sizeof(SandboxShm));
+      _shm = nullptr;
+   }
+
+   if (!_shmName.isEmpty()) {
+      ::shm_unlink(_shmName.toStdString().c_str());
+      _shmName.clear();
+   }
+}
+
+bool PluginSandbox::activate(int32_t sampleRate, int32_t blockSize) {
+   if (!_isAlive)
+      return false;
+
+   _blockCount = 0;
+   _overheadNsSum = 0;
+   _overheadNsMin = UINT64_MAX;
+   _overheadNsMax = 0;
+
+   return sendCommand(QByteArray("activate ") + QByteArray::number(sampleRate) + " " +
+                      QByteArray::number(blockSize));
+}
+
+void PluginSandbox::deactivate() {
+   if (_isAlive)
+      sendCommand("deactivate");
+
+   reportOverhead();
+}
+
+bool PluginSandbox::sendCommand(const QByteArray &command) {
+   _worker.write(command + "\n");
+   if (!_worker.waitForBytesWritten(5000))
+      return false;
+
+   QByteArray reply;
+   return readReply(reply) && reply == "ok";
+}
+
+bool PluginSandbox::readReply(QByteArray &reply) {
+   while (!_worker.canReadLine()) {
+      if (!_worker.waitForReadyRead(5000))
+         return false;
+   }
+
+   reply = _worker.readLine().trimmed();
+   return true;
+}
+
+void PluginSandbox::workerFinished() {
+   // a worker killed by the audio thread was already marked dead
+   const bool isHung = _isHung.exchange(false);
+   const bool hasCorruptedOutput = _hasCorruptedOutput.exchange(false);
+   if (!_isAlive && !isHung && !hasCorruptedOutput)
+      return;
+
+   _isAlive = false;
+   if (_shm)
+      sandboxFutexWake(_shm->response);
+
+   if (isHung)
+      qWarning() << "The plugin sandbox process stopped responding and was killed";
+   else if (hasCorruptedOutput)
+      qWarning() << "The plugin sandbox process wrote invalid output events and was killed";
+   else
+      qWarning() << "The plugin sandbox process died, exit code:" << _worker.exitCode();
+   emit crashed();
+}
+
+bool PluginSandbox::roundTrip() noexcept {
+   const uint32_t seq = _shm->request.load(std::memory_order_relaxed) + 1;
+   _shm->request.store(seq, std::memory_order_release);
+   sandboxFutexWake(_shm->request);
+
+   if (sandboxWaitForChange(_shm->response, seq - 1, 2000000, [this] { return !_isAlive; }))
+      return true;
+
+   killWorker(_isHung);
+   return false;
+}
+
+void PluginSandbox::killWorker(std::atomic<bool> &reason) noexcept {
+   if (!_isAlive.exchange(false))
+      return;
+
+   // workerFinished() will report it on the main thread
+   reason = true;
+   if (_workerPid > 0)
+      ::kill(pid_t(_workerPid), SIGKILL);
+}
+
+static bool isParamEvent(const clap_event_header &h) noexcept {
+   if (h.space_id != CLAP_CORE_EVENT_SPACE_ID)
+      return false;
+
+   switch (h.type) {
+   case CLAP_EVENT_PARAM_VALUE:
+   case CLAP_EVENT_PARAM_MOD:
+   case CLAP_EVENT_PARAM_GESTURE_BEGIN:
+   case CLAP_EVENT_PARAM_GESTURE_END:
+      return true;
+   default:
+      return false;
+   }
+}
+
+bool PluginSandbox::forwardOutputEvents(const clap_output_events *out) noexcept {
+   // each value is read once, the worker may still be writing them
+   const auto &events = _shm->outEvents;
+   const uint32_t count = events.count;
+   const uint32_t heapSize = events.heapSize;
+   if (count > SANDBOX_MAX_EVENTS || heapSize > SANDBOX_EVENT_HEAP_SIZE)
+      return false;
+
+   auto event = reinterpret_cast<clap_event_header *>(_eventScratch.data());
+   for (uint32_t i = 0; i < count; ++i) {
+      const uint32_t offset = events.offsets[i];
+      if (offset > heapSize || heapSize - offset < sizeof(clap_event_header))
+         return false;
+
+      std::memcpy(event, events.heap + offset, sizeof(clap_event_header));
+      const uint32_t size = event->size;
+      if (size < sizeof(clap_event_header) || size > heapSize - offset)
+         return false;
+
+      std::memcpy(event, events.heap + offset, size);
+      event->size = size;
+
+      // the host doesn't know the params of a sandboxed plugin
+      if (!isParamEvent(*event))
+         out->try_push(out, event);
+   }
+   return true;
+}
+
+int32_t PluginSandbox::process(const clap_process &process) noexcept {
+   if (!_isAlive || process.frames_count > SANDBOX_MAX_FRAMES) {
+      silenceOutputs(process);
+      return CLAP_PROCESS_ERROR;
+   }
+
+   auto &shm = *_shm;
+   const uint32_t frames = process.frames_count;
+
+   shm.inputChannels = 0;
+   if (process.audio_inputs_count > 0) {
+      auto &in = process.audio_inputs[0];
+      shm.inputChannels = std::min(in.channel_count, SANDBOX_MAX_CHANNELS);
+      for (uint32_t c = 0; c < shm.inputChannels; ++c)
+         std::memcpy(shm.audioIn[c], in.data32[c], frames * sizeof(float));
+   }
+
+   // kept here, the worker could overwrite the one in the shared memory
+   uint32_t outputChannels = 0;
+   if (process.audio_outputs_count > 0)
+      outputChannels = std::min(process.audio_outputs[0].channel_count, SANDBOX_MAX_CHANNELS);
+   shm.outputChannels = outputChannels;
+
+   shm.inEvents.clear();
+   uint64_t droppedEvents = 0;
+   const uint32_t numEvents = process.in_events->size(process.in_events);
+   for (uint32_t i = 0; i < numEvents; ++i) {
+      if (!shm.inEvents.tryPush(process.in_events->get(process.in_events, i)))
+         ++droppedEvents;
+   }
+   if (droppedEvents > 0)
+      _droppedInputEvents.fetch_add(droppedEvents, std::memory_order_relaxed);
+
+   shm.command = SandboxProcess;
+   shm.framesCount = frames;
+   shm.steadyTime = process.steady_time;
+
+   const auto t0 = std::chrono::steady_clock::now();
+   if (!roundTrip()) {
+      silenceOutputs(process);
+      return CLAP_PROCESS_ERROR;
+   }
+   const auto t1 = std::chrono::steady_clock::now();
+
+   const uint64_t roundTripNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+   const uint64_t overheadNs =
+      roundTripNs > shm.workerProcessNs ? roundTripNs - shm.workerProcessNs : 0;
+   ++_blockCount;
+   _overheadNsSum += overheadNs;
+   _overheadNsMin = std::min(_overheadNsMin, overheadNs);
+   _overheadNsMax = std::max(_overheadNsMax, overheadNs);
+
+   if (process.audio_outputs_count > 0) {
+      auto &out = process.audio_outputs[0];
+      for (uint32_t c = 0; c < out.channel_count; ++c) {
+         if (c < outputChannels)
+            std::memcpy(out.data32[c], shm.audioOut[c], frames * sizeof(float));
+         else
+            std::fill_n(out.data32[c], frames, 0.f);
+      }
+   }
+
+   if (!forwardOutputEvents(process.out_events)) {
+      killWorker(_hasCorruptedOutput);
+      silenceOutputs(process);
+      return CLAP_PROCESS_ERROR;
+   }
+
+   return shm.status;
+}
+
+void PluginSandbox::stopProcessing() noexcept {
+   if (!_isAlive)
+      return;
+
+   _shm->command = SandboxStopProcessing;
+   roundTrip();
+}
+
+void PluginSandbox::reportOverhead() {
+   if (_blockCount == 0)
+      return;
+
+   qInfo() << "Plugin sandbox round-trip overhead over" << _blockCount << "blocks: avg"
+           << (_overheadNsSum / _blockCount) / 1000.0 << "us, min" << _overheadNsMin / 1000.0
+           << "us, max" << _overheadNsMax / 1000.0 << "us";
+   _blockCount = 0;
+}
+
+#else
+
+bool PluginSandbox::isSupported() { return false; }
+bool PluginSandbox::start(const QString &path, int pluginIndex) { return false; }
+void PluginSandbox::stop() {}
+bool PluginSandbox::activate(int32_t sampleRate, int32_t blockSize) { return false; }
+void PluginSandbox::deactivate() {}
+bool PluginSandbox::sendCommand(const QByteArray &command) { return false; }
+bool PluginSandbox::readReply(QByteArray &reply) { return false; }
+void PluginSandbox::workerFinished() {}
+bool PluginSandbox::roundTrip() noexcept { return false; }
+bool PluginSandbox::forwardOutputEvents(const clap_output_events *out) noexcept { return false; }
+void PluginSandbox::killWorker(std::atomic<bool> &reason) noexcept {}
+
+int32_t PluginSandbox::process(const clap_process &process) noexcept {
+   silenceOutputs(process);
+   return CLAP_PROCESS_ERROR;
+}
+
+void PluginSandbox::stopProcessing() noexcept {}
+void PluginSandbox::reportOverhead() {}
+
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <QObject>
+#include <QProcess>
+#include <QString>
+
+#include <clap/clap.h>
+
+struct SandboxShm;
+
+// Runs the plugin in a child process (clap-host-sandbox), so that a crash or a terminate() in
+// the plugin does not take the host down.
+//
+// Only the audio processing crosses the process boundary: parameters, GUI and state are not
+// available for a sandboxed plugin, and its parameter events are dropped.
+//
+// The shared memory is writable by the plugin, so whatever the worker wrote in it is checked
+// before it is used; a worker which wrote nonsense is killed, as if it had crashed.
+class PluginSandbox : public QObject {
+   Q_OBJECT;
+
+public:
+   explicit PluginSandbox(QObject *parent = nullptr);
+   ~PluginSandbox() override;
+
+   static bool isSupported();
+
+   bool start(const QString &path, int pluginIndex);
+   void stop();
+
+   bool activate(int32_t sampleRate, int32_t blockSize);
+   void deactivate();
+
+   bool isAlive() const noexcept { return _isAlive; }
+
+   // audio thread
+   int32_t process(const clap_process &process) noexcept;
+   void stopProcessing() noexcept;
+
+   void reportOverhead();
+
+   // main thread: the input events which didn't fit in the shared memory since the last call
+   uint64_t takeDroppedInputEventCount() noexcept {
+      return _droppedInputEvents.exchange(0, std::memory_order_relaxed);
+   }
+
+signals:
+   void crashed();
+
+private:
+   bool sendCommand(const QByteArray &command);
+   bool readReply(QByteArray &reply);
+   bool roundTrip() noexcept;
+   bool forwardOutputEvents(const clap_output_events *out) noexcept;
+   void killWorker(std::atomic<bool> &reason) noexcept;
+   void workerFinished();
+
+   QProcess _worker;
+   QString _shmName;
+   SandboxShm *_shm = nullptr;
+   std::atomic<bool> _isAlive = {false};
+
+   // set by the audio thread when it kills the worker, so that workerFinished() reports why
+   std::atomic<bool> _isHung = {false};
+   std::atomic<bool> _hasCorruptedOutput = {false};
+
+   std::atomic<uint64_t> _droppedInputEvents = {0};
+
+   // a copy of each output event, taken before it is checked: the worker can still write it
+   std::vector<uint64_t> _eventScratch;
+
+   // cached on the main thread when the worker starts, QProcess isn't safe on the audio thread
+   qint64 _workerPid = 0;
+
+   /* round-trip stats, written by the audio thread and read once it is stopped */
+   uint64_t _blockCount = 0;
+   uint64_t _overheadNsSum = 0;
+   uint64_t _overheadNsMin = UINT64_MAX;
+   uint64_t _overheadNsMax = 0;
+};
@@ -0,0 +1,300 @@
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <QDebug>
+#include <QString>
+
+#include "rt-checks.hh"
+#include "thread-type.hh"
+
+// glibc's allocator, under the names it keeps for the interposers
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+// An entry of the offenders table, written once by the thread which inserts it.
+//
+// The table is constant-initialized: malloc() may be called before the dynamic initialization.
+struct RtOffender {
+   std::atomic<uint64_t> hash = {0}; // 0 for a free entry
+   std::atomic<bool> isReady = {false};
+   std::atomic<uint64_t> count = {0};
+
+   const char *function = nullptr;
+   ThreadType threadType = ThreadType::Unknown;
+   int frameCount = 0;
+   void *frames[RtChecks::MAX_FRAMES] = {};
+
+   // main thread
+   uint64_t reportedCount = 0;
+};
+
+static std::array<RtOffender, RtChecks::MAX_OFFENDERS> g_offenders;
+static std::atomic<uint64_t> g_tableFull = {0};
+static thread_local bool g_isRecording = false;
+
+// backtrace() loads the unwinder the first time, which allocates: done at startup
+[[maybe_unused]] static const bool g_isUnwinderLoaded = [] {
+   void *frame;
+   return ::backtrace(&frame, 1) > 0;
+}();
+
+static uint64_t hashStack(const char *function, void *const *frames, int count) noexcept {
+   // FNV-1a
+   uint64_t hash = 0xcbf29ce484222325ull;
+   auto mix = [&hash](uintptr_t value) {
+      hash ^= value;
+      hash *= 0x100000001b3ull;
+   };
+   mix(uintptr_t(function));
+   for (int i = 0; i < count; ++i)
+      mix(uintptr_t(frames[i]));
+   return hash ? hash : 1;
+}
+
+// Frames 0 and 1 are this function and the interposer.
+[[gnu::noinline]] static void record(const char *function) noexcept {
+   const ThreadType threadType = g_thread_type;
+   if (threadType != ThreadType::AudioThread && threadType != ThreadType::AudioThreadPool)
+      [[likely]]
+      return;
+
+   // backtrace() may lock or allocate, and must not come back here
+   if (g_isRecording)
+      return;
+   g_isRecording = true;
+
+   void *frames[RtChecks::MAX_FRAMES];
+   const int frameCount = ::backtrace(frames, RtChecks::MAX_FRAMES);
+   const uint64_t hash = hashStack(function, frames, frameCount);
+
+   // open addressing, the entries are never removed
+   bool isRecorded = false;
+   for (uint32_t i = 0; i < RtChecks::MAX_OFFENDERS && !isRecorded; ++i) {
+      auto &offender = g_offenders[(hash + i) % RtChecks::MAX_OFFENDERS];
+      uint64_t entryHash = offender.hash.load(std::memory_order_acquire);
+      if (entryHash == 0 &&
+          offender.hash.compare_exchange_strong(entryHash, hash, std::memory_order_acq_rel)) {
+         offender.function = function;
+         offender.threadType = threadType;
+         offender.frameCount = frameCount;
+         std::memcpy(offender.frames, frames, frameCount * sizeof(void *));
+         offender.isReady.store(true, std::memory_order_release);
+         entryHash = hash;
+      }
+
+      if (entryHash == hash) {
+         offender.count.fetch_add(1, std::memory_order_relaxed);
+         isRecorded = true;
+      }
+   }
+
+   if (!isRecorded)
+      g_tableFull.fetch_add(1, std::memory_order_relaxed);
+   g_isRecording = false;
+}
+
+///////////////
+// Allocator //
+///////////////
+
+extern "C" {
+
+void *malloc(size_t size) {
+   record("malloc");
+   return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+   record("calloc");
+   return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+   record("realloc");
+   return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+   if (ptr)
+      record("free");
+   __libc_free(ptr);
+}
+
+void *memalign(size_t alignment, size_t size) {
+   record("memalign");
+   return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+   record("aligned_alloc");
+   return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+   record("posix_memalign");
+   if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+      return EINVAL;
+
+   void *p = __libc_memalign(alignment, size);
+   if (!p)
+      return ENOMEM;
+   *ptr = p;
+   return 0;
+}
+
+} // extern "C"
+
+//////////////////////////
+// Locking and sleeping //
+//////////////////////////
+
+// Resolved on first use, without a function-local static: its guard may lock a mutex.
+template <typename Fn>
+static Fn next(std::atomic<void *> &cache, const char *name) noexcept {
+   void *fn = cache.load(std::memory_order_relaxed);
+   if (!fn) {
+      fn = ::dlsym(RTLD_NEXT, name);
+      cache.store(fn, std::memory_order_relaxed);
+   }
+   return reinterpret_cast<Fn>(fn);
+}
+
+// each one records the call, and forwards it to the C library
+#define RT_CHECKS_INTERPOSE(ret, name, params, args)                                               \
+   static std::atomic<void *> g_next_##name = {nullptr};                                          \
+   extern "C" ret name params {                                                                    \
+      record(#name);                                                                               \
+      return next<ret(*) params>(g_next_##name, #name) args;                                       \
+   }
+
+RT_CHECKS_INTERPOSE(int, pthread_mutex_lock, (pthread_mutex_t *m), (m))
+RT_CHECKS_INTERPOSE(int, pthread_rwlock_rdlock, (pthread_rwlock_t *l), (l))
+RT_CHECKS_INTERPOSE(int, pthread_rwlock_wrlock, (pthread_rwlock_t *l), (l))
+RT_CHECKS_INTERPOSE(int, pthread_cond_wait, (pthread_cond_t *c, pthread_mutex_t *m), (c, m))
+RT_CHECKS_INTERPOSE(int,
+                    pthread_cond_timedwait,
+                    (pthread_cond_t *c, pthread_mutex_t *m, const timespec *t),
+                    (c, m, t))
+RT_CHECKS_INTERPOSE(int, sem_wait, (sem_t *s), (s))
+RT_CHECKS_INTERPOSE(int, sem_timedwait, (sem_t *s, const timespec *t), (s, t))
+RT_CHECKS_INTERPOSE(int, nanosleep, (const timespec *t, timespec *r), (t, r))
+RT_CHECKS_INTERPOSE(int,
+                    clock_nanosleep,
+                    (clockid_t c, int f, const timespec *t, timespec *r),
+                    (c, f, t, r))
+RT_CHECKS_INTERPOSE(int, usleep, (useconds_t t), (t))
+
+///////////////
+// Reporting //
+///////////////
+
+static std::string fileName(const char *path) {
+   const char *slash = std::strrchr(path, '/');
+   return slash ? slash + 1 : path;
+}
+
+static std::string demangle(const char *symbol) {
+   int status = 0;
+   char *demangled = abi::__cxa_demangle(symbol, nullptr, nullptr, &status);
+   std::string name = status == 0 && demangled ? demangled : symbol;
+   std::free(demangled);
+   return name;
+}
+
+static std::string describeFrame(void *frame, const Dl_info &info) {
+   char offset[32];
+   if (info.dli_sname) {
+      std::snprintf(offset, sizeof(offset), "+0x%zx", size_t(frame) - size_t(info.dli_saddr));
+      return demangle(info.dli_sname) + offset + " (" + fileName(info.dli_fname) + ")";
+   }
+
+   std::snprintf(offset, sizeof(offset), "+0x%zx", size_t(frame) - size_t(info.dli_fbase));
+   return fileName(info.dli_fname) + offset;
+}
+
+static bool isPlugin(const char *path) {
+   const size_t length = std::strlen(path);
+   return length > 5 && !std::strcmp(path + length - 5, ".clap");
+}
+
+void RtChecks::report() {
+   // the interposed functions are called from here on, but from the main thread
+   Dl_info hostInfo;
+   ::dladdr(reinterpret_cast<void *>(&RtChecks::report), &hostInfo);
+
+   // per plugin and host code path
+   static std::array<std::string, MAX_OFFENDERS> attributions;
+   std::map<std::string, uint64_t> counts;
+
+   for (uint32_t i = 0; i < MAX_OFFENDERS; ++i) {
+      auto &offender = g_offenders[i];
+      if (!offender.isReady.load(std::memory_order_acquire))
+         continue;
+
+      const uint64_t count = offender.count.load(std::memory_order_relaxed);
+      if (count == offender.reportedCount)
+         continue;
+
+      if (offender.reportedCount == 0) {
+         const char *thread =
+            offender.threadType == ThreadType::AudioThread ? "audio thread" : "thread pool";
+         QString text = QString("%1() called on the %2:").arg(offender.function, thread);
+
+         std::string pluginFrame, hostFrame, libraryFrame;
+         for (int f = 2; f < offender.frameCount; ++f) {
+            void *frame = offender.frames[f];
+            Dl_info info;
+            if (!::dladdr(frame, &info) || !info.dli_fname) {
+               text += QString("\n   #%1 %2").arg(f - 2).arg(quintptr(frame), 0, 16);
+               continue;
+            }
+
+            const std::string description = describeFrame(frame, info);
+            text += QString("\n   #%1 %2").arg(f - 2).arg(QString::fromStdString(description));
+
+            if (pluginFrame.empty() && isPlugin(info.dli_fname))
+               pluginFrame = "plugin " + fileName(info.dli_fname);
+            if (hostFrame.empty() && info.dli_fbase == hostInfo.dli_fbase)
+               hostFrame = "host " + description;
+            if (libraryFrame.empty())
+               libraryFrame = "library " + fileName(info.dli_fname);
+         }
+
+         auto &attribution = attributions[i];
+         attribution = !pluginFrame.empty() ? pluginFrame
+                       : !hostFrame.empty() ? hostFrame
+                       : !libraryFrame.empty() ? libraryFrame
+                                               : std::string("unknown code");
+         qWarning().noquote() << text;
+      }
+
+      counts[attributions[i]] += count - offender.reportedCount;
+      offender.reportedCount = count;
+   }
+
+   for (auto &[attribution, count] : counts)
+      qWarning().nospace().noquote() << "real-time violations from the "
+                                     << QString::fromStdString(attribution) << ": " << count;
+
+   if (const uint64_t lost = g_tableFull.exchange(0, std::memory_order_relaxed))
+      qWarning() << lost << "real-time violations weren't recorded, the table is full";
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Built with CLAP_HOST_RT_CHECKS, Linux and glibc only: interposes the allocation, locking and
+// sleeping functions of the C library, for the host and the plugin alike, and records the call
+// stacks which reach them from a thread marked ThreadType::AudioThread or AudioThreadPool.
+//
+// The stacks are deduplicated in a fixed table of MAX_OFFENDERS entries, without locking nor
+// allocating. report() symbolizes the new ones on the main thread, and attributes each one to the
+// plugin if a .clap file is on its stack, or else to the innermost function of the host.
+//
+// The host's symbols aren't exported, its frames are printed as offsets for addr2line.
+//
+// operator new and delete aren't interposed: libstdc++ and libc++ implement them with malloc()
+// and free(), which are.
+class RtChecks {
+public:
+   static constexpr uint32_t MAX_OFFENDERS = 256;
+   static constexpr uint32_t MAX_FRAMES = 32;
+
+   // main thread: logs the offenders found since the previous call, and how many times the
+   // plugin and each host code path called the interposed functions since then
+   static void report();
+};
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "rt-log.hh"
+
+// Gives the ring back when its thread exits, the messages left in it are still drained.
+struct RtLogRingClaim {
+   const RtLog *owner = nullptr;
+   void *ring = nullptr;
+   std::atomic<bool> *isClaimed = nullptr;
+
+   ~RtLogRingClaim() {
+      if (isClaimed)
+         isClaimed->store(false, std::memory_order_release);
+   }
+};
+
+static thread_local RtLogRingClaim g_ringClaim;
+
+RtLog::RtLog() : _rings(std::make_unique<std::array<Ring, MAX_THREADS>>()) {}
+
+RtLog::~RtLog() {
+   // this thread's claim would point to a destroyed ring
+   if (g_ringClaim.owner == this)
+      g_ringClaim = {};
+}
+
+RtLog::Ring *RtLog::claimRing() noexcept {
+   if (g_ringClaim.owner == this)
+      return static_cast<Ring *>(g_ringClaim.ring);
+
+   for (auto &ring : *_rings) {
+      bool expected = false;
+      if (ring.isClaimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+         if (g_ringClaim.isClaimed)
+            g_ringClaim.isClaimed->store(false, std::memory_order_release);
+         g_ringClaim = {this, &ring, &ring.isClaimed};
+         return &ring;
+      }
+   }
+   return nullptr;
+}
+
+bool RtLog::takeToken(Ring &ring) noexcept {
+   // steady_clock doesn't enter the kernel on the platforms we care about
+   const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+
+   const int64_t refillPeriodNs = 1'000'000'000 / RATE_LIMIT;
+   const int64_t refills = (now - ring.lastRefillNs) / refillPeriodNs;
+   if (refills > 0) {
+      ring.tokens = std::min<int64_t>(RATE_BURST, ring.tokens + refills);
+      ring.lastRefillNs += refills * refillPeriodNs;
+   }
+
+   if (ring.tokens == 0)
+      return false;
+   --ring.tokens;
+   return true;
+}
+
+bool RtLog::log(clap_log_severity severity, const char *threadName, const char *text) noexcept {
+   auto ring = claimRing();
+   if (!ring) [[unlikely]] {
+      _noRing.fetch_add(1, std::memory_order_relaxed);
+      return false;
+   }
+
+   if (!takeToken(*ring)) {
+      ring->rateLimited.fetch_add(1, std::memory_order_relaxed);
+      return false;
+   }
+
+   // the message is built in place in the ring, the text is only copied once
+   auto message = ring->messages.tryReserve();
+   if (!message) {
+      ring->ringFull.fetch_add(1, std::memory_order_relaxed);
+      return false;
+   }
+
+   const size_t length = text ? ::strnlen(text, TEXT_SIZE) : 0;
+   message->severity = severity;
+   message->threadName = threadName;
+   message->isTruncated = length == TEXT_SIZE;
+   std::memcpy(message->text, text, std::min<size_t>(length, TEXT_SIZE - 1));
+   message->text[std::min<size_t>(length, TEXT_SIZE - 1)] = '\0';
+   ring->messages.commit();
+   return true;
+}
+
+RtLog::DroppedCount RtLog::takeDroppedCount() noexcept {
+   DroppedCount count;
+   for (auto &ring : *_rings) {
+      count.rateLimited += ring.rateLimited.exchange(0, std::memory_order_relaxed);
+      count.ringFull += ring.ringFull.exchange(0, std::memory_order_relaxed);
+   }
+   count.noRing = _noRing.exchange(0, std::memory_order_relaxed);
+   return count;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include <clap/clap.h>
+
+#include "spsc-queue.hh"
+
+// Log messages from the threads which must not lock nor allocate, printed by the main thread.
+//
+// Each thread claims one of a fixed set of rings the first time it logs, and copies its messages
+// into fixed-size slots: a message longer than a slot is truncated. A thread may only write
+// RATE_LIMIT messages per second, with bursts of up to RATE_BURST; the messages over the limit,
+// and the ones which don't fit in a full ring, are dropped and counted.
+//
+// The RtLog must outlive the threads which log to it.
+class RtLog {
+public:
+   static constexpr uint32_t MAX_THREADS = 16;
+   static constexpr uint32_t RING_SIZE = 64;
+   static constexpr uint32_t TEXT_SIZE = 240;
+
+   static constexpr uint32_t RATE_LIMIT = 50;
+   static constexpr uint32_t RATE_BURST = 20;
+
+   struct Message {
+      clap_log_severity severity;
+      const char *threadName; // a string literal
+      bool isTruncated;
+      char text[TEXT_SIZE];
+   };
+
+   struct DroppedCount {
+      uint64_t rateLimited = 0;
+      uint64_t ringFull = 0;
+      uint64_t noRing = 0;
+
+      uint64_t total() const noexcept { return rateLimited + ringFull + noRing; }
+   };
+
+   RtLog();
+   ~RtLog();
+
+   // any thread, returns true if the message was queued
+   bool log(clap_log_severity severity, const char *threadName, const char *text) noexcept;
+
+   // main thread: calls fn(message) for each queued message, thread by thread
+   template <typename Fn>
+   void drain(Fn &&fn) {
+      for (auto &ring : *_rings) {
+         while (ring.messages.tryPop(_drained))
+            fn(static_cast<const Message &>(_drained));
+      }
+   }
+
+   // main thread: the messages dropped since the previous call
+   DroppedCount takeDroppedCount() noexcept;
+
+private:
+   struct Ring {
+      std::atomic<bool> isClaimed = {false};
+      SpscQueue<Message, RING_SIZE> messages;
+
+      // producer only
+      int64_t lastRefillNs = 0;
+      uint32_t tokens = RATE_BURST;
+
+      std::atomic<uint64_t> rateLimited = {0};
+      std::atomic<uint64_t> ringFull = {0};
+   };
+
+   Ring *claimRing() noexcept;
+   static bool takeToken(Ring &ring) noexcept;
+
+   // a few hundred kilobytes: kept out of the owner's object
+   std::unique_ptr<std::array<Ring, MAX_THREADS>> _rings;
+   std::atomic<uint64_t> _noRing = {0};
+
+   Message _drained;
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include <clap/clap.h>
+
+#ifdef __linux__
+#   include <ctime>
+#   include <linux/futex.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
+
+// Memory shared between the host and the sandbox worker process.
+//
+// There is a single block in flight at any time, so the "ring" has exactly one slot: the host
+// fills the inputs, bumps `request` and the worker answers by bumping `response` once the outputs
+// are written. Both counters are futex words; the other side spins briefly before sleeping so
+// that a round-trip stays in the microsecond range when both threads are hot.
+
+constexpr uint32_t SANDBOX_SHM_MAGIC = 0x50414c43; // "CLAP"
+constexpr uint32_t SANDBOX_SHM_VERSION = 1;
+constexpr uint32_t SANDBOX_MAX_CHANNELS = 2;
+constexpr uint32_t SANDBOX_MAX_FRAMES = 8192;
+constexpr uint32_t SANDBOX_MAX_EVENTS = 2048;
+constexpr uint32_t SANDBOX_EVENT_HEAP_SIZE = 128 * 1024;
+
+enum SandboxCommand : uint32_t {
+   SandboxProcess,
+   SandboxStopProcessing,
+};
+
+struct SandboxEventBuffer {
+   void clear() noexcept {
+      count = 0;
+      heapSize = 0;
+   }
+
+   bool tryPush(const clap_event_header *h) noexcept {
+      const uint32_t alignedSize = (h->size + 7) & ~7u;
+      if (count >= SANDBOX_MAX_EVENTS || heapSize + alignedSize > SANDBOX_EVENT_HEAP_SIZE)
+         return false;
+
+      offsets[count++] = heapSize;
+      std::memcpy(heap + heapSize, h, h->size);
+      heapSize += alignedSize;
+      return true;
+   }
+
+   const clap_event_header *get(uint32_t index) const noexcept {
+      if (index >= count)
+         return nullptr;
+      return reinterpret_cast<const clap_event_header *>(heap + offsets[index]);
+   }
+
+   uint32_t count;
+   uint32_t heapSize;
+   uint32_t offsets[SANDBOX_MAX_EVENTS];
+   alignas(8) uint8_t heap[SANDBOX_EVENT_HEAP_SIZE];
+};
+
+struct SandboxShm {
+   uint32_t magic;
+   uint32_t version;
+
+   // futex words
+   alignas(64) std::atomic<uint32_t> request;
+   alignas(64) std::atomic<uint32_t> response;
+
+   // written by the host before bumping request
+   alignas(64) uint32_t command;
+   uint32_t framesCount;
+   int64_t steadyTime;
+   uint32_t inputChannels;
+   uint32_t outputChannels;
+
+   // written by the worker before bumping response
+   int32_t status;
+   uint64_t workerProcessNs;
+
+   alignas(64) float audioIn[SANDBOX_MAX_CHANNELS][SANDBOX_MAX_FRAMES];
+   alignas(64) float audioOut[SANDBOX_MAX_CHANNELS][SANDBOX_MAX_FRAMES];
+
+   alignas(64) SandboxEventBuffer inEvents;
+   alignas(64) SandboxEventBuffer outEvents;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+#ifdef __linux__
+// The futexes are shared between processes, so the _PRIVATE variants (which std::atomic::wait()
+// uses) must not be used here.
+inline bool sandboxFutexWait(std::atomic<uint32_t> &word, uint32_t expected, uint32_t timeoutUs) {
+   timespec ts;
+   ts.tv_sec = timeoutUs / 1000000;
+   ts.tv_nsec = (timeoutUs % 1000000) * 1000;
+   return syscall(
+             SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0) ==
+          0;
+}
+
+inline void sandboxFutexWake(std::atomic<uint32_t> &word) {
+   syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+// Waits until word != value, spinning for a short while first.
+// Returns false if the deadline expired or if shouldAbort() returned true.
+template <typename AbortFn>
+inline bool sandboxWaitForChange(std::atomic<uint32_t> &word,
+                                 uint32_t value,
+                                 uint32_t timeoutUs,
+                                 AbortFn &&shouldAbort) {
+   for (int i = 0; i < 4096; ++i) {
+      if (word.load(std::memory_order_acquire) != value)
+         return true;
+#   if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#   elif defined(__aarch64__)
+      asm volatile("yield");
+#   endif
+   }
+
+   timespec start;
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   while (word.load(std::memory_order_acquire) == value) {
+      if (shouldAbort())
+         return false;
+
+      timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      const int64_t elapsedUs =
+         (now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000;
+      if (elapsedUs >= timeoutUs)
+         return false;
+
+      // sleep in small slices so that shouldAbort() is polled regularly
+      sandboxFutexWait(word, value, std::min<int64_t>(timeoutUs - elapsedUs, 10000));
+   }
+   return true;
+}
+#endif
@@ -0,0 +1,426 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <clap/helpers/host.hh>
+#include <clap/helpers/plugin-proxy.hh>
+
+#include <clap/helpers/host.hxx>
+#include <clap/helpers/plugin-proxy.hxx>
+
+#include "sandbox-shm.hh"
+
+// Child process started by PluginSandbox.
+//
+// It loads the plugin and serves the process requests coming through the shared memory on its
+// own audio thread. The control commands (activate, deactivate, quit) are read line by line from
+// stdin and acknowledged on stdout; the plugin's own output on stdout is redirected to stderr.
+//
+// usage: clap-host-sandbox <plugin-path> <plugin-index> <shm-name>
+
+#ifdef CLAP_HOST_MINIMAL_CHECKS
+constexpr auto SandboxHost_MH = clap::helpers::MisbehaviourHandler::Ignore;
+constexpr auto SandboxHost_CL = clap::helpers::CheckingLevel::Minimal;
+#else
+constexpr auto SandboxHost_MH = clap::helpers::MisbehaviourHandler::Terminate;
+constexpr auto SandboxHost_CL = clap::helpers::CheckingLevel::Maximal;
+#endif
+
+using SandboxBaseHost = clap::helpers::Host<SandboxHost_MH, SandboxHost_CL>;
+template class clap::helpers::Host<SandboxHost_MH, SandboxHost_CL>;
+
+using SandboxPluginProxy = clap::helpers::PluginProxy<SandboxHost_MH, SandboxHost_CL>;
+template class clap::helpers::PluginProxy<SandboxHost_MH, SandboxHost_CL>;
+
+enum class ThreadType {
+   Unknown,
+   MainThread,
+   AudioThread,
+};
+
+thread_local ThreadType g_thread_type = ThreadType::Unknown;
+
+static int g_replyFd = -1;
+
+static void reply(const char *msg) {
+   std::string line(msg);
+   line += '\n';
+   if (::write(g_replyFd, line.data(), line.size()) != (ssize_t)line.size())
+      std::exit(1);
+}
+
+class SandboxHost final : public SandboxBaseHost {
+public:
+   SandboxHost()
+      : SandboxBaseHost("Clap Test Host (sandbox)",          // name
+                        "clap",                              // vendor
+                        "0.1.0",                             // version
+                        "https://github.com/free-audio/clap" // url
+        ) {}
+
+   bool load(const char *path, int pluginIndex);
+   void unload();
+
+   bool activate(int32_t sampleRate, int32_t blockSize);
+   void deactivate();
+
+   void startAudioThread(SandboxShm *shm);
+   void stopAudioThread();
+
+   void idle();
+
+protected:
+   // clap_host
+   void requestRestart() noexcept override;
+   void requestProcess() noexcept override {}
+   void requestCallback() noexcept override { _scheduleMainThreadCallback = true; }
+
+   // clap_host_log
+   bool implementsLog() const noexcept override { return true; }
+   void logLog(clap_log_severity severity, const char *message) const noexcept override;
+
+   // clap_host_thread_check
+   bool threadCheckIsMainThread() const noexcept override {
+      return g_thread_type == ThreadType::MainThread;
+   }
+   bool threadCheckIsAudioThread() const noexcept override {
+      return g_thread_type == ThreadType::AudioThread;
+   }
+
+private:
+   void audioThreadEntry();
+   void processRequest();
+
+   static uint32_t inEventsSize(const clap_input_events *list) noexcept;
+   static const clap_event_header *inEventsGet(const clap_input_events *list,
+                                               uint32_t index) noexcept;
+   static bool outEventsTryPush(const clap_output_events *list,
+                                const clap_event_header *event) noexcept;
+
+   void *_library = nullptr;
+   const clap_plugin_entry *_pluginEntry = nullptr;
+   std::unique_ptr<SandboxPluginProxy> _plugin;
+
+   SandboxShm *_shm = nullptr;
+   std::thread _audioThread;
+   std::atomic<bool> _stopAudioThread = {false};
+
+   std::atomic<bool> _isActive = {false};
+   bool _isProcessing = false; // audio thread only
+
+   std::atomic<bool> _scheduleMainThreadCallback = {false};
+};
+
+bool SandboxHost::load(const char *path, int pluginIndex) {
+   _library = ::dlopen(path, RTLD_NOW | RTLD_LOCAL | RTLD_DEEPBIND);
+   if (!_library) {
+      std::cerr << "[sandbox] failed to load plugin '" << path << "': " << ::dlerror() << std::endl;
+      return false;
+   }
+
+   _pluginEntry = reinterpret_cast<const clap_plugin_entry *>(::dlsym(_library, "clap_entry"));
+   if (!_pluginEntry) {
+      std::cerr << "[sandbox] unable to resolve entry point 'clap_entry' in '" << path << "'"
+                << std::endl;
+      return false;
+   }
+
+   _pluginEntry->init(path);
+
+   auto factory =
+      static_cast<const clap_plugin_factory *>(_pluginEntry->get_factory(CLAP_PLUGIN_FACTORY_ID));
+   if (!factory) {
+      std::cerr << "[sandbox] no plugin factory" << std::endl;
+      return false;
+   }
+
+   auto count = factory->get_plugin_count(factory);
+   if (pluginIndex < 0 || uint32_t(pluginIndex) >= count) {
+      std::cerr << "[sandbox] plugin index " << pluginIndex << " is invalid" << std::endl;
+      return false;
+   }
+
+   auto desc = factory->get_plugin_descriptor(factory, pluginIndex);
+   if (!desc || !clap_version_is_compatible(desc->clap_version)) {
+      std::cerr << "[sandbox] invalid or incompatible plugin descriptor" << std::endl;
+      return false;
+   }
+
+   auto plugin = factory->create_plugin(factory, clapHost(), desc->id);
+   if (!plugin) {
+      std::cerr << "[sandbox] could not create the plugin with id: " << desc->id << std::endl;
+      return false;
+   }
+
+   _plugin = std::make_unique<SandboxPluginProxy>(*plugin, *this);
+   if (!_plugin->init()) {
+      std::cerr << "[sandbox] could not init the plugin with id: " << desc->id << std::endl;
+      return false;
+   }
+
+   return true;
+}
+
+void SandboxHost::unload() {
+   stopAudioThread();
+   deactivate();
+
+   if (_plugin) {
+      _plugin->destroy();
+      _plugin.reset();
+   }
+
+   if (_pluginEntry) {
+      _pluginEntry->deinit();
+      _pluginEntry = nullptr;
+   }
+
+   if (_library) {
+      ::dlclose(_library);
+      _library = nullptr;
+   }
+}
+
+bool SandboxHost::activate(int32_t sampleRate, int32_t blockSize) {
+   if (_isActive)
+      return false;
+
+   if (blockSize <= 0 || uint32_t(blockSize) > SANDBOX_MAX_FRAMES)
+      return false;
+
+   if (!_plugin->activate(sampleRate, 1, blockSize))
+      return false;
+
+   _isActive = true;
+   return true;
+}
+
+void SandboxHost::deactivate() {
+   if (!_isActive)
+      return;
+
+   // The host sends SandboxStopProcessing before deactivating, so the audio thread is idle here.
+   _isActive = false;
+   _plugin->deactivate();
+}
+
+void SandboxHost::startAudioThread(SandboxShm *shm) {
+   _shm = shm;
+   _stopAudioThread = false;
+   _audioThread = std::thread(&SandboxHost::audioThreadEntry, this);
+}
+
+void SandboxHost::stopAudioThread() {
+   if (!_audioThread.joinable())
+      return;
+
+   _stopAudioThread = true;
+   sandboxFutexWake(_shm->request);
+   _audioThread.join();
+}
+
+void SandboxHost::audioThreadEntry() {
+   g_thread_type = ThreadType::AudioThread;
+
+   uint32_t seen = _shm->request.load(std::memory_order_acquire);
+   while (!_stopAudioThread) {
+      if (!sandboxWaitForChange(
+             _shm->request, seen, 100000, [this] { return _stopAudioThread.load(); }))
+         continue;
+
+      seen = _shm->request.load(std::memory_order_acquire);
+      processRequest();
+
+      _shm->response.store(seen, std::memory_order_release);
+      sandboxFutexWake(_shm->response);
+   }
+
+   if (_isProcessing) {
+      _plugin->stopProcessing();
+      _isProcessing = false;
+   }
+}
+
+uint32_t SandboxHost::inEventsSize(const clap_input_events *list) noexcept {
+   return static_cast<const SandboxEventBuffer *>(list->ctx)->count;
+}
+
+const clap_event_header *SandboxHost::inEventsGet(const clap_input_events *list,
+                                                  uint32_t index) noexcept {
+   return static_cast<const SandboxEventBuffer *>(list->ctx)->get(index);
+}
+
+bool SandboxHost::outEventsTryPush(const clap_output_events *list,
+                                   const clap_event_header *event) noexcept {
+   return static_cast<SandboxEventBuffer *>(list->ctx)->tryPush(event);
+}
+
+void SandboxHost::processRequest() {
+   auto &shm = *_shm;
+   shm.outEvents.clear();
+   shm.workerProcessNs = 0;
+
+   if (shm.command == SandboxStopProcessing) {
+      if (_isProcessing) {
+         _plugin->stopProcessing();
+         _isProcessing = false;
+      }
+      shm.status = CLAP_PROCESS_SLEEP;
+      return;
+   }
+
+   if (!_isActive || shm.framesCount > SANDBOX_MAX_FRAMES ||
+       shm.inputChannels > SANDBOX_MAX_CHANNELS || shm.outputChannels > SANDBOX_MAX_CHANNELS) {
+      shm.status = CLAP_PROCESS_ERROR;
+      return;
+   }
+
+   if (!_isProcessing) {
+      if (!_plugin->startProcessing()) {
+         shm.status = CLAP_PROCESS_ERROR;
+         return;
+      }
+      _isProcessing = true;
+   }
+
+   float *inputs[SANDBOX_MAX_CHANNELS];
+   float *outputs[SANDBOX_MAX_CHANNELS];
+   for (uint32_t i = 0; i < SANDBOX_MAX_CHANNELS; ++i) {
+      inputs[i] = shm.audioIn[i];
+      outputs[i] = shm.audioOut[i];
+   }
+
+   clap_audio_buffer audioIn = {};
+   audioIn.data32 = inputs;
+   audioIn.channel_count = shm.inputChannels;
+
+   clap_audio_buffer audioOut = {};
+   audioOut.data32 = outputs;
+   audioOut.channel_count = shm.outputChannels;
+
+   const clap_input_events inEvents = {&shm.inEvents, &inEventsSize, &inEventsGet};
+   const clap_output_events outEvents = {&shm.outEvents, &outEventsTryPush};
+
+   clap_process process = {};
+   process.steady_time = shm.steadyTime;
+   process.frames_count = shm.framesCount;
+   process.transport = nullptr;
+   process.audio_inputs = &audioIn;
+   process.audio_inputs_count = 1;
+   process.audio_outputs = &audioOut;
+   process.audio_outputs_count = 1;
+   process.in_events = &inEvents;
+   process.out_events = &outEvents;
+
+   auto t0 = std::chrono::steady_clock::now();
+   shm.status = _plugin->process(&process);
+   auto t1 = std::chrono::steady_clock::now();
+   shm.workerProcessNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+}
+
+void SandboxHost::idle() {
+   if (_scheduleMainThreadCallback.exchange(false))
+      _plugin->onMainThread();
+}
+
+void SandboxHost::requestRestart() noexcept {
+   std::cerr << "[sandbox] the plugin requested a restart, which the sandbox does not forward yet"
+             << std::endl;
+}
+
+void SandboxHost::logLog(clap_log_severity severity, const char *message) const noexcept {
+   std::cerr << "[sandbox] " << message << std::endl;
+}
+
+int main(int argc, char **argv) {
+   if (argc != 4) {
+      std::cerr << "usage: " << argv[0] << " <plugin-path> <plugin-index> <shm-name>" << std::endl;
+      return 1;
+   }
+
+   g_thread_type = ThreadType::MainThread;
+
+   // keep the original stdout for the protocol, and send everything else to stderr
+   g_replyFd = ::dup(STDOUT_FILENO);
+   ::dup2(STDERR_FILENO, STDOUT_FILENO);
+
+   int shmFd = ::shm_open(argv[3], O_RDWR, 0);
+   if (shmFd < 0) {
+      reply("error");
+      return 1;
+   }
+
+   void *mem = ::mmap(nullptr, sizeof(SandboxShm), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+   ::close(shmFd);
+   if (mem == MAP_FAILED) {
+      reply("error");
+      return 1;
+   }
+
+   auto shm = static_cast<SandboxShm *>(mem);
+   if (shm->magic != SANDBOX_SHM_MAGIC || shm->version != SANDBOX_SHM_VERSION) {
+      reply("error");
+      return 1;
+   }
+
+   SandboxHost host;
+   if (!host.load(argv[1], std::atoi(argv[2]))) {
+      reply("error");
+      host.unload();
+      return 1;
+   }
+
+   host.startAudioThread(shm);
+   reply("ready");
+
+   std::string pending;
+   char buffer[256];
+   bool quit = false;
+   while (!quit) {
+      pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+      int ret = ::poll(&pfd, 1, 10);
+      host.idle();
+
+      if (ret <= 0)
+         continue;
+
+      auto n = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+      if (n <= 0)
+         break; // the host is gone
+
+      pending.append(buffer, n);
+      for (auto pos = pending.find('\n'); pos != std::string::npos; pos = pending.find('\n')) {
+         auto line = pending.substr(0, pos);
+         pending.erase(0, pos + 1);
+
+         int32_t sampleRate = 0;
+         int32_t blockSize = 0;
+         if (std::sscanf(line.c_str(), "activate %d %d", &sampleRate, &blockSize) == 2)
+            reply(host.activate(sampleRate, blockSize) ? "ok" : "error");
+         else if (line == "deactivate") {
+            host.deactivate();
+            reply("ok");
+         } else if (line == "quit") {
+            quit = true;
+            break;
+         } else
+            reply("error");
+      }
+   }
+
+   host.unload();
+   ::munmap(mem, sizeof(SandboxShm));
+   return 0;
+}
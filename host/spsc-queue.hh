@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded lock-free queue, for one producer thread and one consumer thread.
+//
+// Unlike clap::helpers::ReducingParamQueue, every item is kept, in order. The capacity must be a
+// power of two, tryPush() fails when the queue is full.
+template <typename T, size_t Capacity>
+class SpscQueue {
+   static_assert((Capacity & (Capacity - 1)) == 0, "the capacity must be a power of two");
+
+public:
+   // producer
+   bool tryPush(const T &value) noexcept {
+      const size_t tail = _tail.load(std::memory_order_relaxed);
+      if (tail - _headCache == Capacity) {
+         _headCache = _head.load(std::memory_order_acquire);
+         if (tail - _headCache == Capacity)
+            return false;
+      }
+
+      _items[tail & (Capacity - 1)] = value;
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+   }
+
+   // producer: the next item, to be filled in place and then published by commit(); nullptr
+   // when the queue is full
+   T *tryReserve() noexcept {
+      const size_t tail = _tail.load(std::memory_order_relaxed);
+      if (tail - _headCache == Capacity) {
+         _headCache = _head.load(std::memory_order_acquire);
+         if (tail - _headCache == Capacity)
+            return nullptr;
+      }
+      return &_items[tail & (Capacity - 1)];
+   }
+
+   void commit() noexcept {
+      _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+   }
+
+   // consumer
+   bool tryPop(T &value) noexcept {
+      const size_t head = _head.load(std::memory_order_relaxed);
+      if (head == _tailCache) {
+         _tailCache = _tail.load(std::memory_order_acquire);
+         if (head == _tailCache)
+            return false;
+      }
+
+      value = _items[head & (Capacity - 1)];
+      _head.store(head + 1, std::memory_order_release);
+      return true;
+   }
+
+private:
+   static constexpr size_t CACHE_LINE_SIZE = 64;
+
+   // the indexes only grow, and are wrapped when accessing the items
+   alignas(CACHE_LINE_SIZE) std::atomic<size_t> _head = {0};
+   size_t _tailCache = 0; // consumer's copy of _tail
+
+   alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail = {0};
+   size_t _headCache = 0; // producer's copy of _head
+
+   alignas(CACHE_LINE_SIZE) std::array<T, Capacity> _items;
+};
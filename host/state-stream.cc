@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cstring>
+
+#include "state-stream.hh"
+
+/////////////////////
+// StateFileWriter //
+/////////////////////
+
+StateFileWriter::StateFileWriter(const QString &path) : _file(path) {
+   _stream.ctx = this;
+   _stream.write = &StateFileWriter::write;
+}
+
+bool StateFileWriter::open() {
+   _bytesWritten = 0;
+   return _file.open(QIODevice::WriteOnly);
+}
+
+bool StateFileWriter::commit() { return _file.commit(); }
+
+int64_t
+StateFileWriter::write(const clap_ostream *stream, const void *buffer, uint64_t size) noexcept {
+   auto self = static_cast<StateFileWriter *>(stream->ctx);
+   auto written = self->_file.write(static_cast<const char *>(buffer), size);
+   if (written < 0)
+      return -1;
+
+   self->_bytesWritten += written;
+   return written;
+}
+
+/////////////////////
+// StateFileReader //
+/////////////////////
+
+StateFileReader::StateFileReader(const QString &path) : _file(path) {
+   _stream.ctx = this;
+   _stream.read = &StateFileReader::read;
+}
+
+StateFileReader::~StateFileReader() {
+   if (_data)
+      _file.unmap(const_cast<uchar *>(_data));
+}
+
+bool StateFileReader::open() {
+   if (!_file.open(QIODevice::ReadOnly))
+      return false;
+
+   _size = _file.size();
+   _offset = 0;
+   if (_size > 0)
+      _data = _file.map(0, _size);
+   return true;
+}
+
+int64_t StateFileReader::read(const clap_istream *stream, void *buffer, uint64_t size) noexcept {
+   auto self = static_cast<StateFileReader *>(stream->ctx);
+
+   if (!self->_data) {
+      auto n = self->_file.read(static_cast<char *>(buffer), size);
+      if (n > 0)
+         self->_offset += n;
+      return n;
+   }
+
+   const uint64_t n = std::min(size, self->_size - self->_offset);
+   std::memcpy(buffer, self->_data + self->_offset, n);
+   self->_offset += n;
+   return n;
+}
+
+/////////////////
+// StateBuffer //
+/////////////////
+
+void StateBuffer::updateHash() noexcept {
+   // FNV-1a
+   uint64_t h = 14695981039346656037ull;
+   for (auto byte : data) {
+      h ^= byte;
+      h *= 1099511628211ull;
+   }
+   hash = h;
+}
+
+///////////////////////
+// StateBufferWriter //
+///////////////////////
+
+StateBufferWriter::StateBufferWriter(std::vector<uint8_t> &buffer) : _buffer(buffer) {
+   _stream.ctx = this;
+   _stream.write = &StateBufferWriter::write;
+}
+
+int64_t
+StateBufferWriter::write(const clap_ostream *stream, const void *buffer, uint64_t size) noexcept {
+   auto self = static_cast<StateBufferWriter *>(stream->ctx);
+   auto bytes = static_cast<const uint8_t *>(buffer);
+   try {
+      self->_buffer.insert(self->_buffer.end(), bytes, bytes + size);
+   } catch (...) {
+      return -1;
+   }
+   return size;
+}
+
+///////////////////////
+// StateBufferReader //
+///////////////////////
+
+StateBufferReader::StateBufferReader(const uint8_t *data, uint64_t size)
+   : _data(data), _size(size) {
+   _stream.ctx = this;
+   _stream.read = &StateBufferReader::read;
+}
+
+int64_t StateBufferReader::read(const clap_istream *stream, void *buffer, uint64_t size) noexcept {
+   auto self = static_cast<StateBufferReader *>(stream->ctx);
+   const uint64_t n = std::min(size, self->_size - self->_offset);
+   std::memcpy(buffer, self->_data + self->_offset, n);
+   self->_offset += n;
+   return n;
+}
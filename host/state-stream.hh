@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <QFile>
+#include <QSaveFile>
+#include <QString>
+
+#include <clap/clap.h>
+
+// clap_ostream writing to a file.
+//
+// The plugin's writes are forwarded as-is to a buffered QSaveFile, so the state never has to be
+// held in memory by the host, whatever chunk size the plugin uses. The file is only replaced once
+// commit() succeeds.
+class StateFileWriter {
+public:
+   explicit StateFileWriter(const QString &path);
+
+   bool open();
+   bool commit();
+
+   const clap_ostream *clapOStream() const noexcept { return &_stream; }
+   uint64_t bytesWritten() const noexcept { return _bytesWritten; }
+
+private:
+   static int64_t write(const clap_ostream *stream, const void *buffer, uint64_t size) noexcept;
+
+   QSaveFile _file;
+   clap_ostream _stream;
+   uint64_t _bytesWritten = 0;
+};
+
+// clap_istream reading from a memory-mapped file.
+//
+// Each read() is a single copy from the mapping into the plugin's buffer, sized by the plugin's
+// request. If the file can't be mapped, the reads go through QFile instead.
+class StateFileReader {
+public:
+   explicit StateFileReader(const QString &path);
+   ~StateFileReader();
+
+   bool open();
+
+   const clap_istream *clapIStream() const noexcept { return &_stream; }
+   uint64_t size() const noexcept { return _size; }
+   uint64_t bytesRead() const noexcept { return _offset; }
+
+private:
+   static int64_t read(const clap_istream *stream, void *buffer, uint64_t size) noexcept;
+
+   QFile _file;
+   const uchar *_data = nullptr;
+   uint64_t _size = 0;
+   uint64_t _offset = 0;
+   clap_istream _stream;
+};
+
+// Serialized plugin state held in memory.
+struct StateBuffer {
+   void updateHash() noexcept;
+   bool isSameAs(const StateBuffer &other) const noexcept {
+      return hash == other.hash && data == other.data;
+   }
+
+   std::vector<uint8_t> data;
+   uint64_t hash = 0;
+};
+
+// clap_ostream appending to a growable buffer: the plugin's writes go straight into the buffer,
+// which keeps its capacity across captures when it is reused.
+class StateBufferWriter {
+public:
+   explicit StateBufferWriter(std::vector<uint8_t> &buffer);
+
+   const clap_ostream *clapOStream() const noexcept { return &_stream; }
+
+private:
+   static int64_t write(const clap_ostream *stream, const void *buffer, uint64_t size) noexcept;
+
+   std::vector<uint8_t> &_buffer;
+   clap_ostream _stream;
+};
+
+// clap_istream reading from memory.
+class StateBufferReader {
+public:
+   StateBufferReader(const uint8_t *data, uint64_t size);
+
+   const clap_istream *clapIStream() const noexcept { return &_stream; }
+
+private:
+   static int64_t read(const clap_istream *stream, void *buffer, uint64_t size) noexcept;
+
+   const uint8_t *_data;
+   uint64_t _size;
+   uint64_t _offset = 0;
+   clap_istream _stream;
+};
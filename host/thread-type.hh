@@ -0,0 +1,11 @@
+#pragma once
+
+// The role of the current thread, set by the host on the threads it calls the plugin from.
+enum class ThreadType {
+   Unknown,
+   MainThread,
+   AudioThread,
+   AudioThreadPool,
+};
+
+extern thread_local ThreadType g_thread_type;
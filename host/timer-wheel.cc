@@ -0,0 +1,159 @@
+#include <algorithm>
+
+#include <QDebug>
+
+#include "timer-wheel.hh"
+
+TimerWheel::TimerWheel(Callback callback, QObject *parent)
+   : QObject(parent), _callback(std::move(callback)), _wakeup(this) {
+   _clock.start();
+
+   _wakeup.setSingleShot(true);
+   _wakeup.setTimerType(Qt::PreciseTimer);
+   connect(&_wakeup, &QTimer::timeout, this, &TimerWheel::fireDueTimers);
+}
+
+uint64_t TimerWheel::currentMs() const { return _clock.elapsed(); }
+
+void TimerWheel::add(clap_id timerId, uint32_t periodMs) {
+   remove(timerId);
+
+   const uint64_t period = std::max<uint64_t>(1, periodMs);
+   const uint64_t deadlineMs = currentMs() + period;
+
+   _timers.emplace(timerId, Timer{period, deadlineMs});
+   insert(timerId, deadlineMs);
+   arm();
+}
+
+bool TimerWheel::remove(clap_id timerId) {
+   auto it = _timers.find(timerId);
+   if (it == _timers.end())
+      return false;
+
+   erase(timerId, it->second.deadlineMs);
+   _timers.erase(it);
+
+   // the wakeup is left as it is: an early one only re-arms
+   return true;
+}
+
+void TimerWheel::clear() {
+   if (_stats.callbacks > 0)
+      qInfo().nospace() << "plugin timers: " << _stats.callbacks << " callbacks in "
+                        << _stats.wakeups << " wakeups, average "
+                        << _stats.totalNs / _stats.callbacks / 1000 << " us, max "
+                        << _stats.maxNs / 1000 << " us";
+
+   _timers.clear();
+   for (auto &slot : _slots)
+      slot.clear();
+   _wakeup.stop();
+   _stats = {};
+}
+
+std::vector<TimerWheel::SlotEntry> &TimerWheel::slotOf(uint64_t deadlineMs) {
+   return _slots[deadlineMs / TICK_MS % SLOT_COUNT];
+}
+
+void TimerWheel::insert(clap_id timerId, uint64_t deadlineMs) {
+   slotOf(deadlineMs).push_back({timerId, deadlineMs});
+}
+
+void TimerWheel::erase(clap_id timerId, uint64_t deadlineMs) {
+   // A due timer may have been taken from its slot already, see fireDueTimers().
+   auto &entries = slotOf(deadlineMs);
+   auto it = std::find_if(entries.begin(), entries.end(), [timerId](const SlotEntry &entry) {
+      return entry.timerId == timerId;
+   });
+   if (it == entries.end())
+      return;
+
+   *it = entries.back();
+   entries.pop_back();
+}
+
+void TimerWheel::arm() {
+   if (_timers.empty()) {
+      _wakeup.stop();
+      return;
+   }
+
+   // The nearest deadline within one turn of the wheel, otherwise wake up after a turn to look
+   // at the slots again. The first slot holding a deadline due by the end of its tick has it.
+   const uint64_t nowMs = currentMs();
+   const uint64_t now = nowMs / TICK_MS;
+   uint64_t nextMs = (now + SLOT_COUNT) * TICK_MS;
+   for (uint64_t tick = now; tick < now + SLOT_COUNT; ++tick) {
+      const uint64_t tickEndMs = (tick + 1) * TICK_MS;
+      bool isDue = false;
+      for (auto &entry : _slots[tick % SLOT_COUNT]) {
+         if (entry.deadlineMs < tickEndMs) {
+            nextMs = isDue ? std::min(nextMs, entry.deadlineMs) : entry.deadlineMs;
+            isDue = true;
+         }
+      }
+      if (isDue)
+         break;
+   }
+
+   const int64_t delayMs = std::max<int64_t>(0, int64_t(nextMs) - int64_t(nowMs));
+   if (_wakeup.isActive() && _wakeup.remainingTime() <= delayMs)
+      return;
+   _wakeup.start(delayMs);
+}
+
+void TimerWheel::fireDueTimers() {
+   const uint64_t nowMs = currentMs();
+   const uint64_t now = nowMs / TICK_MS;
+
+   // the timers due up to COALESCE_MS from now fire together, a little early
+   const uint64_t dueMs = nowMs + COALESCE_MS;
+   const uint64_t dueTick = dueMs / TICK_MS;
+
+   // the slots of the ticks since the last wakeup, all of them after a long stall
+   const uint64_t firstTick =
+      std::max(_lastTick, dueTick >= SLOT_COUNT ? dueTick - SLOT_COUNT + 1 : 0);
+   _dueTimers.clear();
+   for (uint64_t tick = firstTick; tick <= dueTick; ++tick) {
+      auto &slot = _slots[tick % SLOT_COUNT];
+      for (size_t i = 0; i < slot.size();) {
+         if (slot[i].deadlineMs <= dueMs) {
+            _dueTimers.push_back(slot[i].timerId);
+            slot[i] = slot.back();
+            slot.pop_back();
+         } else
+            ++i;
+      }
+   }
+   _lastTick = now;
+
+   if (!_dueTimers.empty())
+      ++_stats.wakeups;
+
+   for (auto timerId : _dueTimers) {
+      // an earlier callback may have unregistered it
+      auto it = _timers.find(timerId);
+      if (it == _timers.end())
+         continue;
+
+      // Rescheduled before the callback, which may unregister the timer. The next deadline
+      // follows the previous one, not the wakeup, so that firing early or late doesn't drift.
+      // The missed periods are skipped rather than fired in a burst.
+      auto &timer = it->second;
+      timer.deadlineMs += timer.periodMs;
+      if (timer.deadlineMs <= nowMs)
+         timer.deadlineMs += ((nowMs - timer.deadlineMs) / timer.periodMs + 1) * timer.periodMs;
+      insert(timerId, timer.deadlineMs);
+
+      const int64_t startNs = _clock.nsecsElapsed();
+      _callback(timerId);
+      const int64_t durationNs = _clock.nsecsElapsed() - startNs;
+
+      ++_stats.callbacks;
+      _stats.totalNs += durationNs;
+      _stats.maxNs = std::max(_stats.maxNs, durationNs);
+   }
+
+   arm();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+#include <clap/clap.h>
+
+// The plugin's timers, from clap_host_timer_support, on a hashed timer wheel.
+//
+// Each timer used to have its own QTimer, so a plugin with dozens of timers woke the main thread
+// dozens of times per period. The deadlines are now hashed by TICK_MS into SLOT_COUNT slots, and a
+// single precise timer is armed for the earliest one: the timers due within COALESCE_MS of a
+// wakeup fire with it, and the wakeups scale with the distinct deadlines. The periods and the
+// deadlines stay exact, only the slots are quantized, so a timer fires at its own rate on average.
+//
+// The duration of the callbacks is recorded and summarized by clear().
+class TimerWheel : public QObject {
+   Q_OBJECT
+
+public:
+   static constexpr uint32_t TICK_MS = 4;
+   static constexpr uint32_t SLOT_COUNT = 256;
+   static constexpr uint32_t COALESCE_MS = TICK_MS / 2;
+
+   using Callback = std::function<void(clap_id timerId)>;
+
+   explicit TimerWheel(Callback callback, QObject *parent = nullptr);
+
+   void add(clap_id timerId, uint32_t periodMs);
+   bool remove(clap_id timerId);
+   void clear();
+
+private:
+   struct Timer {
+      uint64_t periodMs;
+      uint64_t deadlineMs;
+   };
+
+   struct SlotEntry {
+      clap_id timerId;
+      uint64_t deadlineMs;
+   };
+
+   struct Stats {
+      uint64_t wakeups = 0;
+      uint64_t callbacks = 0;
+      int64_t totalNs = 0;
+      int64_t maxNs = 0;
+   };
+
+   uint64_t currentMs() const;
+   std::vector<SlotEntry> &slotOf(uint64_t deadlineMs);
+   void insert(clap_id timerId, uint64_t deadlineMs);
+   void erase(clap_id timerId, uint64_t deadlineMs);
+   void arm();
+   void fireDueTimers();
+
+   Callback _callback;
+
+   QElapsedTimer _clock;
+   QTimer _wakeup;
+
+   std::unordered_map<clap_id, Timer> _timers;
+   std::array<std::vector<SlotEntry>, SLOT_COUNT> _slots;
+   uint64_t _lastTick = 0;
+
+   // reused by fireDueTimers()
+   std::vector<clap_id> _dueTimers;
+
+   Stats _stats;
+};
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "tracer.hh"
+
+// The buffer claimed by this thread, kept after it exits so that its spans stay its own.
+static thread_local void *g_buffer = nullptr;
+
+Tracer::Buffer *Tracer::_buffers = nullptr;
+uint32_t Tracer::_bufferCount = 0;
+std::atomic<uint64_t> Tracer::_noBuffer = {0};
+int64_t Tracer::_originNs = 0;
+
+int64_t Tracer::nowNs() noexcept {
+   // steady_clock doesn't enter the kernel on the platforms we care about
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Tracer::start(uint32_t threadCount) {
+   if (_buffers)
+      return;
+
+   _bufferCount = FIRST_SHARED_BUFFER + threadCount + SPARE_BUFFERS;
+   _buffers = new Buffer[_bufferCount];
+   _buffers[MAIN_THREAD_BUFFER].isClaimed = true;
+   _buffers[MAIN_THREAD_BUFFER].threadName = "main thread";
+   _buffers[AUDIO_THREAD_BUFFER].isClaimed = true;
+   _buffers[AUDIO_THREAD_BUFFER].threadName = "audio thread";
+   g_buffer = &_buffers[MAIN_THREAD_BUFFER];
+
+   _originNs = nowNs();
+   _isEnabled.store(true, std::memory_order_release);
+}
+
+Tracer::Buffer *Tracer::claimBuffer() noexcept {
+   if (g_buffer)
+      return static_cast<Buffer *>(g_buffer);
+
+   for (uint32_t i = FIRST_SHARED_BUFFER; i < _bufferCount; ++i) {
+      auto &buffer = _buffers[i];
+      bool expected = false;
+      if (buffer.isClaimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+         g_buffer = &buffer;
+         return &buffer;
+      }
+   }
+   return nullptr;
+}
+
+void Tracer::setThreadName(const char *name) noexcept {
+   if (!isEnabled())
+      return;
+
+   if (auto buffer = claimBuffer())
+      buffer->threadName.store(name, std::memory_order_relaxed);
+}
+
+void Tracer::setAudioThread() noexcept {
+   if (isEnabled())
+      g_buffer = &_buffers[AUDIO_THREAD_BUFFER];
+}
+
+void Tracer::record(const char *name, int64_t startNs, int64_t endNs, int64_t arg) noexcept {
+   // the tracer was enabled when the span began: the buffers exist, even if it was stopped since
+   auto buffer = claimBuffer();
+   if (!buffer) [[unlikely]] {
+      _noBuffer.fetch_add(1, std::memory_order_relaxed);
+      return;
+   }
+
+   const uint64_t written = buffer->written.load(std::memory_order_relaxed);
+   buffer->spans[written % BUFFER_SIZE] = {name, startNs, endNs - startNs, arg};
+   buffer->written.store(written + 1, std::memory_order_release);
+}
+
+bool Tracer::writeChromeTrace(const std::string &path) {
+   if (!_buffers)
+      return false;
+
+   _isEnabled.store(false, std::memory_order_release);
+
+   FILE *file = std::fopen(path.c_str(), "w");
+   if (!file)
+      return false;
+
+   // the times are in microseconds, from start()
+   auto us = [](int64_t ns) { return double(ns) / 1000.; };
+
+   std::fprintf(file, "{\"traceEvents\":[\n");
+   std::fprintf(file,
+                "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+                "\"args\":{\"name\":\"clap-host\"}}");
+
+   uint64_t overwritten = 0;
+   for (uint32_t i = 0; i < _bufferCount; ++i) {
+      auto &buffer = _buffers[i];
+      const uint64_t written = buffer.written.load(std::memory_order_acquire);
+      if (written == 0)
+         continue;
+
+      const uint32_t tid = i + 1;
+      const char *threadName = buffer.threadName.load(std::memory_order_relaxed);
+      std::fprintf(file,
+                   ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                   "\"args\":{\"name\":\"%s\"}}",
+                   tid,
+                   threadName ? threadName : "unnamed thread");
+
+      const uint64_t count = std::min<uint64_t>(written, BUFFER_SIZE);
+      overwritten += written - count;
+      for (uint64_t j = written - count; j < written; ++j) {
+         auto &span = buffer.spans[j % BUFFER_SIZE];
+         std::fprintf(file,
+                      ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                      "\"ts\":%.3f,\"dur\":%.3f",
+                      span.name,
+                      tid,
+                      us(span.startNs - _originNs),
+                      us(span.durationNs));
+         if (span.arg != NO_ARG)
+            std::fprintf(file, ",\"args\":{\"id\":%lld}", (long long)span.arg);
+         std::fprintf(file, "}");
+      }
+   }
+
+   std::fprintf(file,
+                "\n],\n\"displayTimeUnit\":\"ns\",\n"
+                "\"otherData\":{\"overwrittenSpans\":%llu,\"spansWithoutBuffer\":%llu}}\n",
+                (unsigned long long)overwritten,
+                (unsigned long long)_noBuffer.load(std::memory_order_relaxed));
+
+   return std::fclose(file) == 0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Records timed spans of the engine and plugin activity, and exports them as a Chrome Trace JSON
+// file, which chrome://tracing and the Perfetto UI can open.
+//
+// It is off unless start() is called: a disabled TraceScope costs an atomic load and a branch.
+// Each thread writes its spans into its own buffer, without locking nor allocating. A buffer keeps
+// the last BUFFER_SIZE spans of its thread, so the end of a long session is kept rather than its
+// start.
+//
+// The main and the audio threads have a buffer of their own: the successive audio threads, one
+// per audio stream, continue the same one. The other threads claim one of the remaining buffers
+// the first time they record a span, and never give it back, so that the spans of an exited
+// thread aren't shown under the name of another one: the spans of the threads which find no
+// buffer left are counted, not recorded.
+class Tracer {
+public:
+   static constexpr uint32_t BUFFER_SIZE = 1 << 15;
+
+   // the buffers for the threads which aren't in the count given to start()
+   static constexpr uint32_t SPARE_BUFFERS = 4;
+
+   static constexpr int64_t NO_ARG = -1;
+
+   struct Span {
+      const char *name; // a string literal
+      int64_t startNs;
+      int64_t durationNs;
+      int64_t arg;
+   };
+
+   // acquire: the buffers allocated by start() are visible once it returns true
+   static bool isEnabled() noexcept { return _isEnabled.load(std::memory_order_acquire); }
+
+   // main thread, allocates the buffers: about BUFFER_SIZE * sizeof(Span) bytes for each thread
+   // of threadCount, the threads other than the main and audio ones which record spans
+   static void start(uint32_t threadCount);
+
+   // main thread: stops the recording and writes the spans, the threads which recorded spans
+   // should be stopped
+   static bool writeChromeTrace(const std::string &path);
+
+   // any thread; name is a string literal
+   static void setThreadName(const char *name) noexcept;
+
+   // audio thread: records its spans into the audio thread's buffer, at most one audio thread at
+   // a time
+   static void setAudioThread() noexcept;
+   static void record(const char *name, int64_t startNs, int64_t endNs, int64_t arg) noexcept;
+
+   static int64_t nowNs() noexcept;
+
+private:
+   struct Buffer {
+      std::atomic<bool> isClaimed = {false};
+      std::atomic<const char *> threadName = {nullptr};
+
+      // the spans written so far, including the overwritten ones
+      std::atomic<uint64_t> written = {0};
+      std::array<Span, BUFFER_SIZE> spans;
+   };
+
+   enum : uint32_t {
+      MAIN_THREAD_BUFFER,
+      AUDIO_THREAD_BUFFER,
+      FIRST_SHARED_BUFFER,
+   };
+
+   static Buffer *claimBuffer() noexcept;
+
+   static inline std::atomic<bool> _isEnabled = {false};
+
+   // allocated by start() and kept until exit, as the threads may still hold a claim
+   static Buffer *_buffers;
+   static uint32_t _bufferCount;
+   static std::atomic<uint64_t> _noBuffer;
+   static int64_t _originNs;
+};
+
+// Records the span of its lifetime, when the tracer is enabled.
+class TraceScope {
+public:
+   explicit TraceScope(const char *name, int64_t arg = Tracer::NO_ARG) noexcept
+      : _name(name), _arg(arg) {
+      if (Tracer::isEnabled()) [[unlikely]]
+         _startNs = Tracer::nowNs();
+   }
+
+   ~TraceScope() {
+      if (_startNs >= 0) [[unlikely]]
+         Tracer::record(_name, _startNs, Tracer::nowNs(), _arg);
+   }
+
+   TraceScope(const TraceScope &) = delete;
+   TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+   const char *const _name;
+   const int64_t _arg;
+   int64_t _startNs = -1;
+};
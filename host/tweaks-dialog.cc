@@ -3,6 +3,7 @@
 #include <QDialogButtonBox>
 
 #include "plugin-host-settings.hh"
+#include "plugin-sandbox.hh"
 #include "settings.hh"
 #include "tweaks-dialog.hh"
 
@@ -25,6 +26,18 @@ TweaksDialog::TweaksDialog(Settings &settings, QWidget *parent)
    });
    vbox->addWidget(cookieCheckBox);
 
+   auto sandboxCheckBox = new QCheckBox(tr("Run Plugin In A Sandbox Process"), this);
+   sandboxCheckBox->setChecked(pluginHostSettings.shouldRunInSandbox());
+   sandboxCheckBox->setToolTip(
+      tr("If enabled the plugin is loaded in a separate process, so that it can't crash the host. "
+         "Parameters, GUI and state are not available in this mode. Applies to the next plugin "
+         "load."));
+   connect(sandboxCheckBox, &QCheckBox::stateChanged, [&pluginHostSettings](int state) {
+      pluginHostSettings.setShouldRunInSandbox(state);
+   });
+   sandboxCheckBox->setEnabled(PluginSandbox::isSupported());
+   vbox->addWidget(sandboxCheckBox);
+
    auto buttons = new QDialogButtonBox(QDialogButtonBox::Ok, this);
    buttons->show();
    vbox->addWidget(buttons);
@@ -0,0 +1,58 @@
+#include <array>
+#include <cstring>
+
+#include "test-plugin.hh"
+#include "test-plugins.hh"
+
+static const std::array<const TestPluginFactoryEntry *, 5> s_plugins = {
+   &passthroughPlugin,
+   &synthPlugin,
+   &threadPoolPlugin,
+   &paramStormPlugin,
+   &latencyPlugin,
+};
+
+static uint32_t factoryGetPluginCount(const clap_plugin_factory *factory) noexcept {
+   return s_plugins.size();
+}
+
+static const clap_plugin_descriptor *
+factoryGetPluginDescriptor(const clap_plugin_factory *factory, uint32_t index) noexcept {
+   return index < s_plugins.size() ? s_plugins[index]->descriptor : nullptr;
+}
+
+static const clap_plugin *factoryCreatePlugin(const clap_plugin_factory *factory,
+                                              const clap_host *host,
+                                              const char *pluginId) noexcept {
+   if (!clap_version_is_compatible(host->clap_version))
+      return nullptr;
+
+   for (auto plugin : s_plugins) {
+      if (!std::strcmp(plugin->descriptor->id, pluginId))
+         return plugin->create(host)->clapPlugin();
+   }
+   return nullptr;
+}
+
+static const clap_plugin_factory s_pluginFactory = {
+   &factoryGetPluginCount,
+   &factoryGetPluginDescriptor,
+   &factoryCreatePlugin,
+};
+
+static bool entryInit(const char *pluginPath) noexcept { return true; }
+
+static void entryDeinit() noexcept {}
+
+static const void *entryGetFactory(const char *factoryId) noexcept {
+   if (!std::strcmp(factoryId, CLAP_PLUGIN_FACTORY_ID))
+      return &s_pluginFactory;
+   return nullptr;
+}
+
+extern "C" CLAP_EXPORT const clap_plugin_entry clap_entry = {
+   CLAP_VERSION_INIT,
+   &entryInit,
+   &entryDeinit,
+   &entryGetFactory,
+};
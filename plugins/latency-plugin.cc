@@ -0,0 +1,124 @@
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "test-plugin.hh"
+#include "test-plugins.hh"
+
+static const char *const s_latencyFeatures[] = {
+   CLAP_PLUGIN_FEATURE_AUDIO_EFFECT,
+   CLAP_PLUGIN_FEATURE_DELAY,
+   nullptr,
+};
+
+static const clap_plugin_descriptor s_latencyDescriptor = {
+   CLAP_VERSION_INIT,
+   "org.free-audio.clap-host.test.latency",
+   "Test: Latency",
+   "clap-host",
+   "https://github.com/free-audio/clap-host",
+   nullptr,
+   nullptr,
+   "1.0.0",
+   "Delays its input by a configurable number of samples, and reports it as its latency",
+   s_latencyFeatures,
+};
+
+class LatencyPlugin final : public TestPlugin {
+public:
+   static constexpr uint32_t CHANNEL_COUNT = 2;
+
+   enum ParamIds : clap_id { Latency };
+
+   explicit LatencyPlugin(const clap_host *host)
+      : TestPlugin(&s_latencyDescriptor,
+                   host,
+                   AudioIn | AudioOut,
+                   {
+                      {Latency, "Latency", 0, 48000, 256, true},
+                   }) {}
+
+protected:
+   bool activate(double sampleRate, uint32_t maxFrames) override {
+      // the latency can only change while the plugin is inactive
+      const uint32_t latency = paramValue(Latency);
+      if (latency != _latency) {
+         _latency = latency;
+         auto hostLatency =
+            static_cast<const clap_host_latency *>(hostExtension(CLAP_EXT_LATENCY));
+         if (hostLatency)
+            hostLatency->changed(_host);
+      }
+
+      for (auto &delayLine : _delayLines)
+         delayLine.assign(_latency, 0.f);
+      _position = 0;
+      _isActive = true;
+      return true;
+   }
+
+   void deactivate() override { _isActive = false; }
+
+   const void *extension(const char *id) override {
+      if (!std::strcmp(id, CLAP_EXT_LATENCY))
+         return &_pluginLatency;
+      return nullptr;
+   }
+
+   void paramChanged(uint32_t index, double value) override {
+      if (_isActive && uint32_t(value) != _latency)
+         _host->request_restart(_host);
+   }
+
+   clap_process_status process(const clap_process *process) override {
+      handleInputEvents(process->in_events);
+
+      if (_latency == 0) {
+         copyInputToOutput(process);
+         return CLAP_PROCESS_CONTINUE;
+      }
+
+      auto &in = process->audio_inputs[0];
+      auto &out = process->audio_outputs[0];
+      uint32_t position = _position;
+      for (uint32_t c = 0; c < out.channel_count; ++c) {
+         auto &delayLine = _delayLines[c % CHANNEL_COUNT];
+         const float *src = c < in.channel_count ? in.data32[c] : nullptr;
+         float *dst = out.data32[c];
+
+         // the input and output buffers may be the same
+         position = _position;
+         for (uint32_t i = 0; i < process->frames_count; ++i) {
+            const float x = src ? src[i] : 0.f;
+            dst[i] = delayLine[position];
+            delayLine[position] = x;
+            if (++position == _latency)
+               position = 0;
+         }
+      }
+      _position = position;
+      return CLAP_PROCESS_CONTINUE;
+   }
+
+private:
+   static uint32_t clapGetLatency(const clap_plugin *plugin) noexcept {
+      auto base = static_cast<TestPlugin *>(plugin->plugin_data);
+      return static_cast<LatencyPlugin *>(base)->_latency;
+   }
+
+   static const clap_plugin_latency _pluginLatency;
+
+   // main thread, set on activation
+   uint32_t _latency = 0;
+   std::atomic<bool> _isActive = {false};
+
+   std::vector<float> _delayLines[CHANNEL_COUNT];
+   uint32_t _position = 0;
+};
+
+const clap_plugin_latency LatencyPlugin::_pluginLatency = {&LatencyPlugin::clapGetLatency};
+
+const TestPluginFactoryEntry latencyPlugin = {
+   &s_latencyDescriptor,
+   [](const clap_host *host) -> TestPlugin * { return new LatencyPlugin(host); },
+};
@@ -0,0 +1,114 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "test-plugin.hh"
+#include "test-plugins.hh"
+
+static const char *const s_paramStormFeatures[] = {
+   CLAP_PLUGIN_FEATURE_AUDIO_EFFECT,
+   CLAP_PLUGIN_FEATURE_UTILITY,
+   nullptr,
+};
+
+static const clap_plugin_descriptor s_paramStormDescriptor = {
+   CLAP_VERSION_INIT,
+   "org.free-audio.clap-host.test.param-storm",
+   "Test: Param Storm",
+   "clap-host",
+   "https://github.com/free-audio/clap-host",
+   nullptr,
+   nullptr,
+   "1.0.0",
+   "Outputs a configurable number of parameter changes per block",
+   s_paramStormFeatures,
+};
+
+class ParamStormPlugin final : public TestPlugin {
+public:
+   static constexpr uint32_t OUTPUT_PARAM_COUNT = 64;
+
+   enum ParamIds : clap_id { EventsPerBlock, Gestures, FirstOutput };
+
+   explicit ParamStormPlugin(const clap_host *host)
+      : TestPlugin(&s_paramStormDescriptor, host, AudioIn | AudioOut, params()) {}
+
+protected:
+   clap_process_status process(const clap_process *process) override {
+      handleInputEvents(process->in_events);
+      copyInputToOutput(process);
+
+      const uint32_t events = paramValue(EventsPerBlock);
+      const bool hasGestures = paramValue(Gestures) > 0.5;
+      for (uint32_t e = 0; e < events; ++e) {
+         const uint32_t time = uint64_t(e) * process->frames_count / events;
+         const clap_id paramId = FirstOutput + _nextOutput;
+         _nextOutput = (_nextOutput + 1) % OUTPUT_PARAM_COUNT;
+
+         // a linear congruential generator: the same values at each run
+         _random = _random * 1664525u + 1013904223u;
+         const double value = (_random >> 8) / double(1 << 24);
+
+         // the host may drop the events past its queue's capacity, which is part of the test
+         if (hasGestures)
+            pushGesture(process->out_events, CLAP_EVENT_PARAM_GESTURE_BEGIN, time, paramId);
+         pushValue(process->out_events, time, paramId, value);
+         if (hasGestures)
+            pushGesture(process->out_events, CLAP_EVENT_PARAM_GESTURE_END, time, paramId);
+
+         setParamValue(paramId, value);
+      }
+      return CLAP_PROCESS_CONTINUE;
+   }
+
+private:
+   static std::vector<Param> params() {
+      std::vector<Param> params = {
+         {EventsPerBlock, "Events per block", 0, 4096, 64, true},
+         {Gestures, "Gestures", 0, 1, 0, true},
+      };
+      for (uint32_t i = 0; i < OUTPUT_PARAM_COUNT; ++i)
+         params.push_back({FirstOutput + i, "Output " + std::to_string(i + 1), 0, 1, 0, false});
+      return params;
+   }
+
+   static void
+   pushValue(const clap_output_events *out, uint32_t time, clap_id paramId, double value) noexcept {
+      clap_event_param_value ev;
+      ev.header.size = sizeof(ev);
+      ev.header.time = time;
+      ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+      ev.header.type = CLAP_EVENT_PARAM_VALUE;
+      ev.header.flags = 0;
+      ev.param_id = paramId;
+      ev.cookie = nullptr;
+      ev.note_id = -1;
+      ev.port_index = -1;
+      ev.channel = -1;
+      ev.key = -1;
+      ev.value = value;
+      out->try_push(out, &ev.header);
+   }
+
+   static void pushGesture(const clap_output_events *out,
+                           uint16_t type,
+                           uint32_t time,
+                           clap_id paramId) noexcept {
+      clap_event_param_gesture ev;
+      ev.header.size = sizeof(ev);
+      ev.header.time = time;
+      ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+      ev.header.type = type;
+      ev.header.flags = 0;
+      ev.param_id = paramId;
+      out->try_push(out, &ev.header);
+   }
+
+   uint32_t _nextOutput = 0;
+   uint32_t _random = 1;
+};
+
+const TestPluginFactoryEntry paramStormPlugin = {
+   &s_paramStormDescriptor,
+   [](const clap_host *host) -> TestPlugin * { return new ParamStormPlugin(host); },
+};
@@ -0,0 +1,39 @@
+#include "test-plugin.hh"
+#include "test-plugins.hh"
+
+static const char *const s_passthroughFeatures[] = {
+   CLAP_PLUGIN_FEATURE_AUDIO_EFFECT,
+   CLAP_PLUGIN_FEATURE_UTILITY,
+   nullptr,
+};
+
+static const clap_plugin_descriptor s_passthroughDescriptor = {
+   CLAP_VERSION_INIT,
+   "org.free-audio.clap-host.test.passthrough",
+   "Test: Passthrough",
+   "clap-host",
+   "https://github.com/free-audio/clap-host",
+   nullptr,
+   nullptr,
+   "1.0.0",
+   "Copies its input to its output, to measure the host's overhead alone",
+   s_passthroughFeatures,
+};
+
+class PassthroughPlugin final : public TestPlugin {
+public:
+   explicit PassthroughPlugin(const clap_host *host)
+      : TestPlugin(&s_passthroughDescriptor, host, AudioIn | AudioOut, {}) {}
+
+protected:
+   clap_process_status process(const clap_process *process) override {
+      handleInputEvents(process->in_events);
+      copyInputToOutput(process);
+      return CLAP_PROCESS_CONTINUE_IF_NOT_QUIET;
+   }
+};
+
+const TestPluginFactoryEntry passthroughPlugin = {
+   &s_passthroughDescriptor,
+   [](const clap_host *host) -> TestPlugin * { return new PassthroughPlugin(host); },
+};
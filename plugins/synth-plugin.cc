@@ -0,0 +1,88 @@
+#include <array>
+#include <cmath>
+
+#include "test-plugin.hh"
+#include "test-plugins.hh"
+
+static const char *const s_synthFeatures[] = {
+   CLAP_PLUGIN_FEATURE_INSTRUMENT,
+   CLAP_PLUGIN_FEATURE_SYNTHESIZER,
+   nullptr,
+};
+
+static const clap_plugin_descriptor s_synthDescriptor = {
+   CLAP_VERSION_INIT,
+   "org.free-audio.clap-host.test.synth",
+   "Test: Synth",
+   "clap-host",
+   "https://github.com/free-audio/clap-host",
+   nullptr,
+   nullptr,
+   "1.0.0",
+   "Sums N always-playing voices, with a configurable cost per voice and per sample",
+   s_synthFeatures,
+};
+
+class SynthPlugin final : public TestPlugin {
+public:
+   static constexpr uint32_t MAX_VOICES = 256;
+   static constexpr double TWO_PI = 6.283185307179586;
+
+   enum ParamIds : clap_id { Voices, Cost };
+
+   explicit SynthPlugin(const clap_host *host)
+      : TestPlugin(&s_synthDescriptor,
+                   host,
+                   AudioOut | NoteIn,
+                   {
+                      {Voices, "Voices", 1, MAX_VOICES, 8, true},
+                      {Cost, "Operations per sample", 1, 1000, 1, true},
+                   }) {}
+
+protected:
+   bool activate(double sampleRate, uint32_t maxFrames) override {
+      // the voices are detuned from each other, and start in phase: the output is deterministic
+      for (uint32_t i = 0; i < MAX_VOICES; ++i) {
+         _phases[i] = 0;
+         _phaseIncrements[i] = TWO_PI * 110 * (1 + 0.01 * i) / sampleRate;
+      }
+      return true;
+   }
+
+   clap_process_status process(const clap_process *process) override {
+      handleInputEvents(process->in_events);
+
+      const uint32_t voices = paramValue(Voices);
+      const uint32_t cost = paramValue(Cost);
+      const float gain = 0.5f / voices;
+
+      auto &out = process->audio_outputs[0];
+      for (uint32_t i = 0; i < process->frames_count; ++i) {
+         double sum = 0;
+         for (uint32_t v = 0; v < voices; ++v) {
+            // cost - 1 extra evaluations, which the output depends on so they aren't optimized out
+            double sample = std::sin(_phases[v]);
+            for (uint32_t k = 1; k < cost; ++k)
+               sample = 0.5 * (sample + std::sin(_phases[v] + k * 1e-9));
+            sum += sample;
+
+            _phases[v] += _phaseIncrements[v];
+            if (_phases[v] >= TWO_PI)
+               _phases[v] -= TWO_PI;
+         }
+
+         for (uint32_t c = 0; c < out.channel_count; ++c)
+            out.data32[c][i] = gain * sum;
+      }
+      return CLAP_PROCESS_CONTINUE;
+   }
+
+private:
+   std::array<double, MAX_VOICES> _phases = {};
+   std::array<double, MAX_VOICES> _phaseIncrements = {};
+};
+
+const TestPluginFactoryEntry synthPlugin = {
+   &s_synthDescriptor,
+   [](const clap_host *host) -> TestPlugin * { return new SynthPlugin(host); },
+};
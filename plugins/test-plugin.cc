@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "test-plugin.hh"
+
+const clap_plugin_audio_ports TestPlugin::_audioPorts = {
+   &TestPlugin::audioPortsCount,
+   &TestPlugin::audioPortsGet,
+};
+
+const clap_plugin_note_ports TestPlugin::_notePorts = {
+   &TestPlugin::notePortsCount,
+   &TestPlugin::notePortsGet,
+};
+
+const clap_plugin_params TestPlugin::_pluginParams = {
+   &TestPlugin::paramsCount,
+   &TestPlugin::paramsGetInfo,
+   &TestPlugin::paramsGetValue,
+   &TestPlugin::paramsValueToText,
+   &TestPlugin::paramsTextToValue,
+   &TestPlugin::paramsFlush,
+};
+
+TestPlugin::TestPlugin(const clap_plugin_descriptor *descriptor,
+                       const clap_host *host,
+                       uint32_t ports,
+                       std::vector<Param> params)
+   : _host(host), _ports(ports), _params(std::move(params)),
+     _values(new std::atomic<double>[_params.size()]) {
+   for (uint32_t i = 0; i < _params.size(); ++i)
+      _values[i].store(_params[i].defaultValue, std::memory_order_relaxed);
+
+   _plugin.desc = descriptor;
+   _plugin.plugin_data = this;
+   _plugin.init = &TestPlugin::clapInit;
+   _plugin.destroy = &TestPlugin::clapDestroy;
+   _plugin.activate = &TestPlugin::clapActivate;
+   _plugin.deactivate = &TestPlugin::clapDeactivate;
+   _plugin.start_processing = &TestPlugin::clapStartProcessing;
+   _plugin.stop_processing = &TestPlugin::clapStopProcessing;
+   _plugin.reset = &TestPlugin::clapReset;
+   _plugin.process = &TestPlugin::clapProcess;
+   _plugin.get_extension = &TestPlugin::clapGetExtension;
+   _plugin.on_main_thread = &TestPlugin::clapOnMainThread;
+}
+
+void TestPlugin::setParamValue(uint32_t index, double value) noexcept {
+   _values[index].store(value, std::memory_order_relaxed);
+}
+
+int32_t TestPlugin::paramIndex(clap_id paramId) const noexcept {
+   // the ids are the indexes, checked anyway in case a plugin doesn't follow that
+   if (paramId < _params.size() && _params[paramId].id == paramId)
+      return paramId;
+
+   for (uint32_t i = 0; i < _params.size(); ++i) {
+      if (_params[i].id == paramId)
+         return i;
+   }
+   return -1;
+}
+
+void TestPlugin::handleInputEvents(const clap_input_events *in) noexcept {
+   const uint32_t count = in->size(in);
+   for (uint32_t i = 0; i < count; ++i) {
+      auto header = in->get(in, i);
+      if (header->space_id != CLAP_CORE_EVENT_SPACE_ID || header->type != CLAP_EVENT_PARAM_VALUE)
+         continue;
+
+      auto ev = reinterpret_cast<const clap_event_param_value *>(header);
+      const int32_t index = paramIndex(ev->param_id);
+      if (index < 0)
+         continue;
+
+      auto &param = _params[index];
+      const double value = std::clamp(ev->value, param.minValue, param.maxValue);
+      setParamValue(index, value);
+      paramChanged(index, value);
+   }
+}
+
+void TestPlugin::copyInputToOutput(const clap_process *process) noexcept {
+   if (process->audio_outputs_count == 0)
+      return;
+
+   auto &out = process->audio_outputs[0];
+   for (uint32_t c = 0; c < out.channel_count; ++c) {
+      float *dst = out.data32[c];
+      if (process->audio_inputs_count > 0 && c < process->audio_inputs[0].channel_count) {
+         const float *src = process->audio_inputs[0].data32[c];
+         if (src != dst)
+            std::memcpy(dst, src, process->frames_count * sizeof(float));
+      } else
+         std::fill_n(dst, process->frames_count, 0.f);
+   }
+}
+
+const void *TestPlugin::hostExtension(const char *id) const {
+   return _host->get_extension(_host, id);
+}
+
+/////////////////
+// clap_plugin //
+/////////////////
+
+bool TestPlugin::clapInit(const clap_plugin *plugin) noexcept { return true; }
+
+void TestPlugin::clapDestroy(const clap_plugin *plugin) noexcept { delete &self(plugin); }
+
+bool TestPlugin::clapActivate(const clap_plugin *plugin,
+                              double sampleRate,
+                              uint32_t minFrames,
+                              uint32_t maxFrames) noexcept {
+   auto &p = self(plugin);
+   p._sampleRate = sampleRate;
+   p._maxFrames = maxFrames;
+   return p.activate(sampleRate, maxFrames);
+}
+
+void TestPlugin::clapDeactivate(const clap_plugin *plugin) noexcept { self(plugin).deactivate(); }
+
+bool TestPlugin::clapStartProcessing(const clap_plugin *plugin) noexcept { return true; }
+
+void TestPlugin::clapStopProcessing(const clap_plugin *plugin) noexcept {}
+
+void TestPlugin::clapReset(const clap_plugin *plugin) noexcept {}
+
+clap_process_status TestPlugin::clapProcess(const clap_plugin *plugin,
+                                            const clap_process *process) noexcept {
+   return self(plugin).process(process);
+}
+
+const void *TestPlugin::clapGetExtension(const clap_plugin *plugin, const char *id) noexcept {
+   auto &p = self(plugin);
+   if (!std::strcmp(id, CLAP_EXT_AUDIO_PORTS))
+      return &_audioPorts;
+   if (!std::strcmp(id, CLAP_EXT_NOTE_PORTS) && (p._ports & NoteIn))
+      return &_notePorts;
+   if (!std::strcmp(id, CLAP_EXT_PARAMS))
+      return &_pluginParams;
+   return p.extension(id);
+}
+
+void TestPlugin::clapOnMainThread(const clap_plugin *plugin) noexcept {
+   self(plugin).onMainThread();
+}
+
+/////////////////
+// Audio ports //
+/////////////////
+
+uint32_t TestPlugin::audioPortsCount(const clap_plugin *plugin, bool isInput) noexcept {
+   return self(plugin)._ports & (isInput ? AudioIn : AudioOut) ? 1 : 0;
+}
+
+bool TestPlugin::audioPortsGet(const clap_plugin *plugin,
+                               uint32_t index,
+                               bool isInput,
+                               clap_audio_port_info *info) noexcept {
+   auto &p = self(plugin);
+   if (index >= audioPortsCount(plugin, isInput))
+      return false;
+
+   info->id = isInput ? 0 : 1;
+   std::snprintf(info->name, sizeof(info->name), "%s", isInput ? "Input" : "Output");
+   info->flags = CLAP_AUDIO_PORT_IS_MAIN;
+   info->channel_count = 2;
+   info->port_type = CLAP_PORT_STEREO;
+   info->in_place_pair = (p._ports & AudioIn) && (p._ports & AudioOut) ? 1 - info->id
+                                                                       : CLAP_INVALID_ID;
+   return true;
+}
+
+////////////////
+// Note ports //
+////////////////
+
+uint32_t TestPlugin::notePortsCount(const clap_plugin *plugin, bool isInput) noexcept {
+   return isInput && (self(plugin)._ports & NoteIn) ? 1 : 0;
+}
+
+bool TestPlugin::notePortsGet(const clap_plugin *plugin,
+                              uint32_t index,
+                              bool isInput,
+                              clap_note_port_info *info) noexcept {
+   if (index >= notePortsCount(plugin, isInput))
+      return false;
+
+   info->id = 0;
+   info->supported_dialects = CLAP_NOTE_DIALECT_CLAP | CLAP_NOTE_DIALECT_MIDI;
+   info->preferred_dialect = CLAP_NOTE_DIALECT_CLAP;
+   std::snprintf(info->name, sizeof(info->name), "%s", "Notes");
+   return true;
+}
+
+////////////
+// Params //
+////////////
+
+uint32_t TestPlugin::paramsCount(const clap_plugin *plugin) noexcept {
+   return self(plugin)._params.size();
+}
+
+bool TestPlugin::paramsGetInfo(const clap_plugin *plugin,
+                               uint32_t index,
+                               clap_param_info *info) noexcept {
+   auto &p = self(plugin);
+   if (index >= p._params.size())
+      return false;
+
+   auto &param = p._params[index];
+   info->id = param.id;
+   info->flags = CLAP_PARAM_IS_AUTOMATABLE | (param.isStepped ? CLAP_PARAM_IS_STEPPED : 0);
+   info->cookie = nullptr;
+   std::snprintf(info->name, sizeof(info->name), "%s", param.name.c_str());
+   info->module[0] = '\0';
+   info->min_value = param.minValue;
+   info->max_value = param.maxValue;
+   info->default_value = param.defaultValue;
+   return true;
+}
+
+bool TestPlugin::paramsGetValue(const clap_plugin *plugin,
+                                clap_id paramId,
+                                double *value) noexcept {
+   auto &p = self(plugin);
+   const int32_t index = p.paramIndex(paramId);
+   if (index < 0)
+      return false;
+
+   *value = p.paramValue(index);
+   return true;
+}
+
+bool TestPlugin::paramsValueToText(const clap_plugin *plugin,
+                                   clap_id paramId,
+                                   double value,
+                                   char *display,
+                                   uint32_t size) noexcept {
+   auto &p = self(plugin);
+   const int32_t index = p.paramIndex(paramId);
+   if (index < 0)
+      return false;
+
+   if (p._params[index].isStepped)
+      std::snprintf(display, size, "%lld", (long long)value);
+   else
+      std::snprintf(display, size, "%.3f", value);
+   return true;
+}
+
+bool TestPlugin::paramsTextToValue(const clap_plugin *plugin,
+                                   clap_id paramId,
+                                   const char *display,
+                                   double *value) noexcept {
+   auto &p = self(plugin);
+   if (p.paramIndex(paramId) < 0)
+      return false;
+
+   char *end = nullptr;
+   *value = std::strtod(display, &end);
+   return end != display;
+}
+
+void TestPlugin::paramsFlush(const clap_plugin *plugin,
+                             const clap_input_events *in,
+                             const clap_output_events *out) noexcept {
+   self(plugin).handleInputEvents(in);
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <clap/clap.h>
+
+// Base class of the test plugins, written against the plain C API so that the host's overhead
+// can be measured without the one of a plugin framework.
+//
+// It provides the clap_plugin vtable, the audio and note ports, and the params extension: the
+// values are set from the process and flush calls, and read from any thread.
+class TestPlugin {
+public:
+   enum Ports : uint32_t {
+      AudioIn = 1 << 0,
+      AudioOut = 1 << 1,
+      NoteIn = 1 << 2,
+   };
+
+   struct Param {
+      clap_id id;
+      std::string name;
+      double minValue;
+      double maxValue;
+      double defaultValue;
+      bool isStepped;
+   };
+
+   TestPlugin(const clap_plugin_descriptor *descriptor,
+              const clap_host *host,
+              uint32_t ports,
+              std::vector<Param> params);
+   virtual ~TestPlugin() = default;
+
+   TestPlugin(const TestPlugin &) = delete;
+   TestPlugin &operator=(const TestPlugin &) = delete;
+
+   const clap_plugin *clapPlugin() const noexcept { return &_plugin; }
+
+protected:
+   // main thread
+   virtual bool activate(double sampleRate, uint32_t maxFrames) { return true; }
+   virtual void deactivate() {}
+   virtual const void *extension(const char *id) { return nullptr; }
+   virtual void onMainThread() {}
+
+   // audio thread
+   virtual clap_process_status process(const clap_process *process) = 0;
+
+   // audio thread, or main thread if the plugin isn't active
+   virtual void paramChanged(uint32_t index, double value) {}
+
+   uint32_t paramCount() const noexcept { return _params.size(); }
+   double paramValue(uint32_t index) const noexcept {
+      return _values[index].load(std::memory_order_relaxed);
+   }
+   void setParamValue(uint32_t index, double value) noexcept;
+
+   // applies the parameter value events
+   void handleInputEvents(const clap_input_events *in) noexcept;
+
+   // copies the first input to the first output, up to the channels they have in common
+   static void copyInputToOutput(const clap_process *process) noexcept;
+
+   const void *hostExtension(const char *id) const;
+
+   const clap_host *const _host;
+   double _sampleRate = 0;
+   uint32_t _maxFrames = 0;
+
+private:
+   int32_t paramIndex(clap_id paramId) const noexcept;
+
+   static TestPlugin &self(const clap_plugin *plugin) noexcept {
+      return *static_cast<TestPlugin *>(plugin->plugin_data);
+   }
+
+   static bool clapInit(const clap_plugin *plugin) noexcept;
+   static void clapDestroy(const clap_plugin *plugin) noexcept;
+   static bool clapActivate(const clap_plugin *plugin,
+                            double sampleRate,
+                            uint32_t minFrames,
+                            uint32_t maxFrames) noexcept;
+   static void clapDeactivate(const clap_plugin *plugin) noexcept;
+   static bool clapStartProcessing(const clap_plugin *plugin) noexcept;
+   static void clapStopProcessing(const clap_plugin *plugin) noexcept;
+   static void clapReset(const clap_plugin *plugin) noexcept;
+   static clap_process_status clapProcess(const clap_plugin *plugin,
+                                          const clap_process *process) noexcept;
+   static const void *clapGetExtension(const clap_plugin *plugin, const char *id) noexcept;
+   static void clapOnMainThread(const clap_plugin *plugin) noexcept;
+
+   // clap_plugin_audio_ports
+   static uint32_t audioPortsCount(const clap_plugin *plugin, bool isInput) noexcept;
+   static bool audioPortsGet(const clap_plugin *plugin,
+                             uint32_t index,
+                             bool isInput,
+                             clap_audio_port_info *info) noexcept;
+
+   // clap_plugin_note_ports
+   static uint32_t notePortsCount(const clap_plugin *plugin, bool isInput) noexcept;
+   static bool notePortsGet(const clap_plugin *plugin,
+                            uint32_t index,
+                            bool isInput,
+                            clap_note_port_info *info) noexcept;
+
+   // clap_plugin_params
+   static uint32_t paramsCount(const clap_plugin *plugin) noexcept;
+   static bool paramsGetInfo(const clap_plugin *plugin,
+                             uint32_t index,
+                             clap_param_info *info) noexcept;
+   static bool paramsGetValue(const clap_plugin *plugin, clap_id paramId, double *value) noexcept;
+   static bool paramsValueToText(const clap_plugin *plugin,
+                                 clap_id paramId,
+                                 double value,
+                                 char *display,
+                                 uint32_t size) noexcept;
+   static bool paramsTextToValue(const clap_plugin *plugin,
+                                 clap_id paramId,
+                                 const char *display,
+                                 double *value) noexcept;
+   static void paramsFlush(const clap_plugin *plugin,
+                           const clap_input_events *in,
+                           const clap_output_events *out) noexcept;
+
+   static const clap_plugin_audio_ports _audioPorts;
+   static const clap_plugin_note_ports _notePorts;
+   static const clap_plugin_params _pluginParams;
+
+   clap_plugin _plugin;
+   const uint32_t _ports;
+
+   const std::vector<Param> _params;
+   std::unique_ptr<std::atomic<double>[]> _values;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <clap/clap.h>
+
+class TestPlugin;
+
+// The plugins exposed by the factory of clap-host-test-plugins.clap, see entry.cc.
+struct TestPluginFactoryEntry {
+   const clap_plugin_descriptor *descriptor;
+   TestPlugin *(*create)(const clap_host *host);
+};
+
+// Copies its input to its output.
+extern const TestPluginFactoryEntry passthroughPlugin;
+
+// Sums N always-playing sine voices, each computed with a configurable number of operations
+// per sample.
+extern const TestPluginFactoryEntry synthPlugin;
+
+// Splits a configurable amount of work per block into tasks run on the host's thread pool.
+extern const TestPluginFactoryEntry threadPoolPlugin;
+
+// Outputs a configurable number of parameter value changes per block, optionally wrapped in
+// gestures.
+extern const TestPluginFactoryEntry paramStormPlugin;
+
+// Delays its input by a configurable number of samples, and reports it as its latency.
+extern const TestPluginFactoryEntry latencyPlugin;
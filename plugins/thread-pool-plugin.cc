@@ -0,0 +1,102 @@
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "test-plugin.hh"
+#include "test-plugins.hh"
+
+static const char *const s_threadPoolFeatures[] = {
+   CLAP_PLUGIN_FEATURE_AUDIO_EFFECT,
+   CLAP_PLUGIN_FEATURE_UTILITY,
+   nullptr,
+};
+
+static const clap_plugin_descriptor s_threadPoolDescriptor = {
+   CLAP_VERSION_INIT,
+   "org.free-audio.clap-host.test.thread-pool",
+   "Test: Thread Pool",
+   "clap-host",
+   "https://github.com/free-audio/clap-host",
+   nullptr,
+   nullptr,
+   "1.0.0",
+   "Runs a configurable number of tasks per block on the host's thread pool",
+   s_threadPoolFeatures,
+};
+
+class ThreadPoolPlugin final : public TestPlugin {
+public:
+   static constexpr uint32_t MAX_TASKS = 64;
+
+   enum ParamIds : clap_id { Tasks, Cost };
+
+   explicit ThreadPoolPlugin(const clap_host *host)
+      : TestPlugin(&s_threadPoolDescriptor,
+                   host,
+                   AudioIn | AudioOut,
+                   {
+                      {Tasks, "Tasks", 1, MAX_TASKS, 4, true},
+                      {Cost, "Operations per task and sample", 1, 1000, 1, true},
+                   }) {}
+
+protected:
+   bool activate(double sampleRate, uint32_t maxFrames) override {
+      _hostThreadPool =
+         static_cast<const clap_host_thread_pool *>(hostExtension(CLAP_EXT_THREAD_POOL));
+      return true;
+   }
+
+   const void *extension(const char *id) override {
+      if (!std::strcmp(id, CLAP_EXT_THREAD_POOL))
+         return &_pluginThreadPool;
+      return nullptr;
+   }
+
+   clap_process_status process(const clap_process *process) override {
+      handleInputEvents(process->in_events);
+
+      _frames = process->frames_count;
+      _cost = paramValue(Cost);
+
+      // without a thread pool, or if the host refuses, the tasks run on the audio thread
+      const uint32_t tasks = paramValue(Tasks);
+      if (!_hostThreadPool || !_hostThreadPool->request_exec(_host, tasks)) {
+         for (uint32_t i = 0; i < tasks; ++i)
+            exec(i);
+      }
+
+      copyInputToOutput(process);
+      return CLAP_PROCESS_CONTINUE;
+   }
+
+private:
+   void exec(uint32_t taskIndex) noexcept {
+      // the results are kept so that the work isn't optimized out
+      double sum = 0;
+      for (uint32_t i = 0; i < _frames * _cost; ++i)
+         sum += std::sin(taskIndex + i * 1e-6);
+      _taskResults[taskIndex % MAX_TASKS] = sum;
+   }
+
+   static void clapExec(const clap_plugin *plugin, uint32_t taskIndex) noexcept {
+      auto base = static_cast<TestPlugin *>(plugin->plugin_data);
+      static_cast<ThreadPoolPlugin *>(base)->exec(taskIndex);
+   }
+
+   static const clap_plugin_thread_pool _pluginThreadPool;
+
+   const clap_host_thread_pool *_hostThreadPool = nullptr;
+
+   // set by process() for the tasks
+   uint32_t _frames = 0;
+   uint32_t _cost = 0;
+
+   std::array<double, MAX_TASKS> _taskResults = {};
+};
+
+const clap_plugin_thread_pool ThreadPoolPlugin::_pluginThreadPool = {&ThreadPoolPlugin::clapExec};
+
+const TestPluginFactoryEntry threadPoolPlugin = {
+   &s_threadPoolDescriptor,
+   [](const clap_host *host) -> TestPlugin * { return new ThreadPoolPlugin(host); },
+};
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "golden.hh"
+
+static constexpr char HASHES_HEADER[] = "clap-host-render hashes 1";
+
+static std::string formatDiff(double diff) {
+   char text[32];
+   std::snprintf(text, sizeof(text), "%.3g", diff);
+   return text;
+}
+
+static bool writeHashes(const std::string &path,
+                        const RenderOutput &output,
+                        std::string &error) {
+   std::ofstream out(path, std::ios::trunc);
+   out << HASHES_HEADER << "\n"
+       << "sample-rate " << output.audio.sampleRate << "\n"
+       << "block-size " << output.blockSize << "\n"
+       << "channels " << output.audio.channels.size() << "\n"
+       << "frames " << output.audio.frameCount() << "\n";
+   for (uint64_t hash : output.blockHashes) {
+      char text[17];
+      std::snprintf(text, sizeof(text), "%016" PRIx64, hash);
+      out << text << "\n";
+   }
+
+   if (!out.flush()) {
+      error = "failed to write " + path;
+      return false;
+   }
+   return true;
+}
+
+// Returns false if the file is missing, sets error if it is invalid.
+static bool readHashes(const std::string &path,
+                       std::string &parameters,
+                       std::vector<uint64_t> &hashes,
+                       std::string &error) {
+   std::ifstream in(path);
+   if (!in)
+      return false;
+
+   std::string line;
+   if (!std::getline(in, line) || line != HASHES_HEADER) {
+      error = path + " isn't a hashes file";
+      return true;
+   }
+
+   std::ostringstream header;
+   for (int i = 0; i < 4 && std::getline(in, line); ++i)
+      header << line << "\n";
+   parameters = header.str();
+
+   while (std::getline(in, line)) {
+      char *end = nullptr;
+      hashes.push_back(std::strtoull(line.c_str(), &end, 16));
+      if (line.size() != 16 || *end != '\0') {
+         error = path + ": invalid hash " + line;
+         return true;
+      }
+   }
+   return true;
+}
+
+GoldenResult checkGolden(const RenderJob &job, const RenderOutput &output) {
+   GoldenResult result;
+   const std::string hashesPath = job.goldenPath + ".hashes";
+   const std::string wavPath = job.goldenPath + ".wav";
+
+   if (job.isUpdate) {
+      if (writeHashes(hashesPath, output, result.message) &&
+          output.audio.write(wavPath, result.message)) {
+         result.status = GoldenResult::Updated;
+         result.message = std::to_string(output.blockHashes.size()) + " blocks";
+      }
+      return result;
+   }
+
+   std::string parameters;
+   std::vector<uint64_t> hashes;
+   if (!readHashes(hashesPath, parameters, hashes, result.message)) {
+      result.status = GoldenResult::Missing;
+      result.message = "no " + hashesPath + ", see --update";
+      return result;
+   }
+   if (!result.message.empty())
+      return result;
+
+   std::ostringstream expectedParameters;
+   expectedParameters << "sample-rate " << output.audio.sampleRate << "\n"
+                      << "block-size " << output.blockSize << "\n"
+                      << "channels " << output.audio.channels.size() << "\n"
+                      << "frames " << output.audio.frameCount() << "\n";
+   if (parameters != expectedParameters.str() || hashes.size() != output.blockHashes.size()) {
+      result.status = GoldenResult::Mismatch;
+      result.message = "the golden was rendered with other parameters, see " + hashesPath;
+      return result;
+   }
+
+   std::vector<uint64_t> differingBlocks;
+   for (uint64_t block = 0; block < hashes.size(); ++block)
+      if (hashes[block] != output.blockHashes[block])
+         differingBlocks.push_back(block);
+
+   if (differingBlocks.empty()) {
+      result.status = GoldenResult::Match;
+      result.message = std::to_string(hashes.size()) + " blocks";
+      return result;
+   }
+
+   const uint64_t firstBlock = differingBlocks.front();
+   result.status = GoldenResult::Mismatch;
+   result.message = std::to_string(differingBlocks.size()) + " of " +
+                    std::to_string(hashes.size()) + " blocks differ, the first is block " +
+                    std::to_string(firstBlock);
+
+   WavFile golden;
+   std::string wavError;
+   if (!golden.read(wavPath, wavError) || golden.channels.size() != output.audio.channels.size() ||
+       golden.frameCount() != output.audio.frameCount()) {
+      result.message += ", no usable " + wavPath + " to compare the samples";
+      return result;
+   }
+
+   // the largest difference over the differing blocks, and where it first exceeds the tolerance
+   double maxDiff = 0;
+   int64_t firstFrame = -1;
+   for (uint64_t block : differingBlocks) {
+      const uint64_t start = block * output.blockSize;
+      for (size_t c = 0; c < golden.channels.size(); ++c) {
+         for (uint64_t i = start; i < start + output.blockSize; ++i) {
+            const double a = golden.channels[c][i];
+            const double b = output.audio.channels[c][i];
+            // a NaN or infinity is never within the tolerance
+            const double diff = (a == b) ? 0 : std::isfinite(a - b) ? std::fabs(a - b) : INFINITY;
+            maxDiff = std::max(maxDiff, diff);
+            if (diff > job.tolerance && (firstFrame < 0 || int64_t(i) < firstFrame))
+               firstFrame = i;
+         }
+      }
+   }
+
+   if (firstFrame < 0) {
+      result.status = GoldenResult::WithinTolerance;
+      result.message += ", max diff " + formatDiff(maxDiff);
+   } else {
+      result.message += ", max diff " + formatDiff(maxDiff) + " over the tolerance of " +
+                        formatDiff(job.tolerance) + " from frame " + std::to_string(firstFrame);
+   }
+   return result;
+}
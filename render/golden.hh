@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+#include "render-job.hh"
+
+// The reference render of a job, stored next to each other under the job's golden path:
+// - <golden>.hashes: the render's parameters, then the hash of each block, one per line
+// - <golden>.wav: the render itself, needed to compare with a tolerance
+//
+// Blocks whose hash matches are identical; the others are compared sample by sample against
+// the .wav, if there is one.
+struct GoldenResult {
+   enum Status {
+      Match,
+      WithinTolerance,
+      Mismatch,
+      Missing,
+      Updated,
+      Error,
+   };
+
+   Status status = Error;
+   std::string message;
+
+   bool isPass() const noexcept {
+      return status == Match || status == WithinTolerance || status == Updated;
+   }
+};
+
+GoldenResult checkGolden(const RenderJob &job, const RenderOutput &output);
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "golden.hh"
+#include "render-job.hh"
+
+// Deterministic offline renders of plugins, checked against golden references.
+//
+// A job renders a plugin, optionally with a saved state, a MIDI file and an input WAV, with a
+// fixed sample rate and block size, and hashes each block of the output. The hashes are compared
+// to the golden ones; the differing blocks are then compared sample by sample with the golden
+// render, within a tolerance.
+//
+// usage: clap-host-render <job options>
+//        clap-host-render --jobs <file> [-j <parallel jobs>] [--update]
+//
+// job options:
+//   --plugin <path>          the .clap file
+//   --plugin-id <id>         the plugin, by default the one at --plugin-index (default: 0)
+//   --state <path>           a state saved by the plugin, loaded before activating it
+//   --midi <path>            a Standard MIDI File played into the first note port
+//   --input <path>           a WAV file played into the first audio port, at the same sample rate
+//   --sample-rate <hz>       default: 48000
+//   --block-size <frames>    default: 256
+//   --frames <n>, --seconds <s>
+//                            the length, rounded up to whole blocks; by default the input's,
+//                            or 10 seconds
+//   --golden <path>          the golden reference: <path>.hashes and <path>.wav
+//   --tolerance <value>      the largest difference between two samples that still passes
+//   --update                 (re)writes the golden reference instead of checking it
+//   --output <path>          also writes the render to a WAV file
+//   --name <name>            the job's name in the report
+//
+// The jobs file has the options of one job per line; empty lines and lines starting with #
+// are skipped, and arguments with spaces can be quoted. Relative paths are resolved from the
+// file's directory. Each job runs in its own process, so that a crashing plugin only fails its
+// job, up to -j at a time (default: the number of cores).
+//
+// Exits with 0 if all the jobs passed.
+
+enum JobExit {
+   JobPassed = 0,
+   JobFailed = 1,
+   JobError = 2,
+};
+
+static void printUsage() {
+   std::fprintf(stderr,
+                "usage: clap-host-render <job options>\n"
+                "       clap-host-render --jobs <file> [-j <parallel jobs>] [--update]\n"
+                "see render/main.cc for the job options\n");
+}
+
+// Splits a line of the jobs file into arguments, with double quotes and backslash escapes.
+static bool splitArgs(const std::string &line, std::vector<std::string> &args) {
+   std::string arg;
+   bool hasArg = false;
+   bool isQuoted = false;
+   for (size_t i = 0; i < line.size(); ++i) {
+      const char c = line[i];
+      if (c == '\\' && i + 1 < line.size()) {
+         arg += line[++i];
+         hasArg = true;
+      } else if (c == '"') {
+         isQuoted = !isQuoted;
+         hasArg = true;
+      } else if (!isQuoted && (c == ' ' || c == '\t')) {
+         if (hasArg)
+            args.push_back(std::move(arg));
+         arg.clear();
+         hasArg = false;
+      } else {
+         arg += c;
+         hasArg = true;
+      }
+   }
+   if (hasArg)
+      args.push_back(std::move(arg));
+   return !isQuoted;
+}
+
+static bool readJobs(const std::string &path, bool isUpdate, std::vector<RenderJob> &jobs) {
+   std::ifstream in(path);
+   if (!in) {
+      std::fprintf(stderr, "can't open %s\n", path.c_str());
+      return false;
+   }
+
+   const std::string baseDir = std::filesystem::path(path).parent_path().string();
+   std::string line;
+   for (int lineNumber = 1; std::getline(in, line); ++lineNumber) {
+      std::vector<std::string> args;
+      if (!splitArgs(line, args)) {
+         std::fprintf(stderr, "%s:%d: unterminated quote\n", path.c_str(), lineNumber);
+         return false;
+      }
+      if (args.empty() || args[0][0] == '#')
+         continue;
+
+      RenderJob job;
+      job.isUpdate = isUpdate;
+      std::string error;
+      if (!job.parse(args, baseDir, error)) {
+         std::fprintf(stderr, "%s:%d: %s\n", path.c_str(), lineNumber, error.c_str());
+         return false;
+      }
+      jobs.push_back(std::move(job));
+   }
+   return true;
+}
+
+static void printResult(const char *result, const std::string &name, const std::string &message) {
+   std::printf("%-8s %s: %s\n", result, name.c_str(), message.c_str());
+   std::fflush(stdout);
+}
+
+static JobExit runJob(const RenderJob &job) {
+   RenderOutput output;
+   std::string error;
+   if (!render(job, output, error)) {
+      printResult("ERROR", job.name, error);
+      return JobError;
+   }
+
+   if (!job.outputPath.empty() && !output.audio.write(job.outputPath, error)) {
+      printResult("ERROR", job.name, error);
+      return JobError;
+   }
+
+   if (job.goldenPath.empty()) {
+      printResult("RENDERED", job.name, std::to_string(output.blockHashes.size()) + " blocks");
+      return JobPassed;
+   }
+
+   static const char *const statusNames[] = {
+      "PASS", "PASS", "FAIL", "MISSING", "UPDATED", "ERROR"};
+   const auto result = checkGolden(job, output);
+   printResult(statusNames[result.status], job.name, result.message);
+   if (result.isPass())
+      return JobPassed;
+   return result.status == GoldenResult::Error ? JobError : JobFailed;
+}
+
+// Runs each job in a child process, returns the number of jobs that didn't pass.
+static size_t runJobs(const std::vector<RenderJob> &jobs, unsigned parallelJobs) {
+   std::map<pid_t, const RenderJob *> running;
+   size_t failedCount = 0;
+   size_t next = 0;
+
+   while (next < jobs.size() || !running.empty()) {
+      while (next < jobs.size() && running.size() < parallelJobs) {
+         const RenderJob &job = jobs[next++];
+         std::fflush(stdout);
+         std::fflush(stderr);
+         const pid_t pid = ::fork();
+         if (pid == 0)
+            ::_exit(runJob(job));
+         if (pid < 0) {
+            printResult("ERROR", job.name, std::string("fork failed: ") + std::strerror(errno));
+            ++failedCount;
+            continue;
+         }
+         running.emplace(pid, &job);
+      }
+
+      int status;
+      const pid_t pid = ::waitpid(-1, &status, 0);
+      if (pid < 0) {
+         if (errno == EINTR)
+            continue;
+         break;
+      }
+
+      auto it = running.find(pid);
+      if (it == running.end())
+         continue;
+      if (WIFSIGNALED(status)) {
+         printResult("CRASH",
+                     it->second->name,
+                     std::string("killed by signal ") + ::strsignal(WTERMSIG(status)));
+         ++failedCount;
+      } else if (!WIFEXITED(status) || WEXITSTATUS(status) != JobPassed)
+         ++failedCount;
+      running.erase(it);
+   }
+   return failedCount;
+}
+
+int main(int argc, char **argv) {
+   std::vector<std::string> args(argv + 1, argv + argc);
+   std::string jobsPath;
+   unsigned parallelJobs = std::max(1u, std::thread::hardware_concurrency());
+   bool isUpdate = false;
+
+   std::vector<std::string> jobArgs;
+   for (size_t i = 0; i < args.size(); ++i) {
+      if (args[i] == "--help" || args[i] == "-h") {
+         printUsage();
+         return 0;
+      } else if (args[i] == "--jobs" && i + 1 < args.size())
+         jobsPath = args[++i];
+      else if (args[i] == "-j" && i + 1 < args.size())
+         parallelJobs = std::max(1, std::atoi(args[++i].c_str()));
+      else {
+         if (args[i] == "--update")
+            isUpdate = true;
+         jobArgs.push_back(args[i]);
+      }
+   }
+
+   std::vector<RenderJob> jobs;
+   if (jobsPath.empty()) {
+      RenderJob job;
+      std::string error;
+      if (!job.parse(jobArgs, {}, error)) {
+         std::fprintf(stderr, "%s\n", error.c_str());
+         printUsage();
+         return JobError;
+      }
+
+      // a single job runs in this process, which is handier to debug
+      return runJob(job);
+   }
+
+   if (jobArgs.size() != (isUpdate ? 1 : 0)) {
+      printUsage();
+      return JobError;
+   }
+   if (!readJobs(jobsPath, isUpdate, jobs))
+      return JobError;
+
+   const size_t failedCount = runJobs(jobs, parallelJobs);
+   std::printf("%zu jobs, %zu passed, %zu failed\n",
+               jobs.size(),
+               jobs.size() - failedCount,
+               failedCount);
+   return failedCount ? JobFailed : JobPassed;
+}
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+#include "midi-file.hh"
+
+// Reads the big-endian fields and variable-length quantities of a chunk.
+class MidiReader {
+public:
+   MidiReader(const uint8_t *data, size_t size) : _data(data), _size(size) {}
+
+   bool atEnd() const noexcept { return _offset >= _size; }
+   bool hasFailed() const noexcept { return _hasFailed; }
+
+   uint8_t peek() noexcept { return ensure(1) ? _data[_offset] : 0; }
+
+   uint32_t read(uint32_t bytes) noexcept {
+      uint32_t value = 0;
+      if (!ensure(bytes))
+         return 0;
+      for (uint32_t i = 0; i < bytes; ++i)
+         value = value << 8 | _data[_offset++];
+      return value;
+   }
+
+   uint32_t readVarLen() noexcept {
+      uint32_t value = 0;
+      for (int i = 0; i < 4; ++i) {
+         const uint8_t byte = read(1);
+         value = value << 7 | (byte & 0x7f);
+         if (!(byte & 0x80))
+            break;
+      }
+      return value;
+   }
+
+   void skip(size_t bytes) noexcept {
+      if (ensure(bytes))
+         _offset += bytes;
+   }
+
+private:
+   bool ensure(size_t bytes) noexcept {
+      if (_offset + bytes > _size)
+         _hasFailed = true;
+      return !_hasFailed;
+   }
+
+   const uint8_t *_data;
+   size_t _size;
+   size_t _offset = 0;
+   bool _hasFailed = false;
+};
+
+bool MidiFile::read(const std::string &path, double sampleRate, std::string &error) {
+   std::ifstream in(path, std::ios::binary);
+   if (!in) {
+      error = "can't open " + path;
+      return false;
+   }
+   const std::vector<uint8_t> file{std::istreambuf_iterator<char>(in),
+                                   std::istreambuf_iterator<char>()};
+
+   MidiReader header(file.data(), file.size());
+   const uint32_t headerId = header.read(4);
+   const uint32_t headerLength = header.read(4);
+   if (headerId != 0x4d546864 /* MThd */ || headerLength < 6) {
+      error = path + " isn't a Standard MIDI File";
+      return false;
+   }
+   const uint32_t format = header.read(2);
+   const uint32_t trackCount = header.read(2);
+   const uint32_t division = header.read(2);
+   if (division == 0) {
+      error = path + ": invalid time division";
+      return false;
+   }
+   if (format > 1) {
+      error = path + ": only the formats 0 and 1 are supported";
+      return false;
+   }
+
+   struct TimedMessage {
+      uint64_t tick;
+      Message message;
+   };
+   std::vector<TimedMessage> timed;
+   std::vector<std::pair<uint64_t, uint32_t>> tempos; // tick, microseconds per quarter note
+
+   // the header may be longer in later versions of the format, its extra bytes are skipped
+   size_t offset = 8 + size_t(headerLength);
+   for (uint32_t t = 0; t < trackCount && offset + 8 <= file.size(); ++t) {
+      MidiReader chunk(file.data() + offset, 8);
+      const uint32_t id = chunk.read(4);
+      const uint32_t size = std::min<size_t>(chunk.read(4), file.size() - offset - 8);
+      MidiReader track(file.data() + offset + 8, size);
+      offset += 8 + size;
+      if (id != 0x4d54726b /* MTrk */)
+         continue;
+
+      uint64_t tick = 0;
+      uint8_t runningStatus = 0;
+      while (!track.atEnd() && !track.hasFailed()) {
+         tick += track.readVarLen();
+
+         uint8_t status = track.peek();
+         if (status & 0x80)
+            track.skip(1);
+         else
+            status = runningStatus;
+
+         if (status == 0xff) {
+            const uint8_t type = track.read(1);
+            const uint32_t length = track.readVarLen();
+            if (type == 0x51 && length == 3)
+               tempos.emplace_back(tick, track.read(3));
+            else if (type == 0x2f) // end of track
+               break;
+            else
+               track.skip(length);
+         } else if (status == 0xf0 || status == 0xf7) {
+            track.skip(track.readVarLen());
+         } else if (status >= 0x80 && status < 0xf0) {
+            runningStatus = status;
+            const uint8_t kind = status >> 4;
+            const uint8_t dataSize = (kind == 0xc || kind == 0xd) ? 1 : 2;
+
+            Message message = {0, uint8_t(1 + dataSize), {status, 0, 0}};
+            for (uint8_t i = 0; i < dataSize; ++i)
+               message.data[1 + i] = track.read(1);
+            timed.push_back({tick, message});
+         } else {
+            error = path + ": unexpected status byte";
+            return false;
+         }
+      }
+
+      if (track.hasFailed()) {
+         error = path + ": truncated track";
+         return false;
+      }
+   }
+
+   // format 1 puts the tempo map in the first track, the tracks are merged by tick: the stable
+   // sort keeps the order of the tracks, and of the messages within a track
+   std::stable_sort(timed.begin(), timed.end(), [](auto &a, auto &b) { return a.tick < b.tick; });
+   std::stable_sort(tempos.begin(), tempos.end());
+
+   // the seconds at the last tempo change, and the seconds per tick from there
+   double seconds = 0;
+   uint64_t tempoTick = 0;
+   double secondsPerTick;
+   if (division & 0x8000) {
+      // SMPTE: frames per second, and ticks per frame
+      const int fps = -int8_t(division >> 8);
+      const uint32_t ticksPerFrame = division & 0xff;
+      if ((fps != 24 && fps != 25 && fps != 29 && fps != 30) || ticksPerFrame == 0) {
+         error = path + ": invalid SMPTE time division";
+         return false;
+      }
+      secondsPerTick = 1. / ((fps == 29 ? 29.97 : fps) * ticksPerFrame);
+      tempos.clear();
+   } else
+      secondsPerTick = 0.5 / division; // 120 bpm until the first tempo change
+
+   size_t nextTempo = 0;
+   messages.clear();
+   messages.reserve(timed.size());
+   for (auto &m : timed) {
+      while (nextTempo < tempos.size() && tempos[nextTempo].first <= m.tick) {
+         seconds += (tempos[nextTempo].first - tempoTick) * secondsPerTick;
+         tempoTick = tempos[nextTempo].first;
+         secondsPerTick = tempos[nextTempo].second / 1e6 / division;
+         ++nextTempo;
+      }
+
+      m.message.frame = uint64_t(std::floor((seconds + (m.tick - tempoTick) * secondsPerTick) *
+                                            sampleRate));
+      messages.push_back(m.message);
+   }
+   return true;
+}
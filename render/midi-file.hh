@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The channel messages of a Standard MIDI File, format 0 or 1, with their time in samples.
+//
+// The tracks are merged, and the ticks converted to samples with the file's tempo map, or by
+// SMPTE time code. The system exclusive and meta events other than the tempo are skipped.
+struct MidiFile {
+   struct Message {
+      uint64_t frame;
+      uint8_t size;
+      uint8_t data[3];
+   };
+
+   // sorted by frame, the messages of a same frame in the order of the tracks
+   std::vector<Message> messages;
+
+   bool read(const std::string &path, double sampleRate, std::string &error);
+};
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <dlfcn.h>
+
+#include <clap/helpers/host.hxx>
+#include <clap/helpers/plugin-proxy.hxx>
+
+#include "render-host.hh"
+
+template class clap::helpers::Host<clap::helpers::MisbehaviourHandler::Terminate,
+                                   clap::helpers::CheckingLevel::Maximal>;
+template class clap::helpers::PluginProxy<clap::helpers::MisbehaviourHandler::Terminate,
+                                          clap::helpers::CheckingLevel::Maximal>;
+
+// set while the plugin is called as from the audio thread
+static thread_local bool g_isAudioThread = false;
+
+// clap_istream over a state file read in memory.
+struct StateReader {
+   explicit StateReader(std::vector<uint8_t> data) : data(std::move(data)) {
+      stream.ctx = this;
+      stream.read = [](const clap_istream *stream, void *buffer, uint64_t size) -> int64_t {
+         auto self = static_cast<StateReader *>(stream->ctx);
+         const uint64_t count = std::min<uint64_t>(size, self->data.size() - self->offset);
+         std::memcpy(buffer, self->data.data() + self->offset, count);
+         self->offset += count;
+         return count;
+      };
+   }
+
+   std::vector<uint8_t> data;
+   uint64_t offset = 0;
+   clap_istream stream;
+};
+
+RenderHost::RenderHost()
+   : RenderBaseHost("Clap Test Host (render)",            // name
+                    "clap",                               // vendor
+                    "0.1.0",                              // version
+                    "https://github.com/free-audio/clap" // url
+     ) {}
+
+RenderHost::~RenderHost() { unload(); }
+
+bool RenderHost::load(const std::string &path,
+                      const std::string &pluginId,
+                      uint32_t pluginIndex,
+                      std::string &error) {
+   _library = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+   if (!_library) {
+      error = "failed to load " + path + ": " + ::dlerror();
+      return false;
+   }
+
+   _pluginEntry = reinterpret_cast<const clap_plugin_entry *>(::dlsym(_library, "clap_entry"));
+   if (!_pluginEntry || !_pluginEntry->init(path.c_str())) {
+      error = "no usable clap_entry in " + path;
+      _pluginEntry = nullptr;
+      return false;
+   }
+
+   auto factory = static_cast<const clap_plugin_factory *>(
+      _pluginEntry->get_factory(CLAP_PLUGIN_FACTORY_ID));
+   if (!factory) {
+      error = path + " has no plugin factory";
+      return false;
+   }
+
+   std::string id = pluginId;
+   if (id.empty()) {
+      auto descriptor = pluginIndex < factory->get_plugin_count(factory)
+                           ? factory->get_plugin_descriptor(factory, pluginIndex)
+                           : nullptr;
+      if (!descriptor) {
+         error = "no plugin at index " + std::to_string(pluginIndex) + " in " + path;
+         return false;
+      }
+      id = descriptor->id;
+   }
+
+   auto plugin = factory->create_plugin(factory, clapHost(), id.c_str());
+   if (!plugin) {
+      error = "could not create the plugin " + id;
+      return false;
+   }
+
+   _plugin = std::make_unique<PluginProxy>(*plugin, *this);
+   if (!_plugin->init()) {
+      error = "the plugin " + id + " failed to initialize";
+      return false;
+   }
+   return true;
+}
+
+bool RenderHost::loadState(const std::string &path, std::string &error) {
+   if (!_plugin->canUseState()) {
+      error = "the plugin has no state extension";
+      return false;
+   }
+
+   std::ifstream in(path, std::ios::binary);
+   if (!in) {
+      error = "can't open " + path;
+      return false;
+   }
+
+   StateReader reader({std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()});
+   if (!_plugin->stateLoad(&reader.stream)) {
+      error = "the plugin failed to load the state " + path;
+      return false;
+   }
+   return true;
+}
+
+void RenderHost::unload() {
+   if (_plugin) {
+      stop();
+      _plugin->destroy();
+      _plugin.reset();
+   }
+
+   if (_pluginEntry) {
+      _pluginEntry->deinit();
+      _pluginEntry = nullptr;
+   }
+
+   if (_library) {
+      ::dlclose(_library);
+      _library = nullptr;
+   }
+}
+
+bool RenderHost::start(double sampleRate, uint32_t maxFrames, std::string &error) {
+   if (!_plugin->activate(sampleRate, maxFrames, maxFrames)) {
+      error = "the plugin failed to activate";
+      return false;
+   }
+   _isActive = true;
+
+   g_isAudioThread = true;
+   _isProcessing = _plugin->startProcessing();
+   g_isAudioThread = false;
+
+   if (!_isProcessing)
+      error = "the plugin failed to start processing";
+   return _isProcessing;
+}
+
+void RenderHost::stop() {
+   if (_isProcessing) {
+      g_isAudioThread = true;
+      _plugin->stopProcessing();
+      g_isAudioThread = false;
+      _isProcessing = false;
+   }
+
+   if (_isActive) {
+      _plugin->deactivate();
+      _isActive = false;
+   }
+}
+
+void RenderHost::noteDialects(uint32_t &supported, uint32_t &preferred) const {
+   supported = CLAP_NOTE_DIALECT_CLAP | CLAP_NOTE_DIALECT_MIDI;
+   preferred = CLAP_NOTE_DIALECT_CLAP;
+
+   clap_note_port_info info;
+   if (_plugin->canUseNotePorts() && _plugin->notePortsCount(true) > 0 &&
+       _plugin->notePortsGet(0, true, &info)) {
+      supported = info.supported_dialects;
+      preferred = info.preferred_dialect;
+   }
+}
+
+clap_process_status RenderHost::process(const clap_process *process) noexcept {
+   g_isAudioThread = true;
+   const auto status = _plugin->process(process);
+   g_isAudioThread = false;
+   return status;
+}
+
+void RenderHost::logLog(clap_log_severity severity, const char *message) const noexcept {
+   std::fprintf(stderr, "[plugin] %s\n", message);
+}
+
+bool RenderHost::threadCheckIsMainThread() const noexcept { return !g_isAudioThread; }
+
+bool RenderHost::threadCheckIsAudioThread() const noexcept { return g_isAudioThread; }
+
+bool RenderHost::threadPoolRequestExec(uint32_t numTasks) noexcept {
+   if (!g_isAudioThread || !_plugin->canUseThreadPool())
+      return false;
+
+   for (uint32_t i = 0; i < numTasks; ++i)
+      _plugin->threadPoolExec(i);
+   return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <clap/helpers/host.hh>
+#include <clap/helpers/plugin-proxy.hh>
+
+using RenderBaseHost = clap::helpers::Host<clap::helpers::MisbehaviourHandler::Terminate,
+                                           clap::helpers::CheckingLevel::Maximal>;
+
+// Host of an offline render, with the strictest checks: a misbehaving plugin terminates the job.
+//
+// A single thread plays the main and the audio thread in turn, and runs the plugin's thread pool
+// tasks itself, in order, so that the render doesn't depend on the scheduling. There is no
+// transport, and the timers, fds and callbacks requested by the plugin are not served.
+class RenderHost final : public RenderBaseHost {
+public:
+   using PluginProxy = clap::helpers::PluginProxy<clap::helpers::MisbehaviourHandler::Terminate,
+                                                  clap::helpers::CheckingLevel::Maximal>;
+
+   RenderHost();
+   ~RenderHost();
+
+   // the plugin is chosen by id, or by index in the factory if pluginId is empty
+   bool load(const std::string &path,
+             const std::string &pluginId,
+             uint32_t pluginIndex,
+             std::string &error);
+   bool loadState(const std::string &path, std::string &error);
+   void unload();
+
+   bool start(double sampleRate, uint32_t maxFrames, std::string &error);
+   void stop();
+
+   // of the plugin's first note input, CLAP and MIDI if it has none
+   void noteDialects(uint32_t &supported, uint32_t &preferred) const;
+
+   clap_process_status process(const clap_process *process) noexcept;
+
+protected:
+   // clap_host
+   void requestRestart() noexcept override {}
+   void requestProcess() noexcept override {}
+   void requestCallback() noexcept override {}
+
+   // clap_host_log
+   bool implementsLog() const noexcept override { return true; }
+   void logLog(clap_log_severity severity, const char *message) const noexcept override;
+
+   // clap_host_thread_check
+   bool threadCheckIsMainThread() const noexcept override;
+   bool threadCheckIsAudioThread() const noexcept override;
+
+   // clap_host_thread_pool
+   bool implementsThreadPool() const noexcept override { return true; }
+   bool threadPoolRequestExec(uint32_t numTasks) noexcept override;
+
+private:
+   void *_library = nullptr;
+   const clap_plugin_entry *_pluginEntry = nullptr;
+   std::unique_ptr<PluginProxy> _plugin;
+
+   bool _isActive = false;
+   bool _isProcessing = false;
+};
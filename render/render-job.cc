@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include <clap/helpers/event-list.hh>
+
+#include "midi-file.hh"
+#include "midi-translator.hh"
+#include "render-host.hh"
+#include "render-job.hh"
+
+static bool parseNumber(const std::string &text, double &value) {
+   char *end = nullptr;
+   value = std::strtod(text.c_str(), &end);
+   return !text.empty() && *end == '\0' && std::isfinite(value);
+}
+
+bool RenderJob::parse(const std::vector<std::string> &args,
+                      const std::string &baseDir,
+                      std::string &error) {
+   for (size_t i = 0; i < args.size(); ++i) {
+      const std::string &arg = args[i];
+      if (arg == "--update") {
+         isUpdate = true;
+         continue;
+      }
+
+      if (i + 1 >= args.size()) {
+         error = "missing value for " + arg;
+         return false;
+      }
+      const std::string &value = args[++i];
+
+      std::string *path = nullptr;
+      double number = 0;
+      bool isNumberValid = parseNumber(value, number);
+      if (arg == "--name")
+         name = value;
+      else if (arg == "--plugin")
+         path = &pluginPath;
+      else if (arg == "--plugin-id")
+         pluginId = value;
+      else if (arg == "--plugin-index" && isNumberValid && number >= 0)
+         pluginIndex = number;
+      else if (arg == "--state")
+         path = &statePath;
+      else if (arg == "--midi")
+         path = &midiPath;
+      else if (arg == "--input")
+         path = &inputPath;
+      else if (arg == "--sample-rate" && isNumberValid && number > 0)
+         sampleRate = number;
+      else if (arg == "--block-size" && isNumberValid && number >= 1 && number <= 1 << 16)
+         blockSize = number;
+      else if (arg == "--frames" && isNumberValid && number >= 1)
+         frames = number;
+      else if (arg == "--seconds" && isNumberValid && number > 0)
+         seconds = number;
+      else if (arg == "--golden")
+         path = &goldenPath;
+      else if (arg == "--tolerance" && isNumberValid && number >= 0)
+         tolerance = number;
+      else if (arg == "--output")
+         path = &outputPath;
+      else {
+         error = "unknown option or invalid value: " + arg + " " + value;
+         return false;
+      }
+
+      if (path) {
+         std::filesystem::path p(value);
+         *path = (baseDir.empty() || p.is_absolute()) ? value : (baseDir / p).string();
+      }
+   }
+
+   if (pluginPath.empty()) {
+      error = "no plugin, see --plugin";
+      return false;
+   }
+   if (name.empty())
+      name = goldenPath.empty() ? pluginPath : goldenPath;
+   return true;
+}
+
+uint64_t hashBlock(const WavFile &audio, uint64_t start, uint32_t frames) noexcept {
+   uint64_t hash = 0xcbf29ce484222325;
+   for (auto &channel : audio.channels) {
+      for (uint64_t i = start; i < start + frames; ++i) {
+         uint32_t bits;
+         std::memcpy(&bits, &channel[i], sizeof(bits));
+         for (int b = 0; b < 32; b += 8) {
+            hash ^= (bits >> b) & 0xff;
+            hash *= 0x100000001b3;
+         }
+      }
+   }
+   return hash;
+}
+
+bool render(const RenderJob &job, RenderOutput &output, std::string &error) {
+   constexpr uint32_t CHANNEL_COUNT = 2;
+
+   WavFile input;
+   if (!job.inputPath.empty()) {
+      if (!input.read(job.inputPath, error))
+         return false;
+      if (input.sampleRate != job.sampleRate) {
+         error = job.inputPath + " isn't at the sample rate of the render, it isn't resampled";
+         return false;
+      }
+      if (input.channels.size() == 1)
+         input.channels.push_back(input.channels[0]);
+   }
+
+   MidiFile midi;
+   if (!job.midiPath.empty() && !midi.read(job.midiPath, job.sampleRate, error))
+      return false;
+
+   uint64_t frames = job.frames;
+   if (!frames && job.seconds > 0)
+      frames = std::ceil(job.seconds * job.sampleRate);
+   if (!frames)
+      frames = input.frameCount() ? input.frameCount()
+                                  : uint64_t(RenderJob::DEFAULT_SECONDS * job.sampleRate);
+   const uint32_t blockSize = job.blockSize;
+   const uint64_t blockCount = (frames + blockSize - 1) / blockSize;
+   frames = blockCount * blockSize;
+
+   // the input is zero-padded to the length of the render
+   for (auto &channel : input.channels)
+      channel.resize(frames, 0.f);
+
+   output.blockSize = blockSize;
+   output.audio.sampleRate = job.sampleRate;
+   output.audio.channels.assign(CHANNEL_COUNT, std::vector<float>(frames, 0.f));
+   output.blockHashes.clear();
+   output.blockHashes.reserve(blockCount);
+
+   RenderHost host;
+   if (!host.load(job.pluginPath, job.pluginId, job.pluginIndex, error))
+      return false;
+   if (!job.statePath.empty() && !host.loadState(job.statePath, error))
+      return false;
+
+   uint32_t supportedDialects;
+   uint32_t preferredDialect;
+   host.noteDialects(supportedDialects, preferredDialect);
+   MidiTranslator midiTranslator;
+   midiTranslator.setDialects(supportedDialects, preferredDialect);
+   midiTranslator.reset();
+
+   if (!host.start(job.sampleRate, blockSize, error))
+      return false;
+
+   std::vector<float> channels[2 * CHANNEL_COUNT];
+   float *inputs[CHANNEL_COUNT];
+   float *outputs[CHANNEL_COUNT];
+   for (uint32_t c = 0; c < CHANNEL_COUNT; ++c) {
+      channels[c].assign(blockSize, 0.f);
+      channels[CHANNEL_COUNT + c].assign(blockSize, 0.f);
+      inputs[c] = channels[c].data();
+      outputs[c] = channels[CHANNEL_COUNT + c].data();
+   }
+   clap_audio_buffer audioIn = {inputs, nullptr, CHANNEL_COUNT, 0, 0};
+   clap_audio_buffer audioOut = {outputs, nullptr, CHANNEL_COUNT, 0, 0};
+
+   clap::helpers::EventList evIn;
+   clap::helpers::EventList evOut;
+
+   clap_process process;
+   process.frames_count = blockSize;
+   process.transport = nullptr;
+   process.audio_inputs = &audioIn;
+   process.audio_inputs_count = 1;
+   process.audio_outputs = &audioOut;
+   process.audio_outputs_count = 1;
+   process.in_events = evIn.clapInputEvents();
+   process.out_events = evOut.clapOutputEvents();
+
+   size_t nextMessage = 0;
+   for (uint64_t block = 0; block < blockCount; ++block) {
+      const uint64_t start = block * blockSize;
+
+      for (uint32_t c = 0; c < CHANNEL_COUNT; ++c) {
+         if (input.channels.empty())
+            std::fill(inputs[c], inputs[c] + blockSize, 0.f);
+         else
+            std::copy_n(input.channels[c].data() + start, blockSize, inputs[c]);
+      }
+
+      for (; nextMessage < midi.messages.size() &&
+             midi.messages[nextMessage].frame < start + blockSize;
+           ++nextMessage) {
+         auto &message = midi.messages[nextMessage];
+         midiTranslator.translate(message.frame - start, message.data, message.size, evIn);
+      }
+
+      process.steady_time = start;
+      if (host.process(&process) == CLAP_PROCESS_ERROR) {
+         error = "the plugin failed to process the block " + std::to_string(block);
+         return false;
+      }
+
+      for (uint32_t c = 0; c < CHANNEL_COUNT; ++c)
+         std::copy_n(outputs[c], blockSize, output.audio.channels[c].data() + start);
+      output.blockHashes.push_back(hashBlock(output.audio, start, blockSize));
+
+      evIn.clear();
+      evOut.clear();
+   }
+
+   host.stop();
+   return true;
+}
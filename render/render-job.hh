@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "wav-file.hh"
+
+// A plugin rendered offline, in fixed-size blocks: see main.cc for the options.
+struct RenderJob {
+   static constexpr double DEFAULT_SECONDS = 10;
+
+   std::string name;
+
+   std::string pluginPath;
+   std::string pluginId; // the plugin at pluginIndex if empty
+   uint32_t pluginIndex = 0;
+   std::string statePath;
+
+   std::string midiPath;
+   std::string inputPath;
+
+   double sampleRate = 48000;
+   uint32_t blockSize = 256;
+
+   // rounded up to a whole number of blocks; 0 for the input's length, or DEFAULT_SECONDS
+   uint64_t frames = 0;
+   double seconds = 0;
+
+   std::string goldenPath;
+   double tolerance = 0;
+   bool isUpdate = false;
+
+   std::string outputPath;
+
+   // returns false on an unknown option or an invalid value; the relative paths are resolved
+   // from baseDir, if not empty
+   bool parse(const std::vector<std::string> &args, const std::string &baseDir, std::string &error);
+};
+
+// The output of a render, stereo.
+struct RenderOutput {
+   uint32_t blockSize = 0;
+   WavFile audio;
+   std::vector<uint64_t> blockHashes;
+};
+
+// FNV-1a of the bits of the samples of a block, channel after channel.
+uint64_t hashBlock(const WavFile &audio, uint64_t start, uint32_t frames) noexcept;
+
+bool render(const RenderJob &job, RenderOutput &output, std::string &error);
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "wav-file.hh"
+
+static constexpr uint16_t WAVE_FORMAT_PCM = 1;
+static constexpr uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+static constexpr uint16_t WAVE_FORMAT_EXTENSIBLE = 0xfffe;
+
+template <typename T>
+static T readLe(const uint8_t *data) noexcept {
+   T value;
+   std::memcpy(&value, data, sizeof(value));
+   return value;
+}
+
+template <typename T>
+static void writeLe(std::ostream &out, T value) {
+   out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static float decodeSample(const uint8_t *data, uint16_t format, uint16_t bits) noexcept {
+   if (format == WAVE_FORMAT_IEEE_FLOAT)
+      return bits == 64 ? float(readLe<double>(data)) : readLe<float>(data);
+
+   switch (bits) {
+   case 16:
+      return readLe<int16_t>(data) / 32768.f;
+   case 24: {
+      int32_t value = data[0] | data[1] << 8 | data[2] << 16;
+      if (value & 0x800000)
+         value -= 0x1000000;
+      return value / 8388608.f;
+   }
+   case 32:
+      return float(readLe<int32_t>(data) / 2147483648.);
+   default:
+      return 0;
+   }
+}
+
+bool WavFile::read(const std::string &path, std::string &error) {
+   std::ifstream in(path, std::ios::binary);
+   if (!in) {
+      error = "can't open " + path;
+      return false;
+   }
+   const std::vector<uint8_t> file{std::istreambuf_iterator<char>(in),
+                                   std::istreambuf_iterator<char>()};
+
+   if (file.size() < 12 || std::memcmp(file.data(), "RIFF", 4) ||
+       std::memcmp(file.data() + 8, "WAVE", 4)) {
+      error = path + " isn't a RIFF WAVE file";
+      return false;
+   }
+
+   uint16_t format = 0;
+   uint16_t channelCount = 0;
+   uint16_t bits = 0;
+   const uint8_t *samples = nullptr;
+   uint64_t samplesSize = 0;
+
+   // the chunks are word aligned
+   for (size_t offset = 12; offset + 8 <= file.size();) {
+      const uint8_t *chunk = file.data() + offset;
+      const uint64_t size =
+         std::min<uint64_t>(readLe<uint32_t>(chunk + 4), file.size() - offset - 8);
+
+      if (!std::memcmp(chunk, "fmt ", 4) && size >= 16) {
+         format = readLe<uint16_t>(chunk + 8);
+         channelCount = readLe<uint16_t>(chunk + 10);
+         sampleRate = readLe<uint32_t>(chunk + 12);
+         bits = readLe<uint16_t>(chunk + 22);
+         if (format == WAVE_FORMAT_EXTENSIBLE && size >= 26)
+            format = readLe<uint16_t>(chunk + 32); // the sub-format GUID starts with the format
+      } else if (!std::memcmp(chunk, "data", 4)) {
+         samples = chunk + 8;
+         samplesSize = size;
+      }
+
+      offset += 8 + size + (size & 1);
+   }
+
+   const bool isSupported =
+      (format == WAVE_FORMAT_PCM && (bits == 16 || bits == 24 || bits == 32)) ||
+      (format == WAVE_FORMAT_IEEE_FLOAT && (bits == 32 || bits == 64));
+   if (!isSupported || channelCount == 0 || !samples) {
+      error = path + ": unsupported format, or no audio";
+      return false;
+   }
+
+   const uint32_t frameSize = channelCount * bits / 8;
+   const uint64_t frames = samplesSize / frameSize;
+   channels.assign(channelCount, std::vector<float>(frames));
+   for (uint64_t i = 0; i < frames; ++i) {
+      for (uint16_t c = 0; c < channelCount; ++c)
+         channels[c][i] = decodeSample(samples + i * frameSize + c * bits / 8, format, bits);
+   }
+   return true;
+}
+
+bool WavFile::write(const std::string &path, std::string &error) const {
+   std::ofstream out(path, std::ios::binary | std::ios::trunc);
+   if (!out) {
+      error = "can't create " + path;
+      return false;
+   }
+
+   const uint16_t channelCount = channels.size();
+   const uint32_t dataSize = frameCount() * channelCount * sizeof(float);
+
+   out.write("RIFF", 4);
+   writeLe<uint32_t>(out, 36 + dataSize);
+   out.write("WAVE", 4);
+
+   out.write("fmt ", 4);
+   writeLe<uint32_t>(out, 16);
+   writeLe<uint16_t>(out, WAVE_FORMAT_IEEE_FLOAT);
+   writeLe<uint16_t>(out, channelCount);
+   writeLe<uint32_t>(out, uint32_t(sampleRate));
+   writeLe<uint32_t>(out, uint32_t(sampleRate) * channelCount * sizeof(float));
+   writeLe<uint16_t>(out, channelCount * sizeof(float));
+   writeLe<uint16_t>(out, 32);
+
+   out.write("data", 4);
+   writeLe<uint32_t>(out, dataSize);
+   for (uint64_t i = 0; i < frameCount(); ++i) {
+      for (auto &channel : channels)
+         writeLe<float>(out, channel[i]);
+   }
+
+   if (!out.flush()) {
+      error = "failed to write " + path;
+      return false;
+   }
+   return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Audio read from or written to a RIFF WAVE file, as planar float samples.
+//
+// Reads 16, 24 and 32 bit integer PCM and 32 and 64 bit float, including WAVE_FORMAT_EXTENSIBLE.
+// Writes 32 bit float, so that a render is stored without loss. Little-endian hosts only.
+struct WavFile {
+   double sampleRate = 0;
+   std::vector<std::vector<float>> channels;
+
+   uint64_t frameCount() const noexcept { return channels.empty() ? 0 : channels[0].size(); }
+
+   bool read(const std::string &path, std::string &error);
+   bool write(const std::string &path, std::string &error) const;
+};